@@ -2,12 +2,14 @@
 #define TYPES_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdarg.h>
 
 // Octet string lengths
 #define BBS_SK_LEN 32
 #define BBS_PK_LEN 96
 #define BBS_SIG_LEN 80
+#define BBS_SCALAR_LEN 32
 #define BBS_PROOF_BASE_LEN 272
 #define BBS_PROOF_UD_ELEM_LEN 32
 #define BBS_PROOF_LEN(num_undisclosed) (BBS_PROOF_BASE_LEN + num_undisclosed * BBS_PROOF_UD_ELEM_LEN)
@@ -21,20 +23,36 @@ typedef uint8_t bbs_secret_key[BBS_SK_LEN];
 typedef uint8_t bbs_public_key[BBS_PK_LEN];
 typedef uint8_t bbs_signature[BBS_SIG_LEN];
 
+// Ciphersuites
+// Every operation takes the ciphersuite as its first argument. Keys are
+// compatible across ciphersuites, signatures and proofs are not.
+typedef struct bbs_ciphersuite bbs_ciphersuite;
+
+extern const bbs_ciphersuite *const bbs_sha256_ciphersuite;  // BLS12-381-SHA-256
+extern const bbs_ciphersuite *const bbs_shake256_ciphersuite; // BLS12-381-SHAKE-256
+
+// Threads
+// relic keeps its context per thread. Every thread has to call core_init and
+// pc_param_set_any before its first call into this library, and core_clean
+// after its last one. Then all operations may run concurrently on different
+// threads, as long as the buffers they write are not shared.
+
 // Key Generation
 int bbs_keygen_full(
-		bbs_secret_key sk,
-		bbs_public_key pk
+		const bbs_ciphersuite *cipher_suite,
+		bbs_secret_key         sk,
+		bbs_public_key         pk
 	);
 
 int bbs_keygen(
-		bbs_secret_key        sk,
-		const uint8_t        *key_material,
-		uint16_t              key_material_len,
-		const uint8_t        *key_info,
-		uint16_t              key_info_len,
-		const uint8_t        *key_dst,
-		uint8_t               key_dst_len
+		const bbs_ciphersuite *cipher_suite,
+		bbs_secret_key         sk,
+		const uint8_t         *key_material,
+		uint16_t               key_material_len,
+		const uint8_t         *key_info,
+		uint16_t               key_info_len,
+		const uint8_t         *key_dst,
+		uint8_t                key_dst_len
 	);
 
 int bbs_sk_to_pk(
@@ -42,55 +60,353 @@ int bbs_sk_to_pk(
 		bbs_public_key       pk
 	);
 
+// Messages
+// The varargs of the signing and proof functions below are pairs of a message
+// and its length (uint8_t*, uint32_t). Every message is mapped to a message
+// scalar first. The _scalars variants take one uint8_t* to the BBS_SCALAR_LEN
+// octets of a message scalar per message instead, so that callers can cache
+// the mapping. Message scalars depend on the ciphersuite.
+// The _array variants, and everything that takes the messages from arrays only,
+// describe them with a bbs_messages instead: msgs and msg_lens with one entry
+// per message that would be passed as varargs (for proof verification only
+// the disclosed ones), or msg_scalars for message scalars, which take
+// precedence if set. Either may be NULL if there are no messages. Unlike in
+// the varargs, the lengths are not limited to a uint32_t.
+typedef struct {
+	const uint8_t *const *msgs;
+	const size_t         *msg_lens;
+	const uint8_t *const *msg_scalars;
+} bbs_messages;
+
+// bbs_messages_to_scalars maps the messages to num_messages * BBS_SCALAR_LEN
+// octets of message scalars.
+int bbs_messages_to_scalars(
+		const bbs_ciphersuite *cipher_suite,
+		uint8_t               *msg_scalars,
+		uint64_t               num_messages,
+		...
+	);
+
+int bbs_messages_to_scalars_array(
+		const bbs_ciphersuite *cipher_suite,
+		uint8_t               *msg_scalars,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
+// Streaming messages
+// Maps a message of any length to its message scalar, without holding it in
+// memory at once. next is called repeatedly and sets *chunk and *chunk_len to
+// the next part of the message, e.g. read from a file or within a memory map.
+// The chunk has to stay valid until the next call. A chunk_len of zero ends
+// the message. Any other return value than BBS_OK aborts the mapping.
+// Use the message scalar with the _scalars functions below.
+typedef int (*bbs_msg_chunk_fn)(
+		void           *cookie,
+		const uint8_t **chunk,
+		uint64_t       *chunk_len
+	);
+
+int bbs_message_to_scalar_stream(
+		const bbs_ciphersuite *cipher_suite,
+		uint8_t                msg_scalar[BBS_SCALAR_LEN],
+		bbs_msg_chunk_fn       next,
+		void                  *cookie
+	);
+
+// Parallel message mapping
+// Calls with at least min_messages messages hash them on num_threads threads
+// before the curve arithmetic starts: the calling thread, and num_threads - 1
+// workers that are started here and kept until the next call. min_messages
+// should be large enough for the hashing to outweigh handing it to the
+// workers, i.e. in the hundreds. Off by default, and for num_threads <= 1,
+// which also stops the workers. Fails for more than 64 threads, or more than
+// one if the library was built without thread support. The setting is global,
+// but may be changed while other threads map messages.
+int bbs_set_parallel_mapping(
+		uint32_t num_threads,
+		uint64_t min_messages
+	);
+
+// Scratch memory
+// Besides their fixed size state, operations need buffers that grow with the
+// number of messages: for the scalars of disclosed messages, and with
+// parallel mapping for the hashes of all messages. These come from the heap,
+// unless the calling thread has set an arena of len octets at buf. Then
+// signing, verification, and proof generation and verification run without
+// heap allocations, and fail if they need more than the arena. A len of
+// bbs_scratch_size(L) suffices for any call with up to L messages, and is 0 if
+// that does not fit into a size_t. It assumes the worst case of a call, that
+// all messages are disclosed and parallel mapping is on. Every call returns
+// what it took before it returns, so a batch of calls, as in deferred batch
+// verification, needs no more than its largest call. The setting is per
+// thread. buf has to stay valid until the thread sets another arena, or NULL
+// to return to the heap. Context initialization allocates from the heap:
+// bbs_prepared_pk_new always, and bbs_proof_verifier_init for the disclosed
+// indexes it keeps until bbs_proof_verifier_free.
+int bbs_set_scratch(
+		void  *buf,
+		size_t len
+	);
+size_t bbs_scratch_size(
+		uint64_t num_messages
+	);
+
 // Signing
 int bbs_sign(
-		const bbs_secret_key  sk,
-		const bbs_public_key  pk,
-		bbs_signature         signature,
-		const uint8_t        *header,
-		uint64_t              header_len,
-		uint64_t              num_messages,
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_secret_key   sk,
+		const bbs_public_key   pk,
+		bbs_signature          signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		uint64_t               num_messages,
+		...
+	);
+
+int bbs_sign_scalars(
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_secret_key   sk,
+		const bbs_public_key   pk,
+		bbs_signature          signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		uint64_t               num_messages,
 		...
 	);
 
+int bbs_sign_array(
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_secret_key   sk,
+		const bbs_public_key   pk,
+		bbs_signature          signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
 // Verification
 int bbs_verify(
-		const bbs_public_key  pk,
-		const bbs_signature   signature,
-		const uint8_t        *header,
-		uint64_t        header_len,
-		uint64_t        num_messages,
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		uint64_t               num_messages,
+		...
+	);
+
+int bbs_verify_scalars(
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		uint64_t               num_messages,
 		...
 	);
 
+int bbs_verify_array(
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
 // Proof Generation
 int bbs_proof_gen (
-		const bbs_public_key  pk,
-		const bbs_signature   signature,
-		uint8_t              *proof,
-		const uint8_t        *header,
-		uint64_t              header_len,
-		const uint8_t        *presentation_header,
-		uint64_t              presentation_header_len,
-		const uint64_t       *disclosed_indexes,
-		uint64_t              disclosed_indexes_len,
-		uint64_t              num_messages,
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		uint8_t               *proof,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		...
+	);
+
+int bbs_proof_gen_scalars (
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		uint8_t               *proof,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
 		...
 	);
 
+int bbs_proof_gen_array (
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		uint8_t               *proof,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
 // Proof Verification
 int bbs_proof_verify (
-		const bbs_public_key  pk,
-		const uint8_t        *proof,
-		uint64_t              proof_len,
-		const uint8_t        *header,
-		uint64_t              header_len,
-		const uint8_t        *presentation_header,
-		uint64_t              presentation_header_len,
-		const uint64_t       *disclosed_indexes,
-		uint64_t              disclosed_indexes_len,
-		uint64_t              num_messages,
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const uint8_t         *proof,
+		uint64_t               proof_len,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		...
+	);
+
+int bbs_proof_verify_scalars (
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const uint8_t         *proof,
+		uint64_t               proof_len,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
 		...
 	);
 
+int bbs_proof_verify_array (
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const uint8_t         *proof,
+		uint64_t               proof_len,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
+// Prepared public keys
+// A verifier that sees many signatures or proofs under the same public key can
+// parse and validate it once, including the subgroup check, and keep the hash
+// state of the domain calculation after the key. A prepared key is bound to
+// the ciphersuite it was prepared for, and only read by the functions below,
+// so that threads set up as described under Threads may share it.
+typedef struct bbs_prepared_pk bbs_prepared_pk;
+
+// Allocates *ppk, which is NULL on failure. Fails for public keys that do not
+// pass KeyValidate.
+int bbs_prepared_pk_new(
+		const bbs_ciphersuite *cipher_suite,
+		bbs_prepared_pk      **ppk,
+		const bbs_public_key   pk
+	);
+void bbs_prepared_pk_free(
+		bbs_prepared_pk *ppk
+	);
+
+int bbs_verify_prepared(
+		const bbs_prepared_pk *ppk,
+		const bbs_signature    signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
+int bbs_proof_verify_prepared (
+		const bbs_prepared_pk *ppk,
+		const uint8_t         *proof,
+		uint64_t               proof_len,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
+// Streaming proofs
+// Proofs grow with the number of undisclosed messages. These variants hand
+// the proof to write, or take it from read, in parts of a few hundred octets
+// at a given offset within the proof. Parts do not come in order. Any other
+// return value than BBS_OK aborts the operation. Memory stays constant with
+// the number of messages: the messages are mapped sequentially, also with
+// parallel mapping on, and nothing is taken from a scratch arena. Instead,
+// the messages are read twice, which is why they only take a bbs_messages. The
+// challenge covers the disclosed message scalars, but only after the domain,
+// which needs a full pass over the messages, and each undisclosed response
+// needs the challenge. So verification maps the disclosed messages twice, and
+// generation maps all of them twice.
+typedef int (*bbs_proof_write_fn)(
+		void          *cookie,
+		uint64_t       offset,
+		const uint8_t *data,
+		uint64_t       len
+	);
+
+typedef int (*bbs_proof_read_fn)(
+		void          *cookie,
+		uint64_t       offset,
+		uint8_t       *data,
+		uint64_t       len
+	);
+
+int bbs_proof_gen_stream (
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		bbs_proof_write_fn     write,
+		void                  *cookie,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
+int bbs_proof_verify_stream (
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		bbs_proof_read_fn      read,
+		void                  *cookie,
+		uint64_t               proof_len,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
 #endif
@@ -12,7 +12,6 @@
 #define LEN(m) (sizeof(m) / sizeof(m[0]))
 #define DEBUG(p, a, l) do { puts(p); for(int xx=0;xx<l;xx++) printf("%02x ", a[xx]); puts(""); } while(0);
 
-#define BBS_SCALAR_LEN  32
 #define BBS_G1_ELEM_LEN 48
 #define BBS_G2_ELEM_LEN 96
 
@@ -46,100 +45,316 @@ void ep2_read_bbs(
 		const uint8_t bin[BBS_G2_ELEM_LEN]
 	);
 
+// Scalars
+// Fixed width arithmetic modulo the group order r, as four 64 bit limbs in
+// Montgomery form. This does not go through relic and runs in constant time.
+// Use it for arithmetic on scalars, and convert to bn_t for point
+// multiplication only. Outputs may alias inputs. The inverse of 0 is 0.
+typedef uint64_t sc_t[4];
+
+void sc_zero(
+		sc_t c
+	);
+int sc_is_zero(
+		const sc_t a
+	);
+int sc_cmp(
+		const sc_t a,
+		const sc_t b
+	);
+// Fails for octets that do not encode a value less than r
+int sc_read_bbs(
+		sc_t          c,
+		const uint8_t bin[BBS_SCALAR_LEN]
+	);
+void sc_write_bbs(
+		uint8_t    bin[BBS_SCALAR_LEN],
+		const sc_t a
+	);
+// Reduces 48 octets modulo r, as the last step of hash_to_scalar
+void sc_read_wide(
+		sc_t          c,
+		const uint8_t bin[48]
+	);
+// These two should be called in a RLC_TRY block. a must be less than 2^256.
+void sc_read_bn(
+		sc_t       c,
+		const bn_t a
+	);
+void sc_write_bn(
+		bn_t       c,
+		const sc_t a
+	);
+void sc_add(
+		sc_t       c,
+		const sc_t a,
+		const sc_t b
+	);
+void sc_sub(
+		sc_t       c,
+		const sc_t a,
+		const sc_t b
+	);
+void sc_neg(
+		sc_t       c,
+		const sc_t a
+	);
+void sc_mul(
+		sc_t       c,
+		const sc_t a,
+		const sc_t b
+	);
+void sc_inv(
+		sc_t       c,
+		const sc_t a
+	);
+
+// SHA-256 backends. The fastest one the CPU supports is selected when the
+// library is loaded, and all hashing below goes through it. Switching is meant
+// for testing and benchmarking and is not thread safe. Setting an unsupported
+// backend fails and keeps the current one.
+typedef enum {
+	BBS_SHA256_GENERIC,
+	BBS_SHA256_SHANI,
+	BBS_SHA256_ARMV8,
+} bbs_sha256_backend;
+
+int bbs_sha256_set_backend(
+		bbs_sha256_backend backend
+	);
+bbs_sha256_backend bbs_sha256_get_backend(void);
+
+// ChaCha20 keystream of the proof randomness, see src/bbs_chacha.h. Exposed
+// for the known answer tests.
+void bbs_chacha20_blocks(
+		const uint8_t key[32],
+		uint64_t      nonce,
+		uint64_t      counter,
+		uint8_t      *out,
+		uint64_t      num_blocks
+	);
+
+// Random octets from the generator of the calling thread, see src/bbs_rand.h.
+// Exposed for the tests.
+int bbs_rand_bytes(
+		uint8_t *out,
+		uint64_t out_len
+	);
+
+// SHAKE-256 sponge state, see src/bbs_keccak.h
+typedef struct {
+	uint64_t state[25];
+	uint8_t  pos;
+	uint8_t  squeezing;
+} bbs_shake256_context;
+
+// Incremental hashing state for either ciphersuite
+typedef union {
+	SHA256Context        sha256;
+	bbs_shake256_context shake256;
+} bbs_hash_context;
+
+// A ciphersuite fixes P1, the domain separation tags and the hash function
+// underlying expand_message. expand_message_finalize may be asked for up to
+// 255 * 32 bytes of output.
+struct bbs_ciphersuite {
+	uint8_t        p1[BBS_G1_ELEM_LEN];
+	const uint8_t *default_key_dst;
+	uint8_t        default_key_dst_len;
+	const uint8_t *api_id;
+	uint8_t        api_id_len;
+	const uint8_t *signature_dst;
+	uint8_t        signature_dst_len;
+	const uint8_t *challenge_dst;
+	uint8_t        challenge_dst_len;
+	const uint8_t *map_dst;
+	uint8_t        map_dst_len;
+	int (*expand_message_init)(
+		bbs_hash_context *ctx
+		);
+	int (*expand_message_update)(
+		bbs_hash_context *ctx,
+		const uint8_t    *msg,
+		uint64_t          msg_len
+		);
+	int (*expand_message_finalize)(
+		bbs_hash_context *ctx,
+		uint8_t          *out,
+		uint16_t          out_len,
+		const uint8_t    *dst,
+		uint8_t           dst_len
+		);
+};
+
 // The following functions are provided as an incremental and as a one-shot API.
 // The varargs for the one-shot API consist of several of the non context
 // arguments of the corresponding update function, in order, terminated by a
 // NULL value.
 // E.g. if update takes inputs (ctx, a, b), then varargs for the one-shot API
 // are (a1, b1, a2, b2, ..., an, bn, 0).
-// Array types (e.g. ep_t) are given by reference to the one-shot API
+// Array types (e.g. ep_t) are given by reference to the one-shot API.
+// Message lengths are uint64_t for the update functions, but uint32_t in the
+// varargs, where longer messages need the incremental API.
 
-// Implementation of expand_message with expand_len = 48
-// relic implements this as md_xmd, but here we built it with an incremental API
-// or varargs for the message
+// Implementation of expand_message with expand_len = 48, i.e.
+// expand_message_xmd with SHA-256 or expand_message_xof with SHAKE-256,
+// depending on the ciphersuite.
+// relic implements the former as md_xmd, but here we built it with an
+// incremental API or varargs for the message
 int expand_message_init(
-		SHA256Context *ctx
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx
 	);
 int expand_message_update(
-		SHA256Context *ctx,
-		const uint8_t *msg,
-		uint32_t       msg_len
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx,
+		const uint8_t         *msg,
+		uint64_t               msg_len
 	);
 int expand_message_finalize(
-		SHA256Context *ctx,
-		uint8_t        out[48],
-		const uint8_t *dst,
-		uint8_t        dst_len
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx,
+		uint8_t                out[48],
+		const uint8_t         *dst,
+		uint8_t                dst_len
+	);
+// As above, but for any expand_len up to 255 * 32
+int expand_message_finalize_len(
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx,
+		uint8_t               *out,
+		uint16_t               out_len,
+		const uint8_t         *dst,
+		uint8_t                dst_len
 	);
 int expand_message(
-		uint8_t        out[48],
-		const uint8_t *dst,
-		uint8_t        dst_len,
+		const bbs_ciphersuite *cipher_suite,
+		uint8_t                out[48],
+		const uint8_t         *dst,
+		uint8_t                dst_len,
 		...
 	);
 
 // Hash to Scalar
 int hash_to_scalar_init(
-		SHA256Context *ctx
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx
 	);
 int hash_to_scalar_update(
-		SHA256Context *ctx,
-		const uint8_t *msg,
-		uint32_t       msg_len
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx,
+		const uint8_t         *msg,
+		uint64_t               msg_len
 	);
 int hash_to_scalar_finalize(
-		SHA256Context *ctx,
-		bn_t           out,
-		const uint8_t *dst,
-		uint8_t        dst_len
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx,
+		bn_t                   out,
+		const uint8_t         *dst,
+		uint8_t                dst_len
 	);
 int hash_to_scalar(
-		bn_t           out,
-		const uint8_t *dst,
-		uint8_t        dst_len,
+		const bbs_ciphersuite *cipher_suite,
+		bn_t                   out,
+		const uint8_t         *dst,
+		uint8_t                dst_len,
 		...
 	);
 
+// Hash to Scalar for a single message under a fixed DST, e.g. the message
+// mapping DST. For the SHA-256 ciphersuite, init prepares the DST-dependent
+// blocks once. Messages short enough for b_0 to fit into two blocks
+// (msg_len + dst_len <= 115) are then hashed on fixed-layout buffers, without
+// the incremental buffering of expand_message. The compression count stays
+// the same: one or two each for b_0, b_1 and b_2 after the precomputed Z_pad
+// block, which is six for the 70 byte message mapping DST. Longer messages
+// fall back to the incremental expand_message, and so does every message for
+// ciphersuites not built on expand_message_xmd. Lengths are uint64_t, so that
+// this covers messages beyond the uint32_t of the varargs. The DST is
+// referenced, not copied, and must be at most 85 bytes long.
+typedef struct {
+	const bbs_ciphersuite *cipher_suite;
+	const uint8_t         *dst;
+	uint8_t                dst_len;
+	uint8_t                b_i_blocks;
+	uint8_t                b_i_tmpl[128];
+} hash_to_scalar_fixed_dst;
+
+int hash_to_scalar_fixed_init(
+		const bbs_ciphersuite    *cipher_suite,
+		hash_to_scalar_fixed_dst *fdst,
+		const uint8_t            *dst,
+		uint8_t                   dst_len
+	);
+int hash_to_scalar_fixed(
+		const hash_to_scalar_fixed_dst *fdst,
+		bn_t                            out,
+		const uint8_t                  *msg,
+		uint64_t                        msg_len
+	);
+
+// Maps num messages to out[0], ..., out[num - 1] like hash_to_scalar_fixed.
+// For the SHA-256 ciphersuite, the independent hash chains of up to 16
+// messages are computed side by side with multi-buffer SHA-256, using AVX2 or
+// AVX-512 if the CPU supports it and they are faster than the selected
+// SHA-256 backend.
+int hash_to_scalar_batch(
+		const hash_to_scalar_fixed_dst *fdst,
+		bn_t                           *out,
+		const uint8_t *const           *msgs,
+		const uint64_t                 *msg_lens,
+		uint64_t                        num
+	);
+
+// As hash_to_scalar_batch, but stops short of the reduction and writes the 48
+// octets of expand_message output per message to uniform. Unlike everything
+// else here, this does not touch relic and may run on several threads at once.
+int hash_to_scalar_batch_expand(
+		const hash_to_scalar_fixed_dst *fdst,
+		uint8_t                         uniform[][48],
+		const uint8_t *const           *msgs,
+		const uint64_t                 *msg_lens,
+		uint64_t                        num
+	);
+
 // you need to call update exactly num_messages + 1 times.
 int calculate_domain_init(
-		SHA256Context *ctx,
-		const uint8_t  pk[BBS_PK_LEN],
-		uint64_t       num_messages
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx,
+		const uint8_t          pk[BBS_PK_LEN],
+		uint64_t               num_messages
 	);
 int calculate_domain_update(
-		SHA256Context *ctx,
-		const ep_t     generator
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx,
+		const ep_t             generator
 	);
 int calculate_domain_finalize(
-		SHA256Context *ctx,
-		bn_t           out,
-		const uint8_t *header,
-		uint64_t       header_len,
-		const uint8_t *api_id,
-		uint8_t        api_id_len
+		const bbs_ciphersuite *cipher_suite,
+		bbs_hash_context      *ctx,
+		bn_t                   out,
+		const uint8_t         *header,
+		uint64_t               header_len
 	);
 int calculate_domain(
-		bn_t           out,
-		const uint8_t  pk[BBS_PK_LEN],
-		uint64_t       num_messages,
-		const uint8_t *header,
-		uint64_t       header_len,
-		const uint8_t *api_id,
-		uint8_t        api_id_len,
+		const bbs_ciphersuite *cipher_suite,
+		bn_t                   out,
+		const uint8_t          pk[BBS_PK_LEN],
+		uint64_t               num_messages,
+		const uint8_t         *header,
+		uint64_t               header_len,
 		...
 	);
 
-// Always supply the same api_id to next as you did to init
+// Generators are derived from the api_id of the ciphersuite
 int create_generator_init(
-		uint8_t        state[48 + 8],
-		const uint8_t *api_id,
-		uint8_t        api_id_len
+		const bbs_ciphersuite *cipher_suite,
+		uint8_t                state[48 + 8]
 	);
 int create_generator_next(
-		uint8_t        state[48 + 8],
-		ep_t           generator,
-		const uint8_t *api_id,
-		uint8_t        api_id_len
+		const bbs_ciphersuite *cipher_suite,
+		uint8_t                state[48 + 8],
+		ep_t                   generator
 	);
 
 // You can control the randomness for bbs_proof_gen by supplying a prf.
@@ -152,23 +367,427 @@ int create_generator_next(
 // message scalar, other scalars have input 0 and input_type i indicates the
 // i-th such scalar. This is because there may be up to 2^64 messages, bringing
 // the total possible message count slightly above 2^64.
+typedef enum {
+	BBS_PRF_MSG_SCALAR,
+	BBS_PRF_R1,
+	BBS_PRF_R2,
+	BBS_PRF_E_TILDE,
+	BBS_PRF_R1_TILDE,
+	BBS_PRF_R3_TILDE,
+	BBS_PRF_NUM_INPUT_TYPES,
+} bbs_prf_input_type;
+
 typedef int(bbs_bn_prf)(bn_t out, uint8_t input_type, uint64_t input, void* cookie);
 
 // Defined in bbs.c, but included here to hide it from bbs.h importers
 int bbs_proof_gen_det (
-		const bbs_public_key  pk,
-		const bbs_signature   signature,
+		const bbs_ciphersuite *cipher_suite,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		uint8_t               *proof,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		bbs_bn_prf             prf,
+		void                  *prf_cookie,
+		va_list                ap
+	);
+
+// Signer contexts
+// An issuer that signs many credentials under the same key and header, and
+// with the same number of messages, can derive the generators, the domain and
+// P1 + Q_1 * domain once. Signing with the context then maps the messages,
+// computes one multi-scalar multiplication and inverts SK + e, and yields the
+// same signatures as bbs_sign. generators needs room for num_messages points
+// and has to outlive the signer. The signer holds the secret key until it is
+// freed, which is also required if initialization fails. Like all contexts
+// below, it takes the messages as a bbs_messages, see bbs.h.
+typedef struct {
+	const bbs_ciphersuite *cipher_suite;
+	sc_t                   sk;
+	bbs_hash_context       e_ctx;
+	ep_t                   B;
+	ep_t                  *generators;
+	uint64_t               num_messages;
+} bbs_signer;
+
+int bbs_signer_init(
+		const bbs_ciphersuite *cipher_suite,
+		bbs_signer            *signer,
+		const bbs_secret_key   sk,
+		const bbs_public_key   pk,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		ep_t                  *generators,
+		uint64_t               num_messages
+	);
+void bbs_signer_free(
+		bbs_signer *signer
+	);
+// num_messages has to match the one the signer was initialized with
+int bbs_signer_sign(
+		const bbs_signer   *signer,
+		bbs_signature       signature,
+		uint64_t            num_messages,
+		const bbs_messages *messages
+	);
+
+// Re-signing
+// When a credential is reissued with a few changed messages, e.g. an expiry
+// date or a status flag, only some terms of B change. A re-issuer keeps B for
+// the current messages of one credential together with their scalars, and
+// updating k messages costs k point multiplications instead of a
+// multi-scalar multiplication over all of them. bbs_reissuer_sign then only
+// hashes the scalars and inverts SK + e, and yields the same signature as
+// bbs_signer_sign for the current messages. scalars needs room for
+// num_messages * BBS_SCALAR_LEN octets. It and the signer have to outlive the
+// re-issuer, which the caller has to free, also if initialization fails. A
+// failed update leaves the re-issuer unchanged. An index may be updated more
+// than once per call, the last message counts. The new scalars are kept aside
+// until the update succeeded, which needs bbs_scratch_size(num_updates) on a
+// scratch arena.
+typedef struct {
+	const bbs_signer *signer;
+	ep_t              B;
+	uint8_t          *scalars;
+} bbs_reissuer;
+
+// num_messages has to match the one the signer was initialized with
+int bbs_reissuer_init(
+		bbs_reissuer       *reissuer,
+		const bbs_signer   *signer,
+		uint8_t            *scalars,
+		uint64_t            num_messages,
+		const bbs_messages *messages
+	);
+void bbs_reissuer_free(
+		bbs_reissuer *reissuer
+	);
+// Replaces the messages at indexes with the num_updates messages in messages
+int bbs_reissuer_update(
+		bbs_reissuer       *reissuer,
+		uint64_t            num_updates,
+		const uint64_t     *indexes,
+		const bbs_messages *messages
+	);
+int bbs_reissuer_sign(
+		const bbs_reissuer *reissuer,
+		bbs_signature       signature
+	);
+
+// Signer templates
+// Credentials of one kind often share a block of identical messages at fixed
+// indexes, e.g. issuer metadata, schema URIs or policy flags. A template maps
+// these once and adds their terms to B, so that signing with it only maps and
+// multiplies the variable messages. Signatures equal those of
+// bbs_signer_sign for the complete list of messages. fixed_indexes has to be
+// sorted in ascending order and fixed_scalars needs room for
+// num_fixed * BBS_SCALAR_LEN octets. Both and the signer have to outlive the
+// template, which the caller has to free, also if initialization fails.
+typedef struct {
+	const bbs_signer *signer;
+	ep_t              B;
+	const uint64_t   *fixed_indexes;
+	uint8_t          *fixed_scalars;
+	uint64_t          num_fixed;
+} bbs_signer_template;
+
+// messages holds the fixed messages, in the order of fixed_indexes
+int bbs_signer_template_init(
+		bbs_signer_template *tmpl,
+		const bbs_signer    *signer,
+		uint8_t             *fixed_scalars,
+		uint64_t             num_fixed,
+		const uint64_t      *fixed_indexes,
+		const bbs_messages  *messages
+	);
+void bbs_signer_template_free(
+		bbs_signer_template *tmpl
+	);
+// Takes the num_messages variable messages, in the order of their indexes
+int bbs_signer_template_sign(
+		const bbs_signer_template *tmpl,
+		bbs_signature              signature,
+		uint64_t                   num_messages,
+		const bbs_messages        *messages
+	);
+
+// Offline/online proof generation
+// Everything in a proof but the responses is independent of the presentation
+// header. bbs_proof_gen_offline does all curve arithmetic for a signature and
+// a set of disclosed messages ahead of time, e.g. while the wallet is idle,
+// and writes Abar, Bbar and D to proof. The rest of proof keeps the
+// undisclosed message scalars, so until the online step succeeds, proof holds
+// secrets just like the precomputation. bbs_proof_gen_online then hashes the
+// presentation header into the challenge and completes proof, which has to be
+// the same buffer and still untouched. The precomputation is good for a
+// single online step, which clears it whatever the outcome, and also wipes
+// the message scalars from proof if it fails. Use bbs_proof_precomp_free to
+// discard an unused precomputation along with them.
+typedef struct {
+	const bbs_ciphersuite *cipher_suite;
+	uint8_t               *proof;
+	uint64_t               undisclosed_indexes_len;
+	bbs_hash_context       ch_ctx;
+	sc_t                   e, r1, r3, e_tilde, r1_tilde, r3_tilde;
+	uint8_t                seed[32];
+	int                    ready;
+} bbs_proof_precomp;
+
+int bbs_proof_gen_offline(
+		const bbs_ciphersuite *cipher_suite,
+		bbs_proof_precomp     *precomp,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		uint8_t               *proof,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+int bbs_proof_gen_online(
+		bbs_proof_precomp *precomp,
+		const uint8_t     *presentation_header,
+		uint64_t           presentation_header_len
+	);
+void bbs_proof_precomp_free(
+		bbs_proof_precomp *precomp
+	);
+
+// Holder credentials
+// A holder that presents the same signature many times can map the messages,
+// derive the generators and compute B and the domain once. Proofs from the
+// credential then only cost the randomized part of proof generation, and are
+// distributed exactly like those of bbs_proof_gen. The signature is not
+// verified here, use bbs_verify for that. generators needs room for
+// num_messages points and scalars for num_messages * BBS_SCALAR_LEN octets.
+// Both have to outlive the credential, which the caller has to free, also if
+// initialization fails. Freeing wipes the message scalars. An initialized
+// credential is only read by proof generation, so that threads with their own
+// relic context, see Threads in bbs.h, may share it.
+typedef struct {
+	const bbs_ciphersuite *cipher_suite;
+	ep_t                   A;
+	bn_t                   e;
+	ep_t                   B;
+	uint8_t                domain[BBS_SCALAR_LEN];
+	ep_t                  *generators;
+	uint8_t               *scalars;
+	uint64_t               num_messages;
+} bbs_credential;
+
+int bbs_credential_init(
+		const bbs_ciphersuite *cipher_suite,
+		bbs_credential        *cred,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		ep_t                  *generators,
+		uint8_t               *scalars,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+void bbs_credential_free(
+		bbs_credential *cred
+	);
+// Disclosed indexes have to be sorted in ascending order
+int bbs_credential_proof_gen(
+		const bbs_credential *cred,
+		uint8_t              *proof,
+		const uint8_t        *presentation_header,
+		uint64_t              presentation_header_len,
+		const uint64_t       *disclosed_indexes,
+		uint64_t              disclosed_indexes_len
+	);
+// Complete the proof with bbs_proof_gen_online
+int bbs_credential_proof_gen_offline(
+		const bbs_credential *cred,
+		bbs_proof_precomp    *precomp,
+		uint8_t              *proof,
+		const uint64_t       *disclosed_indexes,
+		uint64_t              disclosed_indexes_len
+	);
+// bbs_credential_proof_gen with randomness from prf, like bbs_proof_gen_det
+int bbs_credential_proof_gen_det(
+		const bbs_credential *cred,
 		uint8_t              *proof,
-		const uint8_t        *header,
-		uint64_t              header_len,
 		const uint8_t        *presentation_header,
 		uint64_t              presentation_header_len,
 		const uint64_t       *disclosed_indexes,
 		uint64_t              disclosed_indexes_len,
-		uint64_t              num_messages,
 		bbs_bn_prf            prf,
-		void                 *prf_cookie,
-		va_list               ap
+		void                 *prf_cookie
+	);
+
+// Deferred pairing checks
+// Signature and proof verification end in a pairing equation of the form
+// e(A, W) * e(B, -BP2) == 1. The _deferred variants perform all hashing and
+// G1 work, but hand out the pending (A, B, W) tuple instead of evaluating it.
+// This lets you combine the checks of several credentials, possibly from
+// different issuers, and pay for a single final exponentiation.
+typedef struct {
+	ep_t  A;
+	ep_t  B;
+	ep2_t W;
+} bbs_pairing_check;
+
+int bbs_pairing_check_init(
+		bbs_pairing_check *check
+	);
+void bbs_pairing_check_free(
+		bbs_pairing_check *check
+	);
+int bbs_pairing_check_eval(
+		const bbs_pairing_check *check
+	);
+
+// The signature is only valid if the check evaluates successfully.
+int bbs_verify_deferred (
+		const bbs_ciphersuite *cipher_suite,
+		bbs_pairing_check     *check,
+		const bbs_public_key   pk,
+		const bbs_signature    signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		uint64_t               num_messages,
+		...
+	);
+
+// Returns BBS_OK if the proof of knowledge is valid and the check was written.
+// The proof is only valid if the check evaluates successfully as well.
+int bbs_proof_verify_deferred (
+		const bbs_ciphersuite *cipher_suite,
+		bbs_pairing_check     *check,
+		const bbs_public_key   pk,
+		const uint8_t         *proof,
+		uint64_t               proof_len,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		...
+	);
+
+// Prepared public keys, see bbs.h. A proof verifier embeds one.
+struct bbs_prepared_pk {
+	const bbs_ciphersuite *cipher_suite;
+	bbs_public_key         pk;
+	ep2_t                  W;
+	bbs_hash_context       dom_ctx;
+};
+
+int bbs_verify_deferred_prepared (
+		bbs_pairing_check     *check,
+		const bbs_prepared_pk *ppk,
+		const bbs_signature    signature,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
+int bbs_proof_verify_deferred_prepared (
+		bbs_pairing_check     *check,
+		const bbs_prepared_pk *ppk,
+		const uint8_t         *proof,
+		uint64_t               proof_len,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint8_t         *presentation_header,
+		uint64_t               presentation_header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		uint64_t               num_messages,
+		const bbs_messages    *messages
+	);
+
+// Proof verifier contexts
+// A relying party that always expects the same disclosed indexes out of
+// credentials with the same public key, header and number of messages can
+// validate the index set, derive the generators, the domain and P1 + Q_1 *
+// domain once. Verifying with the context then only maps the disclosed
+// messages and computes T1 and T2 as multi-scalar multiplications. The
+// disclosed indexes may be given in any order, the disclosed messages are
+// always given in increasing index order. generators needs room for
+// num_messages points and has to outlive the verifier. Free the verifier even
+// if initialization fails.
+typedef struct {
+	bbs_prepared_pk ppk;
+	uint64_t        num_messages;
+	uint64_t        disclosed_indexes_len;
+	uint8_t        *index_octets;
+	uint8_t         domain[BBS_SCALAR_LEN];
+	ep_t            Bv;
+	ep_t           *generators;
+} bbs_proof_verifier;
+
+int bbs_proof_verifier_init(
+		const bbs_ciphersuite *cipher_suite,
+		bbs_proof_verifier    *verifier,
+		const bbs_public_key   pk,
+		const uint8_t         *header,
+		uint64_t               header_len,
+		const uint64_t        *disclosed_indexes,
+		uint64_t               disclosed_indexes_len,
+		ep_t                  *generators,
+		uint64_t               num_messages
+	);
+void bbs_proof_verifier_free(
+		bbs_proof_verifier *verifier
+	);
+// num_messages has to match the one the verifier was initialized with
+int bbs_proof_verifier_verify(
+		const bbs_proof_verifier *verifier,
+		const uint8_t            *proof,
+		uint64_t                  proof_len,
+		const uint8_t            *presentation_header,
+		uint64_t                  presentation_header_len,
+		uint64_t                  num_messages,
+		const bbs_messages       *messages
+	);
+
+// Accumulates pending checks into caller-provided storage and evaluates them
+// at once, using random weights. A and W need room for max_checks + 1
+// points, B for max_checks points. Evaluation returns BBS_OK only if all
+// accumulated checks hold, and empties the accumulator.
+// Checks are grouped by public key, so that a batch of checks under a single
+// key costs two Miller loops and one final exponentiation.
+#define BBS_PAIRING_WEIGHT_LEN 16
+
+typedef struct {
+	ep_t    *A;
+	ep_t    *B;
+	ep2_t   *W;
+	uint64_t num_checks;
+	uint64_t max_checks;
+} bbs_pairing_acc;
+
+int bbs_pairing_acc_init(
+		bbs_pairing_acc *acc,
+		ep_t            *A,
+		ep_t            *B,
+		ep2_t           *W,
+		uint64_t         max_checks
+	);
+void bbs_pairing_acc_free(
+		bbs_pairing_acc *acc
+	);
+int bbs_pairing_acc_add(
+		bbs_pairing_acc         *acc,
+		const bbs_pairing_check *check
+	);
+int bbs_pairing_acc_eval(
+		bbs_pairing_acc *acc
 	);
 
 // Big endian conversion
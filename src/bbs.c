@@ -1,44 +1,493 @@
 #include "bbs.h"
 #include "bbs_util.h"
+#include "bbs_sha256.h"
+#include "bbs_chacha.h"
+#include "bbs_rand.h"
 #include <relic.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef BBS_THREADS
+#include <pthread.h>
+#endif
 
-// Magic constants to be used as Domain Separation Tags
-#define BBS_SHA_256_CIPHER_ID       "BBS_BLS12381G1_XMD:SHA-256_SSWU_RO_"
-#define BBS_SHA_256_DEFAULT_KEY_DST BBS_SHA_256_CIPHER_ID "KEYGEN_DST_"
-#define BBS_SHA_256_API_ID          BBS_SHA_256_CIPHER_ID "H2G_HM2S_"
-#define BBS_SHA_256_SIGNATURE_DST   BBS_SHA_256_API_ID "H2S_"
-#define BBS_SHA_256_CHALLENGE_DST   BBS_SHA_256_API_ID "H2S_"
-#define BBS_SHA_256_MAP_DST         BBS_SHA_256_API_ID "MAP_MSG_TO_SCALAR_AS_HASH_"
-// The above collision stems from the ID. Possible oversight? Should not compromise
-// security too much...
-
-// Point for the SHA suite
-static uint8_t P1[] = {
-	0xa8, 0xce, 0x25, 0x61, 0x02, 0x84, 0x08, 0x21, 0xa3, 0xe9, 0x4e, 0xa9, 0x02, 0x5e, 0x46,
-	0x62, 0xb2, 0x05, 0x76, 0x2f, 0x97, 0x76, 0xb3, 0xa7, 0x66, 0xc8, 0x72, 0xb9, 0x48, 0xf1,
-	0xfd, 0x22, 0x5e, 0x7c, 0x59, 0x69, 0x85, 0x88, 0xe7, 0x0d, 0x11, 0x40, 0x6d, 0x16, 0x1b,
-	0x4e, 0x28, 0xc9
+// Number of points per multi-scalar multiplication. Bounds the stack usage
+// of batch evaluations.
+#define BBS_MSM_CHUNK_LEN 32
+
+// Message scalars are computed ahead of their use, in batches of this many
+// messages read from the varargs, so that hash_to_scalar_batch can hash them
+// side by side.
+#define BBS_MSG_BATCH_LEN 16
+
+// Upper bound for bbs_set_parallel_mapping
+#define BBS_MAX_MAPPING_THREADS 64
+
+// Parallel message mapping is off until bbs_set_parallel_mapping is called.
+// With thread support, both settings are guarded by the lock of the pool.
+static uint32_t mapping_threads      = 1;
+static uint64_t mapping_min_messages = UINT64_MAX;
+
+// Temporary buffers come from the heap, or from the top of the calling
+// thread's arena once bbs_set_scratch is called
+typedef struct {
+	uint8_t *buf;
+	size_t   len;
+	size_t   used;
+} bbs_scratch;
+
+static _Thread_local bbs_scratch scratch;
+
+
+// Does not fall back to the heap if the arena is exhausted, so that a set
+// arena is all the memory an operation uses. Aligned for pointers.
+static void*
+bbs_scratch_alloc (
+	size_t len
+	)
+{
+	uintptr_t top, start;
+
+	if (! scratch.buf)
+		return malloc (len);
+
+	top   = (uintptr_t) (scratch.buf + scratch.used);
+	start = (top + 7) & ~(uintptr_t) 7;
+	if (start - top > scratch.len - scratch.used ||
+	    len > scratch.len - scratch.used - (start - top))
+	{
+		return NULL;
+	}
+	scratch.used += start - top + len;
+	return (void*) start;
+}
+
+
+// Releases ptr and, from an arena, everything allocated after it. An
+// operation has to be done with all of its later buffers by then.
+static void
+bbs_scratch_free (
+	void *ptr
+	)
+{
+	if (! scratch.buf)
+	{
+		free (ptr);
+		return;
+	}
+	if ((uint8_t*) ptr >= scratch.buf && (uint8_t*) ptr < scratch.buf + scratch.used)
+		scratch.used = (uint8_t*) ptr - scratch.buf;
+}
+
+// Messages are either octet strings, given as (uint8_t*, uint32_t) varargs, or
+// message scalars, given as a single uint8_t* to BBS_SCALAR_LEN octets each.
+// They are read from ap, or from the msgs and msg_lens arrays if msgs is set.
+// Array lengths are size_t, and may exceed the uint32_t of the varargs.
+// Arrays can be read more than once, and the sorted entries in skip are left
+// out. If pick is set, only the array entries it lists are read, in its order.
+// Streaming operations set stream, which keeps their memory independent of
+// the number of messages: they map sequentially, and read arrays again
+// rather than keep scalars.
+typedef struct {
+	int                   msg_scalars;
+	int                   stream;
+	va_list              *ap;
+	const uint8_t *const *msgs;
+	const size_t         *msg_lens;
+	const uint64_t       *skip;
+	uint64_t              skip_len;
+	const uint64_t       *pick;
+} bbs_msg_source;
+
+// Messages are hashed a batch at a time into expanded, or with parallel
+// mapping all at once into uniform, and only reduced to scalars one by one.
+// Scalars stay sc_t, callers convert them to bn_t for point multiplication.
+typedef struct {
+	hash_to_scalar_fixed_dst map_dst;
+	uint8_t                  expanded[BBS_MSG_BATCH_LEN][48];
+	uint8_t                (*uniform)[48];
+	uint64_t                 pos;
+	uint64_t                 len;
+	uint64_t                 remaining;
+	bbs_msg_source           src;
+	uint64_t                 next;
+	uint64_t                 skip_pos;
+} bbs_msg_batch;
+
+
+static int
+bbs_msg_batch_init (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_msg_batch         *batch,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	int res = BBS_ERROR;
+
+	batch->uniform     = NULL;
+	batch->pos         = 0;
+	batch->len         = 0;
+	batch->remaining   = num_messages;
+	batch->src         = *src;
+	batch->next        = 0;
+	batch->skip_pos    = 0;
+
+	if (BBS_OK != hash_to_scalar_fixed_init (cipher_suite, &batch->map_dst,
+						 cipher_suite->map_dst, cipher_suite->map_dst_len))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+static void
+bbs_msg_batch_free (
+	bbs_msg_batch *batch
+	)
+{
+	bbs_scratch_free (batch->uniform);
+}
+
+
+// Reads the next message from the varargs or the arrays. For message scalars,
+// msg_len is set to 0.
+static int
+bbs_msg_batch_read (
+	bbs_msg_batch  *batch,
+	const uint8_t **msg,
+	uint64_t       *msg_len
+	)
+{
+	int res = BBS_ERROR;
+
+	if (! batch->src.msgs)
+	{
+		*msg     = va_arg (*batch->src.ap, uint8_t*);
+		*msg_len = batch->src.msg_scalars ? 0 : va_arg (*batch->src.ap, uint32_t);
+		res      = BBS_OK;
+		goto cleanup;
+	}
+	if (batch->src.pick)
+	{
+		*msg     = batch->src.msgs[batch->src.pick[batch->next]];
+		*msg_len = batch->src.msg_scalars ? 0 :
+			   batch->src.msg_lens[batch->src.pick[batch->next]];
+		batch->next++;
+		res      = BBS_OK;
+		goto cleanup;
+	}
+
+	while (batch->skip_pos < batch->src.skip_len &&
+	       batch->src.skip[batch->skip_pos] == batch->next)
+	{
+		batch->skip_pos++;
+		batch->next++;
+	}
+	*msg     = batch->src.msgs[batch->next];
+	*msg_len = batch->src.msg_scalars ? 0 : batch->src.msg_lens[batch->next];
+	batch->next++;
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+#ifdef BBS_THREADS
+typedef struct bbs_mapping_job {
+	const hash_to_scalar_fixed_dst *map_dst;
+	uint8_t                       (*uniform)[48];
+	const uint8_t *const           *msgs;
+	const uint64_t                 *msg_lens;
+	uint64_t                        num;
+	int                             res;
+	int                             done;
+	struct bbs_mapping_job         *next;
+} bbs_mapping_job;
+
+// The workers live from one bbs_set_parallel_mapping call to the next and
+// take jobs off a queue. Callers queue their jobs and then work on the queue
+// themselves until all of their jobs are done, so that no job waits for a
+// worker that could not be started or is being stopped.
+static struct {
+	pthread_mutex_t  lock;
+	pthread_mutex_t  resize;
+	pthread_cond_t   queued;
+	pthread_cond_t   finished;
+	bbs_mapping_job *head;
+	bbs_mapping_job *tail;
+	pthread_t        workers[BBS_MAX_MAPPING_THREADS];
+	uint32_t         num_workers;
+	int              stop;
+} mapping_pool = {
+	.lock     = PTHREAD_MUTEX_INITIALIZER,
+	.resize   = PTHREAD_MUTEX_INITIALIZER,
+	.queued   = PTHREAD_COND_INITIALIZER,
+	.finished = PTHREAD_COND_INITIALIZER,
 };
 
+
+// Takes the next job off the queue, if any. The pool lock is held.
+static bbs_mapping_job*
+bbs_mapping_pop (void)
+{
+	bbs_mapping_job *job = mapping_pool.head;
+
+	if (job)
+	{
+		mapping_pool.head = job->next;
+		if (! mapping_pool.head)
+			mapping_pool.tail = NULL;
+	}
+	return job;
+}
+
+
+// Hashes the messages of a job with the pool lock released. The lock is held
+// on entry and on return.
+static void
+bbs_mapping_run (
+	bbs_mapping_job *job
+	)
+{
+	pthread_mutex_unlock (&mapping_pool.lock);
+	job->res = hash_to_scalar_batch_expand (job->map_dst, job->uniform, job->msgs,
+						job->msg_lens, job->num);
+	pthread_mutex_lock (&mapping_pool.lock);
+	job->done = 1;
+	pthread_cond_broadcast (&mapping_pool.finished);
+}
+
+
+static void*
+bbs_mapping_worker (
+	void *arg
+	)
+{
+	bbs_mapping_job *job;
+
+	(void) arg;
+	pthread_mutex_lock (&mapping_pool.lock);
+	while (! mapping_pool.stop)
+	{
+		job = bbs_mapping_pop ();
+		if (job)
+			bbs_mapping_run (job);
+		else
+			pthread_cond_wait (&mapping_pool.queued, &mapping_pool.lock);
+	}
+	pthread_mutex_unlock (&mapping_pool.lock);
+	return NULL;
+}
+#endif
+
+
+// Number of threads to map num messages on
+static uint32_t
+bbs_mapping_threads (
+	uint64_t num
+	)
+{
+	uint32_t num_threads = 1;
+
+#ifdef BBS_THREADS
+	pthread_mutex_lock (&mapping_pool.lock);
+	if (num >= mapping_min_messages)
+		num_threads = mapping_threads;
+	pthread_mutex_unlock (&mapping_pool.lock);
+#else
+	(void) num;
+#endif
+	return num_threads;
+}
+
+
+// Reads all remaining messages and hashes them on num_threads threads, the
+// calling thread and the workers of the pool. Only the hashing runs
+// concurrently, the reduction to scalars is left to bbs_msg_batch_next.
+static int
+bbs_msg_batch_map_parallel (
+	bbs_msg_batch *batch,
+	uint32_t       num_threads
+	)
+{
+	const uint8_t **msgs     = NULL;
+	uint64_t       *msg_lens = NULL;
+	uint64_t        num      = batch->remaining;
+	int             res      = BBS_ERROR;
+#ifdef BBS_THREADS
+	bbs_mapping_job  jobs[BBS_MAX_MAPPING_THREADS];
+	bbs_mapping_job *job;
+	uint64_t         num_jobs = 0, slice_len, first = 0;
+#else
+	(void) num_threads;
+#endif
+
+	// uniform outlives the other two, so it goes first on an arena
+	batch->uniform = bbs_scratch_alloc (num * sizeof(*batch->uniform));
+	if (! batch->uniform)
+		goto cleanup;
+	msgs     = bbs_scratch_alloc (num * sizeof(*msgs));
+	msg_lens = bbs_scratch_alloc (num * sizeof(*msg_lens));
+	if (! msgs || ! msg_lens)
+		goto cleanup;
+
+	for (uint64_t i = 0; i < num; i++)
+		if (BBS_OK != bbs_msg_batch_read (batch, &msgs[i], &msg_lens[i]))
+			goto cleanup;
+	batch->remaining = 0;
+	batch->len       = num;
+	batch->pos       = 0;
+
+#ifdef BBS_THREADS
+	// Slices are whole multiples of the multi-buffer width
+	slice_len = (num + num_threads - 1) / num_threads;
+	slice_len = (slice_len + BBS_SHA256_MAX_LANES - 1) / BBS_SHA256_MAX_LANES *
+		    BBS_SHA256_MAX_LANES;
+	for (; first < num; num_jobs++)
+	{
+		jobs[num_jobs].map_dst  = &batch->map_dst;
+		jobs[num_jobs].uniform  = batch->uniform + first;
+		jobs[num_jobs].msgs     = msgs + first;
+		jobs[num_jobs].msg_lens = msg_lens + first;
+		jobs[num_jobs].num      = num - first < slice_len ? num - first : slice_len;
+		jobs[num_jobs].res      = BBS_ERROR;
+		jobs[num_jobs].done     = 0;
+		jobs[num_jobs].next     = NULL;
+		first                  += jobs[num_jobs].num;
+	}
+
+	// The first job is ours, the others go to the pool. Jobs of other
+	// callers taken off the queue meanwhile are run like our own.
+	pthread_mutex_lock (&mapping_pool.lock);
+	for (uint64_t t = 1; t < num_jobs; t++)
+	{
+		if (mapping_pool.tail)
+			mapping_pool.tail->next = &jobs[t];
+		else
+			mapping_pool.head = &jobs[t];
+		mapping_pool.tail = &jobs[t];
+	}
+	pthread_cond_broadcast (&mapping_pool.queued);
+	bbs_mapping_run (&jobs[0]);
+	for (uint64_t t = 1; t < num_jobs; t++)
+	{
+		while (! jobs[t].done)
+		{
+			job = bbs_mapping_pop ();
+			if (job)
+				bbs_mapping_run (job);
+			else
+				pthread_cond_wait (&mapping_pool.finished, &mapping_pool.lock);
+		}
+	}
+	pthread_mutex_unlock (&mapping_pool.lock);
+
+	for (uint64_t t = 0; t < num_jobs; t++)
+		if (BBS_OK != jobs[t].res)
+			goto cleanup;
+#else
+	if (BBS_OK != hash_to_scalar_batch_expand (&batch->map_dst, batch->uniform, msgs,
+						   msg_lens, num))
+	{
+		goto cleanup;
+	}
+#endif
+
+	res = BBS_OK;
+cleanup:
+	bbs_scratch_free (msg_lens);
+	bbs_scratch_free (msgs);
+	return res;
+}
+
+
+// Writes the scalar of the next message, reading a new batch of messages once
+// the current one is used up
+static int
+bbs_msg_batch_next (
+	bbs_msg_batch *batch,
+	sc_t           msg_scalar
+	)
+{
+	const uint8_t *msgs[BBS_MSG_BATCH_LEN];
+	uint64_t       msg_lens[BBS_MSG_BATCH_LEN];
+	uint32_t       num_threads;
+	int            res = BBS_ERROR;
+
+	// Message scalars are not worth batching
+	if (batch->src.msg_scalars)
+	{
+		if (0 == batch->remaining)
+			goto cleanup;
+		batch->remaining--;
+		if (BBS_OK != bbs_msg_batch_read (batch, &msgs[0], &msg_lens[0]))
+			goto cleanup;
+		return sc_read_bbs (msg_scalar, msgs[0]);
+	}
+
+	if (batch->pos == batch->len)
+	{
+		if (0 == batch->remaining)
+			goto cleanup;
+
+		// Large credentials are mapped in parallel on the first call, unless
+		// streaming, which has no room for the hashes of all messages
+		if (0 == batch->len && ! batch->src.stream &&
+		    (num_threads = bbs_mapping_threads (batch->remaining)) > 1)
+		{
+			if (BBS_OK != bbs_msg_batch_map_parallel (batch, num_threads))
+				goto cleanup;
+		}
+		else
+		{
+			batch->len = batch->remaining < BBS_MSG_BATCH_LEN ? batch->remaining :
+				     BBS_MSG_BATCH_LEN;
+			for (uint64_t i = 0; i < batch->len; i++)
+				if (BBS_OK != bbs_msg_batch_read (batch, &msgs[i], &msg_lens[i]))
+					goto cleanup;
+			if (BBS_OK != hash_to_scalar_batch_expand (&batch->map_dst, batch->expanded,
+								   msgs, msg_lens, batch->len))
+			{
+				goto cleanup;
+			}
+			batch->remaining -= batch->len;
+			batch->pos        = 0;
+		}
+	}
+
+	sc_read_wide (msg_scalar, batch->uniform ? batch->uniform[batch->pos] :
+		      batch->expanded[batch->pos]);
+	batch->pos++;
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
 int
 bbs_keygen_full (
-	bbs_secret_key  sk,
-	bbs_public_key  pk
+	const bbs_ciphersuite *cipher_suite,
+	bbs_secret_key         sk,
+	bbs_public_key         pk
 	)
 {
-	int            res = BBS_ERROR;
-	static uint8_t seed[32];
+	uint8_t seed[32];
+	int     res = BBS_ERROR;
 
 	// Gather randomness
-	RLC_TRY {
-		rand_bytes (seed, 32);
-	}
-	RLC_CATCH_ANY {
+	if (BBS_OK != bbs_rand_bytes (seed, 32))
+	{
 		goto cleanup;
 	}
 
 	// Generate the secret key
-	if (BBS_OK != bbs_keygen (sk, seed, 32, 0, 0, 0, 0))
+	if (BBS_OK != bbs_keygen (cipher_suite, sk, seed, 32, 0, 0, 0, 0))
 	{
 		goto cleanup;
 	}
@@ -57,13 +506,14 @@ cleanup:
 
 int
 bbs_keygen (
-	bbs_secret_key  sk,
-	const uint8_t  *key_material,
-	uint16_t        key_material_len,
-	const uint8_t  *key_info,
-	uint16_t        key_info_len,
-	const uint8_t  *key_dst,
-	uint8_t         key_dst_len
+	const bbs_ciphersuite *cipher_suite,
+	bbs_secret_key         sk,
+	const uint8_t         *key_material,
+	uint16_t               key_material_len,
+	const uint8_t         *key_info,
+	uint16_t               key_info_len,
+	const uint8_t         *key_dst,
+	uint8_t                key_dst_len
 	)
 {
 	bn_t     sk_n;
@@ -80,8 +530,8 @@ bbs_keygen (
 
 	if (! key_dst)
 	{
-		key_dst     = (uint8_t*) BBS_SHA_256_DEFAULT_KEY_DST;
-		key_dst_len = LEN (BBS_SHA_256_DEFAULT_KEY_DST) - 1;
+		key_dst     = cipher_suite->default_key_dst;
+		key_dst_len = cipher_suite->default_key_dst_len;
 	}
 
 	RLC_TRY {
@@ -91,8 +541,9 @@ bbs_keygen (
 		goto cleanup;
 	}
 
-	if (BBS_OK != hash_to_scalar (sk_n, key_dst, key_dst_len, key_material, key_material_len,
-				      &key_info_len_be, 2, key_info, key_info_len, 0))
+	if (BBS_OK != hash_to_scalar (cipher_suite, sk_n, key_dst, key_dst_len, key_material,
+				      key_material_len, &key_info_len_be, 2, key_info, key_info_len,
+				      0))
 	{
 		goto cleanup;
 	}
@@ -145,194 +596,253 @@ cleanup:
 
 
 int
-bbs_sign (
-	const bbs_secret_key  sk,
-	const bbs_public_key  pk,
-	bbs_signature         signature,
-	const uint8_t        *header,
-	uint64_t              header_len,
-	uint64_t              num_messages,
-	...
+bbs_set_parallel_mapping (
+	uint32_t num_threads,
+	uint64_t min_messages
 	)
 {
-	va_list       ap;
-	uint8_t       generator_ctx[48 + 8];
-	SHA256Context h2s_ctx, dom_ctx;
-	uint8_t       buffer[BBS_SCALAR_LEN];
-	bn_t          e, domain, msg_scalar, sk_n;
-	ep_t          A, B, Q_1, H_i;
-	uint8_t      *msg;
-	uint32_t      msg_len;
-	int           res = BBS_ERROR;
+	int res = BBS_ERROR;
 
-	bn_null (e);
-	bn_null (sk_n);
-	bn_null (domain);
-	bn_null (msg_scalar);
-	ep_null (A);
-	ep_null (B);
-	ep_null (Q_1);
-	ep_null (H_i);
+	if (num_threads > BBS_MAX_MAPPING_THREADS)
+		goto cleanup;
+#ifndef BBS_THREADS
+	if (num_threads > 1)
+		goto cleanup;
+#endif
 
-	if (! header)
-	{
-		header     = (uint8_t*) "";
-		header_len = 0;
-	}
+	num_threads = num_threads ? num_threads : 1;
+
+#ifdef BBS_THREADS
+	pthread_mutex_lock (&mapping_pool.resize);
 
-	if (BBS_OK != create_generator_init (generator_ctx, (uint8_t*) BBS_SHA_256_API_ID, LEN (
-						     BBS_SHA_256_API_ID)
-					     - 1))
+	// Stop the current workers. Jobs left in the queue are run by the
+	// callers that queued them.
+	pthread_mutex_lock (&mapping_pool.lock);
+	mapping_pool.stop = 1;
+	pthread_cond_broadcast (&mapping_pool.queued);
+	pthread_mutex_unlock (&mapping_pool.lock);
+	for (uint32_t t = 0; t < mapping_pool.num_workers; t++)
+		pthread_join (mapping_pool.workers[t], NULL);
+	mapping_pool.num_workers = 0;
+
+	pthread_mutex_lock (&mapping_pool.lock);
+	mapping_pool.stop    = 0;
+	mapping_threads      = num_threads;
+	mapping_min_messages = min_messages;
+	pthread_mutex_unlock (&mapping_pool.lock);
+
+	// The calling threads take a share of the work, so one worker less
+	// than threads is started
+	for (uint32_t t = 1; t < num_threads; t++)
 	{
-		goto cleanup;
+		if (0 != pthread_create (&mapping_pool.workers[mapping_pool.num_workers],
+					 NULL, bbs_mapping_worker, NULL))
+		{
+			break;
+		}
+		mapping_pool.num_workers++;
 	}
-	if (BBS_OK != calculate_domain_init (&dom_ctx, pk, num_messages))
+
+	pthread_mutex_unlock (&mapping_pool.resize);
+#else
+	mapping_threads      = num_threads;
+	mapping_min_messages = min_messages;
+#endif
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+bbs_set_scratch (
+	void  *buf,
+	size_t len
+	)
+{
+	if (! buf && len)
+		return BBS_ERROR;
+
+	scratch.buf  = buf;
+	scratch.len  = len;
+	scratch.used = 0;
+	return BBS_OK;
+}
+
+
+size_t
+bbs_scratch_size (
+	uint64_t num_messages
+	)
+{
+	// The worst case of a single call: all messages disclosed, and parallel
+	// mapping on, which needs the hashes, pointers and lengths of all
+	// messages. Each buffer gets room for alignment.
+	const uint64_t per_message = BBS_SCALAR_LEN + 48 + sizeof(uint8_t*) + sizeof(uint64_t);
+
+	if (num_messages > (SIZE_MAX - 4 * 7) / per_message)
+		return 0;
+	return num_messages * per_message + 4 * 7;
+}
+
+
+// The message source of a descriptor. Fails if there are messages to read,
+// but no arrays to read them from.
+static int
+bbs_msg_source_messages (
+	bbs_msg_source     *src,
+	const bbs_messages *messages,
+	uint64_t            num_messages
+	)
+{
+	int res = BBS_ERROR;
+
+	memset (src, 0, sizeof(*src));
+	if (messages->msg_scalars)
 	{
-		goto cleanup;
+		src->msg_scalars = 1;
+		src->msgs        = messages->msg_scalars;
 	}
-	if (BBS_OK != hash_to_scalar_init (&h2s_ctx))
+	else
 	{
-		goto cleanup;
+		src->msgs     = messages->msgs;
+		src->msg_lens = messages->msg_lens;
+		if (num_messages && (! src->msgs || ! src->msg_lens))
+			goto cleanup;
 	}
 
-	if (BBS_OK != hash_to_scalar_update (&h2s_ctx, sk, BBS_SK_LEN))
-	{
-		goto cleanup;
-	}
-	RLC_TRY {
-		bn_new (e);
-		bn_new (sk_n);
-		bn_new (domain);
-		bn_new (msg_scalar);
-		ep_new (A);
-		ep_new (B);
-		ep_new (Q_1);
-		ep_new (H_i);
+	res = BBS_OK;
+cleanup:
+	return res;
+}
 
-		// Initialize B to P1
-		ep_read_bbs (B, P1);
-	}
-	RLC_CATCH_ANY {
+
+static int
+bbs_messages_to_scalars_v (
+	const bbs_ciphersuite *cipher_suite,
+	uint8_t               *msg_scalars,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	bbs_msg_batch msg_batch;
+	sc_t          msg_scalar;
+	int           res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, num_messages, src))
+	{
 		goto cleanup;
 	}
 
-	// Ideally, I would like to merge these two loops. I can't, because I
-	// need domain very early when hashing to scalar. For now, we generate
-	// the generators twice, even though this is slow. Note that one can
-	// pregenerate the domain if speed is relevant, which solves this issue.
-	// BEGIN UGLY CODE
-	for (int i = 0; i<num_messages + 1; i++)
+	for (uint64_t i = 0; i < num_messages; i++)
 	{
-		// Technically, this includes Q_1
-		if (BBS_OK != create_generator_next (generator_ctx, H_i,
-						     (uint8_t*) BBS_SHA_256_API_ID, LEN (
-							     BBS_SHA_256_API_ID)
-						     - 1))
-		{
-			goto cleanup;
-		}
-		if (BBS_OK != calculate_domain_update (&dom_ctx, H_i))
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_scalar))
 		{
 			goto cleanup;
 		}
+		sc_write_bbs (msg_scalars + i * BBS_SCALAR_LEN, msg_scalar);
 	}
-	if (BBS_OK != calculate_domain_finalize (&dom_ctx, domain, header, header_len,
-						 (uint8_t*) BBS_SHA_256_API_ID, LEN (
-							 BBS_SHA_256_API_ID)
-						 - 1))
-	{
-		goto cleanup;
-	}
-	if (BBS_OK != create_generator_init (generator_ctx, (uint8_t*) BBS_SHA_256_API_ID, LEN (
-						     BBS_SHA_256_API_ID)
-					     - 1))
-	{
-		goto cleanup;
-	}
-	RLC_TRY {
-		bn_write_bbs (buffer, domain);
-	}
-	RLC_CATCH_ANY {
+
+	res = BBS_OK;
+cleanup:
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+int
+bbs_messages_to_scalars (
+	const bbs_ciphersuite *cipher_suite,
+	uint8_t               *msg_scalars,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list        ap;
+	bbs_msg_source src = { .ap = &ap };
+	int            res;
+
+	va_start (ap, num_messages);
+	res = bbs_messages_to_scalars_v (cipher_suite, msg_scalars, num_messages, &src);
+	va_end (ap);
+	return res;
+}
+
+
+int
+bbs_messages_to_scalars_array (
+	const bbs_ciphersuite *cipher_suite,
+	uint8_t               *msg_scalars,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
+	{
 		goto cleanup;
 	}
-	if (BBS_OK != hash_to_scalar_update (&h2s_ctx, buffer, BBS_SCALAR_LEN))
+	if (BBS_OK != bbs_messages_to_scalars_v (cipher_suite, msg_scalars, num_messages, &src))
 	{
 		goto cleanup;
 	}
-	// END UGLY CODE
 
-	// Calculate Q_1
-	if (BBS_OK != create_generator_next (generator_ctx, Q_1, (uint8_t*) BBS_SHA_256_API_ID,
-					     LEN (BBS_SHA_256_API_ID)
-					     - 1))
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+bbs_message_to_scalar_stream (
+	const bbs_ciphersuite *cipher_suite,
+	uint8_t                msg_scalar[BBS_SCALAR_LEN],
+	bbs_msg_chunk_fn       next,
+	void                  *cookie
+	)
+{
+	bbs_hash_context h2s_ctx;
+	const uint8_t   *chunk;
+	uint64_t         chunk_len;
+	bn_t             scalar;
+	int              res = BBS_ERROR;
+
+	bn_null (scalar);
+
+	if (BBS_OK != hash_to_scalar_init (cipher_suite, &h2s_ctx))
 	{
 		goto cleanup;
 	}
-
-	va_start (ap, num_messages);
-	for (int i = 0; i<num_messages; i++)
+	for (;;)
 	{
-		// Calculate H_i
-		if (BBS_OK != create_generator_next (generator_ctx, H_i,
-						     (uint8_t*) BBS_SHA_256_API_ID, LEN (
-							     BBS_SHA_256_API_ID)
-						     - 1))
-		{
-			goto cleanup;
-		}
-		// This is where I would like to merge in the generator into
-		// domain. As mentioned before, by this point, the domain has to
-		// be hashed into hash_to_scalar already.
-
-		// Calculate msg_scalar (oneshot)
-		msg     = va_arg (ap, uint8_t*);
-		msg_len = va_arg (ap, uint32_t);
-		if (BBS_OK != hash_to_scalar (msg_scalar, (uint8_t*) BBS_SHA_256_MAP_DST, LEN (
-						      BBS_SHA_256_MAP_DST) - 1, msg, msg_len, 0))
+		if (BBS_OK != next (cookie, &chunk, &chunk_len))
 		{
 			goto cleanup;
 		}
-		RLC_TRY {
-			// Update B
-			ep_mul (H_i, H_i, msg_scalar);
-			ep_add (B, B, H_i);
-
-			// Serialize msg_scalar for hashing into e
-			bn_write_bbs (buffer, msg_scalar);
-		}
-		RLC_CATCH_ANY {
-			goto cleanup;
-		}
-		if (BBS_OK != hash_to_scalar_update (&h2s_ctx, buffer, BBS_SCALAR_LEN))
+		if (0 == chunk_len)
+			break;
+		if (BBS_OK != hash_to_scalar_update (cipher_suite, &h2s_ctx, chunk, chunk_len))
 		{
 			goto cleanup;
 		}
 	}
-	va_end (ap);
 
-	// Derive e
-	if (BBS_OK != hash_to_scalar_finalize (&h2s_ctx, e, (uint8_t*) BBS_SHA_256_SIGNATURE_DST,
-					       LEN (BBS_SHA_256_SIGNATURE_DST)
-					       - 1))
+	RLC_TRY {
+		bn_new (scalar);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_finalize (cipher_suite, &h2s_ctx, scalar,
+					       cipher_suite->map_dst, cipher_suite->map_dst_len))
 	{
 		goto cleanup;
 	}
-
 	RLC_TRY {
-		// Update B
-		ep_mul (Q_1, Q_1, domain);
-		ep_add (B, B, Q_1);
-
-		// Calculate A
-		bn_new (sk_n);
-		bn_read_bbs (sk_n, sk);
-		bn_add (sk_n, sk_n, e);
-		bn_mod_inv (sk_n, sk_n, &(core_get ()->ep_r));
-		ep_mul (A, B, sk_n);
-
-		// Serialize (A,e)
-		ep_write_bbs (signature, A);
-		bn_write_bbs (signature + BBS_G1_ELEM_LEN, e);
+		bn_write_bbs (msg_scalar, scalar);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
@@ -340,50 +850,40 @@ bbs_sign (
 
 	res = BBS_OK;
 cleanup:
-	bn_free (e);
-	bn_free (sk_n);
-	bn_free (domain);
-	bn_free (msg_scalar);
-	ep_free (A);
-	ep_free (B);
-	ep_free (Q_1);
-	ep_free (H_i);
+	bn_free (scalar);
 	return res;
 }
 
 
-int
-bbs_verify (
-	const bbs_public_key  pk,
-	const bbs_signature   signature,
-	const uint8_t        *header,
-	uint64_t              header_len,
-	uint64_t              num_messages,
-	...
+static int
+bbs_sign_v (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_secret_key   sk,
+	const bbs_public_key   pk,
+	bbs_signature          signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
 	)
 {
-	va_list       ap;
-	uint8_t       generator_ctx[48 + 8];
-	SHA256Context dom_ctx;
-	bn_t          e, domain, msg_scalar;
-	ep_t          A, B, Q_1, H_i;
-	ep2_t         W, tmp_p;
-	fp12_t        paired1, paired2;
-	uint8_t      *msg;
-	uint32_t      msg_len;
-	int           res = BBS_ERROR;
+	uint8_t          generator_ctx[48 + 8];
+	bbs_hash_context h2s_ctx, dom_ctx;
+	bbs_msg_batch    msg_batch;
+	uint8_t          buffer[BBS_SCALAR_LEN];
+	bn_t             e, domain, msg_scalar, sk_n;
+	sc_t             sk_e, e_sc, msg_sc;
+	ep_t             A, B, Q_1, H_i;
+	int              res = BBS_ERROR;
 
 	bn_null (e);
+	bn_null (sk_n);
 	bn_null (domain);
 	bn_null (msg_scalar);
 	ep_null (A);
 	ep_null (B);
 	ep_null (Q_1);
 	ep_null (H_i);
-	ep2_null (W);
-	ep2_null (tmp_p);
-	fp12_null (paired1);
-	fp12_null (paired2);
 
 	if (! header)
 	{
@@ -391,1013 +891,4937 @@ bbs_verify (
 		header_len = 0;
 	}
 
-	if (BBS_OK != create_generator_init (generator_ctx, (uint8_t*) BBS_SHA_256_API_ID, LEN (
-						     BBS_SHA_256_API_ID)
-					     - 1))
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, num_messages, src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != create_generator_init (cipher_suite, generator_ctx))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != calculate_domain_init (cipher_suite, &dom_ctx, pk, num_messages))
 	{
 		goto cleanup;
 	}
-	if (BBS_OK != calculate_domain_init (&dom_ctx, pk, num_messages))
+	if (BBS_OK != hash_to_scalar_init (cipher_suite, &h2s_ctx))
 	{
 		goto cleanup;
 	}
 
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &h2s_ctx, sk, BBS_SK_LEN))
+	{
+		goto cleanup;
+	}
 	RLC_TRY {
 		bn_new (e);
+		bn_new (sk_n);
 		bn_new (domain);
 		bn_new (msg_scalar);
 		ep_new (A);
 		ep_new (B);
 		ep_new (Q_1);
 		ep_new (H_i);
-		ep2_new (W);
-		ep2_new (tmp_p);
-		fp12_new (paired1);
-		fp12_new (paired2);
 
-		// Initialize B to P1, and parse signature
-		ep_read_bbs (B, P1);
-		ep_read_bbs (A, signature);
-		bn_read_bbs (e, signature + BBS_G1_ELEM_LEN);
-		ep2_read_bbs (W, pk);
+		// Initialize B to P1
+		ep_read_bbs (B, cipher_suite->p1);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
 	}
 
-	// Calculate Q_1
-	if (BBS_OK != create_generator_next (generator_ctx, Q_1, (uint8_t*) BBS_SHA_256_API_ID,
-					     LEN (BBS_SHA_256_API_ID)
-					     - 1))
+	// Ideally, I would like to merge these two loops. I can't, because I
+	// need domain very early when hashing to scalar. For now, we generate
+	// the generators twice, even though this is slow. Note that one can
+	// pregenerate the domain if speed is relevant, which solves this issue.
+	// BEGIN UGLY CODE
+	for (int i = 0; i<num_messages + 1; i++)
+	{
+		// Technically, this includes Q_1
+		if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, H_i))
+		{
+			goto cleanup;
+		}
+		if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, H_i))
+		{
+			goto cleanup;
+		}
+	}
+	if (BBS_OK != calculate_domain_finalize (cipher_suite, &dom_ctx, domain, header,
+						 header_len))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != create_generator_init (cipher_suite, generator_ctx))
 	{
 		goto cleanup;
 	}
-	if (BBS_OK != calculate_domain_update (&dom_ctx, Q_1))
+	RLC_TRY {
+		bn_write_bbs (buffer, domain);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &h2s_ctx, buffer, BBS_SCALAR_LEN))
+	{
+		goto cleanup;
+	}
+	// END UGLY CODE
+
+	// Calculate Q_1
+	if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, Q_1))
 	{
 		goto cleanup;
 	}
 
-	va_start (ap, num_messages);
 	for (int i = 0; i<num_messages; i++)
 	{
 		// Calculate H_i
-		if (BBS_OK != create_generator_next (generator_ctx, H_i,
-						     (uint8_t*) BBS_SHA_256_API_ID, LEN (
-							     BBS_SHA_256_API_ID)
-						     - 1))
-		{
-			goto cleanup;
-		}
-		if (BBS_OK != calculate_domain_update (&dom_ctx, H_i))
+		if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, H_i))
 		{
 			goto cleanup;
 		}
+		// This is where I would like to merge in the generator into
+		// domain. As mentioned before, by this point, the domain has to
+		// be hashed into hash_to_scalar already.
 
-		// Calculate msg_scalar (oneshot)
-		msg     = va_arg (ap, uint8_t*);
-		msg_len = va_arg (ap, uint32_t);
-		if (BBS_OK != hash_to_scalar (msg_scalar, (uint8_t*) BBS_SHA_256_MAP_DST, LEN (
-						      BBS_SHA_256_MAP_DST) - 1, msg, msg_len, 0))
+		// Calculate msg_scalar (batched)
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_sc))
 		{
 			goto cleanup;
 		}
 		RLC_TRY {
 			// Update B
+			sc_write_bn (msg_scalar, msg_sc);
 			ep_mul (H_i, H_i, msg_scalar);
 			ep_add (B, B, H_i);
 		}
 		RLC_CATCH_ANY {
 			goto cleanup;
 		}
+
+		// Serialize msg_scalar for hashing into e
+		sc_write_bbs (buffer, msg_sc);
+		if (BBS_OK != hash_to_scalar_update (cipher_suite, &h2s_ctx, buffer, BBS_SCALAR_LEN))
+		{
+			goto cleanup;
+		}
 	}
-	va_end (ap);
 
-	// Finalize domain calculation
-	if (BBS_OK != calculate_domain_finalize (&dom_ctx, domain, header, header_len,
-						 (uint8_t*) BBS_SHA_256_API_ID, LEN (
-							 BBS_SHA_256_API_ID)
-						 - 1))
+	// Derive e
+	if (BBS_OK != hash_to_scalar_finalize (cipher_suite, &h2s_ctx, e,
+					       cipher_suite->signature_dst,
+					       cipher_suite->signature_dst_len))
+	{
+		goto cleanup;
+	}
+
+	// Calculate 1 / (SK + e)
+	if (BBS_OK != sc_read_bbs (sk_e, sk))
+	{
+		goto cleanup;
+	}
+	RLC_TRY {
+		sc_read_bn (e_sc, e);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+	sc_add (sk_e, sk_e, e_sc);
+	if (sc_is_zero (sk_e))
 	{
 		goto cleanup;
 	}
+	sc_inv (sk_e, sk_e);
+
 	RLC_TRY {
 		// Update B
 		ep_mul (Q_1, Q_1, domain);
 		ep_add (B, B, Q_1);
 
-		// Compute pairings e(A, W + BP2 * e) * e(B, -BP2)
-		// For valid signatures, this is the identity.
-		ep2_mul_gen (tmp_p, e);
-		ep2_add (tmp_p, W, tmp_p);
-		pp_map_oatep_k12 (paired1, A, tmp_p);
-
-		bn_set_dig (e, 1); // reuse e as -1
-		bn_neg (e, e);
-		ep2_mul_gen (tmp_p, e);
-		pp_map_oatep_k12 (paired2, B, tmp_p);
+		// Calculate A. Together with the public e, 1 / (SK + e)
+		// reveals SK, so the copy is cleared right away.
+		sc_write_bn (sk_n, sk_e);
+		ep_mul (A, B, sk_n);
+		bn_zero (sk_n);
 
-		fp12_mul (paired1, paired1, paired2);
+		// Serialize (A,e)
+		ep_write_bbs (signature, A);
+		bn_write_bbs (signature + BBS_G1_ELEM_LEN, e);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
 	}
 
-	// Check signature equation
-	if (RLC_EQ != fp12_cmp_dig (paired1, 1))
-	{
-		goto cleanup;
-	}
-
 	res = BBS_OK;
 cleanup:
+	// The hash state holds SK, which is shorter than a block
+	bbs_wipe (&h2s_ctx, sizeof(h2s_ctx));
+	bbs_wipe (sk_e, sizeof(sk_e));
 	bn_free (e);
+	bn_free (sk_n);
 	bn_free (domain);
 	bn_free (msg_scalar);
 	ep_free (A);
 	ep_free (B);
 	ep_free (Q_1);
 	ep_free (H_i);
-	ep2_free (W);
-	ep2_free (tmp_p);
-	fp12_free (paired1);
-	fp12_free (paired2);
+	bbs_msg_batch_free (&msg_batch);
 	return res;
 }
 
 
-// bbs_proof_gen, but makes callbacks to prf for random scalars
-// We need to control the random scalars for the fixture tests. This way we do
-// not need to compile a dedicated library for the tests.
 int
-bbs_proof_gen_det (
-	const bbs_public_key  pk,
-	const bbs_signature   signature,
-	uint8_t              *proof,
-	const uint8_t        *header,
-	uint64_t              header_len,
-	const uint8_t        *presentation_header,
-	uint64_t              presentation_header_len,
-	const uint64_t       *disclosed_indexes,
-	uint64_t              disclosed_indexes_len,
-	uint64_t              num_messages,
-	bbs_bn_prf            prf,
-	void                 *prf_cookie,
-	va_list               ap
+bbs_sign (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_secret_key   sk,
+	const bbs_public_key   pk,
+	bbs_signature          signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	...
 	)
 {
-	va_list       ap2;
-	uint8_t       generator_ctx[48 + 8];
-	uint8_t       T_buffer[2 * BBS_G1_ELEM_LEN];
-	uint8_t       scalar_buffer[BBS_SCALAR_LEN];
-	uint8_t      *proof_ptr, *msg;
-	uint64_t      msg_len, be_buffer;
-	SHA256Context dom_ctx, ch_ctx;
-	bn_t          e, domain, msg_scalar, msg_scalar_tilde, r1, r2, e_tilde, r1_tilde, r3_tilde,
-		      challenge;
-	ep_t          A, B, Q_1, H_i, T1, T2, D, Abar, Bbar;
-	uint64_t      disclosed_indexes_idx   = 0;
-	uint64_t      undisclosed_indexes_idx = 0;
-	uint64_t      undisclosed_indexes_len = num_messages - disclosed_indexes_len;
-	int           res                     = BBS_ERROR;
-
-	// We iterate over the messages twice because the spec is ****
-	va_copy (ap2, ap);
+	va_list        ap;
+	bbs_msg_source src = { .ap = &ap };
+	int            res = BBS_ERROR;
 
-	if (! header)
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_sign_v (cipher_suite, sk, pk, signature, header, header_len,
+				  num_messages, &src))
 	{
-		header     = (uint8_t*) "";
-		header_len = 0;
+		goto cleanup;
 	}
 
-	if (! presentation_header)
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	return res;
+}
+
+
+int
+bbs_sign_scalars (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_secret_key   sk,
+	const bbs_public_key   pk,
+	bbs_signature          signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list        ap;
+	bbs_msg_source src = { .msg_scalars = 1, .ap = &ap };
+	int            res = BBS_ERROR;
+
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_sign_v (cipher_suite, sk, pk, signature, header, header_len,
+				  num_messages, &src))
 	{
-		presentation_header     = (uint8_t*) "";
-		presentation_header_len = 0;
+		goto cleanup;
 	}
 
-	bn_null (e);
-	bn_null (domain);
-	bn_null (msg_scalar);
-	bn_null (msg_scalar_tilde);
-	bn_null (r1);
-	bn_null (r2);
-	bn_null (e_tilde);
-	bn_null (r1_tilde);
-	bn_null (r3_tilde);
-	bn_null (challenge);
-	ep_null (A);
-	ep_null (B);
-	ep_null (Q_1);
-	ep_null (H_i);
-	ep_null (T1);
-	ep_null (T2);
-	ep_null (D);
-	ep_null (Abar);
-	ep_null (Bbar);
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	return res;
+}
+
+
+int
+bbs_sign_array (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_secret_key   sk,
+	const bbs_public_key   pk,
+	bbs_signature          signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
 
-	if (BBS_OK != create_generator_init (generator_ctx, (uint8_t*) BBS_SHA_256_API_ID, LEN (
-						     BBS_SHA_256_API_ID)
-					     - 1))
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
 	{
 		goto cleanup;
 	}
-	if (BBS_OK != calculate_domain_init (&dom_ctx, pk, num_messages))
+	if (BBS_OK != bbs_sign_v (cipher_suite, sk, pk, signature, header, header_len,
+				  num_messages, &src))
 	{
 		goto cleanup;
 	}
 
-	RLC_TRY {
-		bn_new (e);
-		bn_new (domain);
-		bn_new (msg_scalar);
-		bn_new (msg_scalar_tilde);
-		bn_new (r1);
-		bn_new (r2);
-		bn_new (e_tilde);
-		bn_new (r1_tilde);
-		bn_new (r3_tilde);
-		bn_new (challenge);
-		ep_new (A);
-		ep_new (B);
-		ep_new (Q_1);
-		ep_new (H_i);
-		ep_new (T1);
-		ep_new (T2);
-		ep_new (D);
-		ep_new (Abar);
-		ep_new (Bbar);
+	res = BBS_OK;
+cleanup:
+	return res;
+}
 
-		// Initialize B to P1 and T2 to the identity
-		ep_read_bbs (B, P1);
-		ep_set_infty (T2);
 
-		// Parse the signature
-		ep_read_bbs (A, signature);
-		bn_read_bbs (e, signature + BBS_G1_ELEM_LEN);
+// acc += points[0] * scalars[0] + ... + points[num - 1] * scalars[num - 1] for
+// scalars given as octets, with one multi-scalar multiplication per chunk
+static int
+bbs_msm_octets (
+	ep_t           acc,
+	ep_t          *points,
+	const uint8_t *scalars,
+	uint64_t       num
+	)
+{
+	bn_t     k[BBS_MSM_CHUNK_LEN];
+	ep_t     partial;
+	uint64_t chunk_len;
+	int      res = BBS_ERROR;
+
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+		bn_null (k[i]);
+	ep_null (partial);
+
+	RLC_TRY {
+		for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+			bn_new (k[i]);
+		ep_new (partial);
+
+		for (uint64_t i = 0; i < num; i += chunk_len)
+		{
+			chunk_len = num - i;
+			if (chunk_len > BBS_MSM_CHUNK_LEN)
+				chunk_len = BBS_MSM_CHUNK_LEN;
+			for (uint64_t j = 0; j < chunk_len; j++)
+				bn_read_bbs (k[j], scalars + (i + j) * BBS_SCALAR_LEN);
+			ep_mul_sim_lot (partial, points + i, k, chunk_len);
+			ep_add (acc, acc, partial);
+		}
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
 	}
 
-	// Derive random scalars. The msg_scalar_tilde scalars are derived later
-	if (BBS_OK != prf (r1,       1, 0, prf_cookie))
-		goto cleanup;
-	if (BBS_OK != prf (r2,       2, 0, prf_cookie))
+	res = BBS_OK;
+cleanup:
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+		bn_free (k[i]);
+	ep_free (partial);
+	return res;
+}
+
+
+int
+bbs_signer_init (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_signer            *signer,
+	const bbs_secret_key   sk,
+	const bbs_public_key   pk,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	ep_t                  *generators,
+	uint64_t               num_messages
+	)
+{
+	uint8_t          generator_ctx[48 + 8];
+	uint8_t          buffer[BBS_SCALAR_LEN];
+	bbs_hash_context dom_ctx;
+	bn_t             domain;
+	ep_t             Q_1;
+	int              res = BBS_ERROR;
+
+	signer->cipher_suite = cipher_suite;
+	signer->generators   = generators;
+	signer->num_messages = num_messages;
+
+	bn_null (domain);
+	ep_null (Q_1);
+	ep_null (signer->B);
+	for (uint64_t i = 0; i < num_messages; i++)
+		ep_null (generators[i]);
+
+	if (! header)
+	{
+		header     = (uint8_t*) "";
+		header_len = 0;
+	}
+
+	if (BBS_OK != sc_read_bbs (signer->sk, sk))
+	{
 		goto cleanup;
-	if (BBS_OK != prf (e_tilde,  3, 0, prf_cookie))
+	}
+	if (BBS_OK != create_generator_init (cipher_suite, generator_ctx))
+	{
 		goto cleanup;
-	if (BBS_OK != prf (r1_tilde, 4, 0, prf_cookie))
+	}
+	if (BBS_OK != calculate_domain_init (cipher_suite, &dom_ctx, pk, num_messages))
+	{
 		goto cleanup;
-	if (BBS_OK != prf (r3_tilde, 5, 0, prf_cookie))
+	}
+
+	RLC_TRY {
+		bn_new (domain);
+		ep_new (Q_1);
+		ep_new (signer->B);
+		for (uint64_t i = 0; i < num_messages; i++)
+			ep_new (generators[i]);
+
+		// Initialize B to P1
+		ep_read_bbs (signer->B, cipher_suite->p1);
+	}
+	RLC_CATCH_ANY {
 		goto cleanup;
+	}
 
-	// Calculate Q_1
-	if (BBS_OK != create_generator_next (generator_ctx, Q_1, (uint8_t*) BBS_SHA_256_API_ID,
-					     LEN (BBS_SHA_256_API_ID)
-					     - 1))
+	// Q_1 and all H_i, which go into the domain
+	if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, Q_1))
 	{
 		goto cleanup;
 	}
-	if (BBS_OK != calculate_domain_update (&dom_ctx, Q_1))
+	if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, Q_1))
 	{
 		goto cleanup;
 	}
-
-	proof_ptr = proof + 3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN; // m_hat
-	for (uint64_t i = 0; i<num_messages; i++)
+	for (uint64_t i = 0; i < num_messages; i++)
 	{
-		// Calculate H_i
-		if (BBS_OK != create_generator_next (generator_ctx, H_i,
-						     (uint8_t*) BBS_SHA_256_API_ID, LEN (
-							     BBS_SHA_256_API_ID)
-						     - 1))
-		{
-			goto cleanup;
-		}
-		if (BBS_OK != calculate_domain_update (&dom_ctx, H_i))
+		if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, generators[i]))
 		{
 			goto cleanup;
 		}
-
-		// Calculate msg_scalar (oneshot)
-		msg     = va_arg (ap, uint8_t*);
-		msg_len = va_arg (ap, uint32_t);
-		if (BBS_OK != hash_to_scalar (msg_scalar, (uint8_t*) BBS_SHA_256_MAP_DST, LEN (
-						      BBS_SHA_256_MAP_DST) - 1, msg, msg_len, 0))
+		if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, generators[i]))
 		{
 			goto cleanup;
 		}
-		RLC_TRY {
-			// Update B. Use Bbar as temporary buffer, because we
-			// need H_i below
-			ep_mul (Bbar, H_i, msg_scalar);
-			ep_add (B, B, Bbar);
-		}
-		RLC_CATCH_ANY {
-			goto cleanup;
-		}
-
-		if (disclosed_indexes_idx < disclosed_indexes_len &&
-		    disclosed_indexes[disclosed_indexes_idx] == i)
-		{
-			// This message is disclosed.
-			// Here I would like to hash the disclosed messages into the
-			// challenge. I can not do that however, since we need to hash
-			// the domain first, and we have not calculated that one yet. As
-			// a result, we need to iterate over the messages again later.
-			// I am still hoping that this issue will be resolved in due
-			// time.
-			disclosed_indexes_idx++;
-		}
-		else
-		{
-			// This message is undisclosed. Derive new random scalar
-			// and accumulate it onto T2
-			if (BBS_OK != prf (msg_scalar_tilde, 0, undisclosed_indexes_idx,
-					   prf_cookie))
-			{
-				goto cleanup;
-			}
+	}
+	if (BBS_OK != calculate_domain_finalize (cipher_suite, &dom_ctx, domain, header,
+						 header_len))
+	{
+		goto cleanup;
+	}
 
-			RLC_TRY {
-				// Update T2
-				ep_mul (H_i, H_i, msg_scalar_tilde);
-				ep_add (T2, T2, H_i);
+	RLC_TRY {
+		// P1 + Q_1 * domain is the same for every signature
+		ep_mul (Q_1, Q_1, domain);
+		ep_add (signer->B, signer->B, Q_1);
 
-				// Save msg_scalar in the proof so that one day we
-				// do not need to recalculate it
-				bn_write_bbs (proof_ptr, msg_scalar);
-			}
-			RLC_CATCH_ANY {
-				goto cleanup;
-			}
-			undisclosed_indexes_idx++;
-			proof_ptr += BBS_SCALAR_LEN;
-		}
+		bn_write_bbs (buffer, domain);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
 	}
 
-	// Sanity check. If any indices for disclosed messages were out of order
-	// or invalid, we fail here.
-	if (disclosed_indexes_idx != disclosed_indexes_len)
+	// e is derived from SK, domain and the message scalars, in that order
+	if (BBS_OK != hash_to_scalar_init (cipher_suite, &signer->e_ctx))
 	{
 		goto cleanup;
 	}
-
-	// Finalize domain calculation
-	if (BBS_OK != calculate_domain_finalize (&dom_ctx, domain, header, header_len,
-						 (uint8_t*) BBS_SHA_256_API_ID, LEN (
-							 BBS_SHA_256_API_ID)
-						 - 1))
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &signer->e_ctx, sk, BBS_SK_LEN))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &signer->e_ctx, buffer,
+					     BBS_SCALAR_LEN))
 	{
 		goto cleanup;
 	}
-	RLC_TRY {
-		// Update B
-		ep_mul (Q_1, Q_1, domain);
-		ep_add (B, B, Q_1);
 
-		// Calculate and write out D to proof
-		ep_mul (D, B, r2);
-		ep_write_bbs (proof + 2 * BBS_G1_ELEM_LEN, D);
+	res = BBS_OK;
+cleanup:
+	bn_free (domain);
+	ep_free (Q_1);
+	return res;
+}
 
-		// Starting here, we no longer need B, so we use it as a
-		// temporary variable.
 
-		// Calculate and write out Abar to proof
-		ep_mul (Abar, A,    r1);
-		ep_mul (Abar, Abar, r2);
-		ep_write_bbs (proof, Abar);
+void
+bbs_signer_free (
+	bbs_signer *signer
+	)
+{
+	for (uint64_t i = 0; i < signer->num_messages; i++)
+		ep_free (signer->generators[i]);
+	ep_free (signer->B);
 
-		// Calculate and write out Bbar to proof
-		ep_mul (Bbar, D,    r1);
-		ep_mul (B,    Abar, e);
-		ep_neg (B, B);
-		ep_add (Bbar, Bbar, B);
-		ep_write_bbs (proof + BBS_G1_ELEM_LEN, Bbar);
+	// Both the scalar and the hash state carry the secret key
+	bbs_wipe (signer->sk, sizeof(signer->sk));
+	bbs_wipe (&signer->e_ctx, sizeof(signer->e_ctx));
+}
 
-		// Calculate and write out T1 and T2 for the challenge
-		ep_mul (B, D, r3_tilde);
-		ep_add (T2, T2, B);
-		ep_mul (T1, D,    r1_tilde);
-		ep_mul (B,  Abar, e_tilde);
-		ep_add (T1, T1, B);
-		ep_write_bbs (T_buffer,                   T1);
-		ep_write_bbs (T_buffer + BBS_G1_ELEM_LEN, T2);
+
+// Derives e from h2s_ctx, into which the message scalars have been hashed
+// after the domain, and writes the signature (B * 1 / (SK + e), e)
+static int
+bbs_signer_finish (
+	const bbs_signer *signer,
+	bbs_hash_context *h2s_ctx,
+	const ep_t        B,
+	bbs_signature     signature
+	)
+{
+	const bbs_ciphersuite *cipher_suite = signer->cipher_suite;
+	bn_t                   e, sk_n;
+	sc_t                   sk_e, e_sc;
+	ep_t                   A;
+	int                    res = BBS_ERROR;
+
+	bn_null (e);
+	bn_null (sk_n);
+	ep_null (A);
+
+	RLC_TRY {
+		bn_new (e);
+		bn_new (sk_n);
+		ep_new (A);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
 	}
 
-	// Calculate the challenge
-	if (BBS_OK != hash_to_scalar_init (&ch_ctx))
+	// Derive e
+	if (BBS_OK != hash_to_scalar_finalize (cipher_suite, h2s_ctx, e,
+					       cipher_suite->signature_dst,
+					       cipher_suite->signature_dst_len))
 	{
 		goto cleanup;
 	}
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, proof, 3 * BBS_G1_ELEM_LEN))
-	{
+
+	// Calculate 1 / (SK + e)
+	RLC_TRY {
+		sc_read_bn (e_sc, e);
+	}
+	RLC_CATCH_ANY {
 		goto cleanup;
 	}
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, T_buffer, 2 * BBS_G1_ELEM_LEN))
+	sc_add (sk_e, signer->sk, e_sc);
+	if (sc_is_zero (sk_e))
 	{
 		goto cleanup;
 	}
-	be_buffer = UINT64_H2BE (disclosed_indexes_len);
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, (uint8_t*) &be_buffer, 8))
+	sc_inv (sk_e, sk_e);
+
+	RLC_TRY {
+		// Calculate A. Together with the public e, 1 / (SK + e)
+		// reveals SK, so the copy is cleared right away.
+		sc_write_bn (sk_n, sk_e);
+		ep_mul (A, B, sk_n);
+		bn_zero (sk_n);
+
+		// Serialize (A,e)
+		ep_write_bbs (signature, A);
+		bn_write_bbs (signature + BBS_G1_ELEM_LEN, e);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_wipe (sk_e, sizeof(sk_e));
+	bn_free (e);
+	bn_free (sk_n);
+	ep_free (A);
+	return res;
+}
+
+
+static int
+bbs_signer_sign_v (
+	const bbs_signer     *signer,
+	bbs_signature         signature,
+	uint64_t              num_messages,
+	const bbs_msg_source *src
+	)
+{
+	const bbs_ciphersuite *cipher_suite = signer->cipher_suite;
+	bbs_hash_context       h2s_ctx;
+	bbs_msg_batch          msg_batch;
+	uint8_t                buffer[BBS_SCALAR_LEN];
+	bn_t                   msg_scalars[BBS_MSM_CHUNK_LEN];
+	sc_t                   msg_sc;
+	ep_t                   B, partial;
+	uint64_t               chunk_len;
+	int                    res = BBS_ERROR;
+
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+		bn_null (msg_scalars[i]);
+	ep_null (B);
+	ep_null (partial);
+
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, num_messages, src))
 	{
 		goto cleanup;
 	}
-	// Given a better spec, we could merge almost all for loops in here...
-	for (uint64_t i = 0; i<disclosed_indexes_len; i++)
+	// The domain commits to the number of messages
+	if (num_messages != signer->num_messages)
 	{
-		be_buffer = UINT64_H2BE (disclosed_indexes[i]);
-		if (BBS_OK != hash_to_scalar_update (&ch_ctx, (uint8_t*) &be_buffer, 8))
-		{
-			goto cleanup;
-		}
+		goto cleanup;
 	}
-	// We have to go over all disclosed messages again. Someone please fix
-	// this in the spec...
-	disclosed_indexes_idx = 0;
-	for (uint64_t i = 0; i<num_messages; i++)
+	h2s_ctx = signer->e_ctx;
+
+	RLC_TRY {
+		for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+			bn_new (msg_scalars[i]);
+		ep_new (B);
+		ep_new (partial);
+
+		ep_copy (B, signer->B);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// B += H_1 * msg_1 + ... + H_L * msg_L, one multi-scalar multiplication
+	// per chunk of messages
+	for (uint64_t i = 0; i < num_messages; i += chunk_len)
 	{
-		// Calculate msg_scalar (oneshot)
-		msg     = va_arg (ap2, uint8_t*);
-		msg_len = va_arg (ap2, uint32_t);
-		if (disclosed_indexes_idx < disclosed_indexes_len &&
-		    disclosed_indexes[disclosed_indexes_idx] == i)
+		chunk_len = num_messages - i;
+		if (chunk_len > BBS_MSM_CHUNK_LEN)
+			chunk_len = BBS_MSM_CHUNK_LEN;
+		for (uint64_t j = 0; j < chunk_len; j++)
 		{
-			disclosed_indexes_idx++;
-			if (BBS_OK != hash_to_scalar (msg_scalar, (uint8_t*) BBS_SHA_256_MAP_DST,
-						      LEN (BBS_SHA_256_MAP_DST)
-						      - 1, msg, msg_len, 0))
+			if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_sc))
 			{
 				goto cleanup;
 			}
 			RLC_TRY {
-				bn_write_bbs (scalar_buffer, msg_scalar);
+				sc_write_bn (msg_scalars[j], msg_sc);
 			}
 			RLC_CATCH_ANY {
 				goto cleanup;
 			}
-			if (BBS_OK != hash_to_scalar_update (&ch_ctx, scalar_buffer,
+			sc_write_bbs (buffer, msg_sc);
+			if (BBS_OK != hash_to_scalar_update (cipher_suite, &h2s_ctx, buffer,
 							     BBS_SCALAR_LEN))
 			{
 				goto cleanup;
 			}
 		}
+		RLC_TRY {
+			ep_mul_sim_lot (partial, signer->generators + i, msg_scalars, chunk_len);
+			ep_add (B, B, partial);
+		}
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
 	}
-	RLC_TRY {
-		// Write out the domain. We reuse scalar_buffer
-		bn_write_bbs (scalar_buffer, domain);
-	}
-	RLC_CATCH_ANY {
+
+	if (BBS_OK != bbs_signer_finish (signer, &h2s_ctx, B, signature))
+	{
 		goto cleanup;
 	}
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, scalar_buffer, BBS_SCALAR_LEN))
+
+	res = BBS_OK;
+cleanup:
+	// The copy of the hash state holds SK
+	bbs_wipe (&h2s_ctx, sizeof(h2s_ctx));
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+		bn_free (msg_scalars[i]);
+	ep_free (B);
+	ep_free (partial);
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+int
+bbs_signer_sign (
+	const bbs_signer   *signer,
+	bbs_signature       signature,
+	uint64_t            num_messages,
+	const bbs_messages *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
 	{
 		goto cleanup;
 	}
-	be_buffer = UINT64_H2BE (presentation_header_len);
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, (uint8_t*) &be_buffer, 8))
+	if (BBS_OK != bbs_signer_sign_v (signer, signature, num_messages, &src))
 	{
 		goto cleanup;
 	}
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, presentation_header, presentation_header_len))
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+static int
+bbs_reissuer_init_v (
+	bbs_reissuer         *reissuer,
+	const bbs_signer     *signer,
+	uint8_t              *scalars,
+	uint64_t              num_messages,
+	const bbs_msg_source *src
+	)
+{
+	bbs_msg_batch msg_batch;
+	sc_t          msg_scalar;
+	int           res = BBS_ERROR;
+
+	reissuer->signer  = signer;
+	reissuer->scalars = scalars;
+
+	ep_null (reissuer->B);
+
+	if (BBS_OK != bbs_msg_batch_init (signer->cipher_suite, &msg_batch, num_messages, src))
 	{
 		goto cleanup;
 	}
-	if (BBS_OK != hash_to_scalar_finalize (&ch_ctx, challenge,
-					       (uint8_t*) BBS_SHA_256_CHALLENGE_DST, LEN (
-						       BBS_SHA_256_CHALLENGE_DST)
-					       - 1))
+	// The domain commits to the number of messages
+	if (num_messages != signer->num_messages)
 	{
 		goto cleanup;
 	}
 
-	proof_ptr = proof + 3 * BBS_G1_ELEM_LEN;
 	RLC_TRY {
-		// Write out the challenge
-		bn_write_bbs (proof + BBS_PROOF_LEN (undisclosed_indexes_len)
-			      - BBS_SCALAR_LEN, challenge);
-
-		// e_hat
-		bn_mul (e, e, challenge);
-		bn_add (e_tilde, e_tilde, e);
-		bn_mod (e_tilde, e_tilde, &(core_get ()->ep_r));
-		bn_write_bbs (proof_ptr, e_tilde);
-		proof_ptr += BBS_SCALAR_LEN;
+		ep_new (reissuer->B);
 
-		// r1_hat
-		bn_mul (r1, r1, challenge);
-		bn_mod (r1, r1, &(core_get ()->ep_r));
-		bn_neg (r1, r1);
-		bn_add (r1_tilde, r1_tilde, r1);
-		bn_mod (r1_tilde, r1_tilde, &(core_get ()->ep_r)); // This works with negative r1_tilde
-		bn_write_bbs (proof_ptr, r1_tilde);
-		proof_ptr += BBS_SCALAR_LEN;
+		ep_copy (reissuer->B, signer->B);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
 
-		// r3_hat (r2 contains r3)
-		bn_mod_inv (r2, r2, &(core_get ()->ep_r));
-		bn_mul (r2, r2, challenge);
-		bn_mod (r2, r2, &(core_get ()->ep_r));
-		bn_neg (r2, r2);
-		bn_add (r3_tilde, r3_tilde, r2);
-		bn_mod (r3_tilde, r3_tilde, &(core_get ()->ep_r)); // This works with negative r3_tilde
-		bn_write_bbs (proof_ptr, r3_tilde);
-		proof_ptr += BBS_SCALAR_LEN;
+	for (uint64_t i = 0; i < num_messages; i++)
+	{
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_scalar))
+		{
+			goto cleanup;
+		}
+		sc_write_bbs (scalars + i * BBS_SCALAR_LEN, msg_scalar);
+	}
+	if (BBS_OK != bbs_msm_octets (reissuer->B, signer->generators, scalars, num_messages))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+int
+bbs_reissuer_init (
+	bbs_reissuer       *reissuer,
+	const bbs_signer   *signer,
+	uint8_t            *scalars,
+	uint64_t            num_messages,
+	const bbs_messages *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_reissuer_init_v (reissuer, signer, scalars, num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+void
+bbs_reissuer_free (
+	bbs_reissuer *reissuer
+	)
+{
+	ep_free (reissuer->B);
+}
+
+
+static int
+bbs_reissuer_update_v (
+	bbs_reissuer         *reissuer,
+	uint64_t              num_updates,
+	const uint64_t       *indexes,
+	const bbs_msg_source *src
+	)
+{
+	const bbs_signer *signer      = reissuer->signer;
+	uint8_t          *new_scalars = NULL;
+	bbs_msg_batch     msg_batch;
+	const uint8_t    *scalar;
+	bn_t              msg_scalar;
+	sc_t              old_sc, new_sc;
+	ep_t              B, delta;
+	int               res = BBS_ERROR;
+
+	bn_null (msg_scalar);
+	ep_null (B);
+	ep_null (delta);
+
+	if (BBS_OK != bbs_msg_batch_init (signer->cipher_suite, &msg_batch, num_updates, src))
+	{
+		goto cleanup;
+	}
+
+	// The new scalars are kept aside until every update succeeded, so that
+	// a failed update leaves B and the scalars as they were
+	if (num_updates > SIZE_MAX / BBS_SCALAR_LEN)
+	{
+		goto cleanup;
+	}
+	new_scalars = bbs_scratch_alloc (num_updates * BBS_SCALAR_LEN);
+	if (num_updates && ! new_scalars)
+	{
+		goto cleanup;
+	}
+	for (uint64_t k = 0; k < num_updates; k++)
+	{
+		if (indexes[k] >= signer->num_messages)
+		{
+			goto cleanup;
+		}
+	}
+
+	RLC_TRY {
+		bn_new (msg_scalar);
+		ep_new (B);
+		ep_new (delta);
+		ep_copy (B, reissuer->B);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
 	}
 
-	for (undisclosed_indexes_idx = 0;
-	     undisclosed_indexes_idx < undisclosed_indexes_len;
-	     undisclosed_indexes_idx++)
+	// B += H_i * (msg_i' - msg_i) for every updated message
+	for (uint64_t k = 0; k < num_updates; k++)
 	{
-		if (BBS_OK != prf (msg_scalar_tilde, 0, undisclosed_indexes_idx, prf_cookie))
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, new_sc))
+		{
+			goto cleanup;
+		}
+
+		// The old scalar is the stored one, unless an earlier update of
+		// this call replaced it
+		scalar = reissuer->scalars + indexes[k] * BBS_SCALAR_LEN;
+		for (uint64_t j = k; j-- > 0;)
+		{
+			if (indexes[j] == indexes[k])
+			{
+				scalar = new_scalars + j * BBS_SCALAR_LEN;
+				break;
+			}
+		}
+		if (BBS_OK != sc_read_bbs (old_sc, scalar))
 		{
 			goto cleanup;
 		}
+		sc_write_bbs (new_scalars + k * BBS_SCALAR_LEN, new_sc);
+		sc_sub (old_sc, new_sc, old_sc);
+
 		RLC_TRY {
-			// m_j_hat
-			bn_read_bbs (msg_scalar, proof_ptr);
-			bn_mul (msg_scalar, msg_scalar, challenge);
-			bn_add (msg_scalar_tilde, msg_scalar_tilde, msg_scalar);
-			bn_mod (msg_scalar_tilde, msg_scalar_tilde, &(core_get ()->ep_r));
-			bn_write_bbs (proof_ptr, msg_scalar_tilde);
-			proof_ptr += BBS_SCALAR_LEN;
+			sc_write_bn (msg_scalar, old_sc);
+			ep_mul (delta, signer->generators[indexes[k]], msg_scalar);
+			ep_add (B, B, delta);
 		}
 		RLC_CATCH_ANY {
 			goto cleanup;
 		}
 	}
 
+	RLC_TRY {
+		ep_copy (reissuer->B, B);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+	for (uint64_t k = 0; k < num_updates; k++)
+	{
+		memcpy (reissuer->scalars + indexes[k] * BBS_SCALAR_LEN,
+			new_scalars + k * BBS_SCALAR_LEN, BBS_SCALAR_LEN);
+	}
+
 	res = BBS_OK;
 cleanup:
-	va_end (ap2);
-	bn_free (e);
-	bn_free (domain);
 	bn_free (msg_scalar);
-	bn_free (msg_scalar_tilde);
-	bn_free (r1);
-	bn_free (r2);
-	bn_free (e_tilde);
-	bn_free (r1_tilde);
-	bn_free (r3_tilde);
-	bn_free (challenge);
-	ep_free (A);
 	ep_free (B);
-	ep_free (Q_1);
-	ep_free (H_i);
-	ep_free (T1);
-	ep_free (T2);
-	ep_free (D);
-	ep_free (Abar);
-	ep_free (Bbar);
+	ep_free (delta);
+	bbs_msg_batch_free (&msg_batch);
+	bbs_scratch_free (new_scalars);
 	return res;
 }
 
 
 int
-bbs_proof_prf (
-	bn_t      out,
-	uint8_t   input_type,
-	uint64_t  input,
-	void     *seed
+bbs_reissuer_update (
+	bbs_reissuer       *reissuer,
+	uint64_t            num_updates,
+	const uint64_t     *indexes,
+	const bbs_messages *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_updates))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_reissuer_update_v (reissuer, num_updates, indexes, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+bbs_reissuer_sign (
+	const bbs_reissuer *reissuer,
+	bbs_signature       signature
+	)
+{
+	const bbs_signer *signer = reissuer->signer;
+	bbs_hash_context  h2s_ctx;
+	int               res    = BBS_ERROR;
+
+	// e still depends on all message scalars, but hashing them is cheap
+	h2s_ctx = signer->e_ctx;
+	if (BBS_OK != hash_to_scalar_update (signer->cipher_suite, &h2s_ctx, reissuer->scalars,
+					     signer->num_messages * BBS_SCALAR_LEN))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_signer_finish (signer, &h2s_ctx, reissuer->B, signature))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	// The copy of the hash state holds SK
+	bbs_wipe (&h2s_ctx, sizeof(h2s_ctx));
+	return res;
+}
+
+
+static int
+bbs_signer_template_init_v (
+	bbs_signer_template  *tmpl,
+	const bbs_signer     *signer,
+	uint8_t              *fixed_scalars,
+	uint64_t              num_fixed,
+	const uint64_t       *fixed_indexes,
+	const bbs_msg_source *src
+	)
+{
+	bbs_msg_batch msg_batch;
+	bn_t          msg_scalar;
+	sc_t          msg_sc;
+	ep_t          term;
+	int           res = BBS_ERROR;
+
+	tmpl->signer        = signer;
+	tmpl->fixed_scalars = fixed_scalars;
+	tmpl->fixed_indexes = fixed_indexes;
+	tmpl->num_fixed     = num_fixed;
+
+	bn_null (msg_scalar);
+	ep_null (term);
+	ep_null (tmpl->B);
+
+	if (BBS_OK != bbs_msg_batch_init (signer->cipher_suite, &msg_batch, num_fixed, src))
+	{
+		goto cleanup;
+	}
+	// Fixed indexes have to be sorted and within range
+	if (num_fixed > signer->num_messages)
+	{
+		goto cleanup;
+	}
+	for (uint64_t k = 0; k < num_fixed; k++)
+	{
+		if (fixed_indexes[k] >= signer->num_messages ||
+		    (k && fixed_indexes[k] <= fixed_indexes[k - 1]))
+		{
+			goto cleanup;
+		}
+	}
+
+	RLC_TRY {
+		bn_new (msg_scalar);
+		ep_new (term);
+		ep_new (tmpl->B);
+
+		ep_copy (tmpl->B, signer->B);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// B += H_i * msg_i for the fixed messages, once per template
+	for (uint64_t k = 0; k < num_fixed; k++)
+	{
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_sc))
+		{
+			goto cleanup;
+		}
+		sc_write_bbs (fixed_scalars + k * BBS_SCALAR_LEN, msg_sc);
+		RLC_TRY {
+			sc_write_bn (msg_scalar, msg_sc);
+			ep_mul (term, signer->generators[fixed_indexes[k]], msg_scalar);
+			ep_add (tmpl->B, tmpl->B, term);
+		}
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
+	}
+
+	res = BBS_OK;
+cleanup:
+	bn_free (msg_scalar);
+	ep_free (term);
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+int
+bbs_signer_template_init (
+	bbs_signer_template *tmpl,
+	const bbs_signer    *signer,
+	uint8_t             *fixed_scalars,
+	uint64_t             num_fixed,
+	const uint64_t      *fixed_indexes,
+	const bbs_messages  *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_fixed))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_signer_template_init_v (tmpl, signer, fixed_scalars, num_fixed,
+						  fixed_indexes, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+void
+bbs_signer_template_free (
+	bbs_signer_template *tmpl
+	)
+{
+	ep_free (tmpl->B);
+}
+
+
+static int
+bbs_signer_template_sign_v (
+	const bbs_signer_template *tmpl,
+	bbs_signature              signature,
+	uint64_t                   num_messages,
+	const bbs_msg_source      *src
+	)
+{
+	const bbs_signer      *signer       = tmpl->signer;
+	const bbs_ciphersuite *cipher_suite = signer->cipher_suite;
+	bbs_hash_context       h2s_ctx;
+	bbs_msg_batch          msg_batch;
+	uint8_t                buffer[BBS_SCALAR_LEN];
+	sc_t                   msg_sc;
+	bn_t                   msg_scalars[BBS_MSM_CHUNK_LEN];
+	ep_t                   H_i[BBS_MSM_CHUNK_LEN];
+	ep_t                   B, partial;
+	uint64_t               fixed_idx    = 0;
+	uint64_t               variable_idx = 0;
+	uint64_t               chunk_len    = 0;
+	int                    res          = BBS_ERROR;
+
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+	{
+		bn_null (msg_scalars[i]);
+		ep_null (H_i[i]);
+	}
+	ep_null (B);
+	ep_null (partial);
+
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, num_messages, src))
+	{
+		goto cleanup;
+	}
+	// Only the variable messages are passed
+	if (num_messages != signer->num_messages - tmpl->num_fixed)
+	{
+		goto cleanup;
+	}
+	h2s_ctx = signer->e_ctx;
+
+	RLC_TRY {
+		for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+		{
+			bn_new (msg_scalars[i]);
+			ep_new (H_i[i]);
+		}
+		ep_new (B);
+		ep_new (partial);
+
+		ep_copy (B, tmpl->B);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// e still hashes all message scalars in order, but B only needs the
+	// variable ones, one multi-scalar multiplication per chunk
+	for (uint64_t i = 0; i < signer->num_messages; i++)
+	{
+		if (fixed_idx < tmpl->num_fixed && tmpl->fixed_indexes[fixed_idx] == i)
+		{
+			if (BBS_OK != hash_to_scalar_update (cipher_suite, &h2s_ctx,
+							     tmpl->fixed_scalars + fixed_idx *
+							     BBS_SCALAR_LEN, BBS_SCALAR_LEN))
+			{
+				goto cleanup;
+			}
+			fixed_idx++;
+			continue;
+		}
+
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_sc))
+		{
+			goto cleanup;
+		}
+		sc_write_bbs (buffer, msg_sc);
+		RLC_TRY {
+			sc_write_bn (msg_scalars[chunk_len], msg_sc);
+			ep_copy (H_i[chunk_len], signer->generators[i]);
+		}
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
+		if (BBS_OK != hash_to_scalar_update (cipher_suite, &h2s_ctx, buffer, BBS_SCALAR_LEN))
+		{
+			goto cleanup;
+		}
+		variable_idx++;
+		chunk_len++;
+
+		if (BBS_MSM_CHUNK_LEN == chunk_len || variable_idx == num_messages)
+		{
+			RLC_TRY {
+				ep_mul_sim_lot (partial, H_i, msg_scalars, chunk_len);
+				ep_add (B, B, partial);
+			}
+			RLC_CATCH_ANY {
+				goto cleanup;
+			}
+			chunk_len = 0;
+		}
+	}
+
+	if (BBS_OK != bbs_signer_finish (signer, &h2s_ctx, B, signature))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	// The copy of the hash state holds SK
+	bbs_wipe (&h2s_ctx, sizeof(h2s_ctx));
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+	{
+		bn_free (msg_scalars[i]);
+		ep_free (H_i[i]);
+	}
+	ep_free (B);
+	ep_free (partial);
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+int
+bbs_signer_template_sign (
+	const bbs_signer_template *tmpl,
+	bbs_signature              signature,
+	uint64_t                   num_messages,
+	const bbs_messages        *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_signer_template_sign_v (tmpl, signature, num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+
+static int
+bbs_prepared_pk_init (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_prepared_pk       *ppk,
+	const bbs_public_key   pk
+	)
+{
+	int res = BBS_ERROR;
+
+	ep2_null (ppk->W);
+	ppk->cipher_suite = cipher_suite;
+	memcpy (ppk->pk, pk, BBS_PK_LEN);
+
+	RLC_TRY {
+		ep2_new (ppk->W);
+		ep2_read_bbs (ppk->W, pk);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// KeyValidate, including the subgroup check that we skip when parsing
+	// a public key for a single verification
+	if (ep2_is_infty (ppk->W) || ! ep2_is_valid (ppk->W))
+	{
+		goto cleanup;
+	}
+
+	// Every domain starts with the public key, so that we can keep the
+	// hash state after it
+	if (BBS_OK != hash_to_scalar_init (cipher_suite, &ppk->dom_ctx))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &ppk->dom_ctx, pk, BBS_PK_LEN))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+static void
+bbs_prepared_pk_clean (
+	bbs_prepared_pk *ppk
+	)
+{
+	ep2_free (ppk->W);
+}
+
+
+int
+bbs_prepared_pk_new (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_prepared_pk      **ppk,
+	const bbs_public_key   pk
+	)
+{
+	int res = BBS_ERROR;
+
+	*ppk = malloc (sizeof(**ppk));
+	if (! *ppk)
+		goto cleanup;
+	if (BBS_OK != bbs_prepared_pk_init (cipher_suite, *ppk, pk))
+	{
+		bbs_prepared_pk_free (*ppk);
+		*ppk = NULL;
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+void
+bbs_prepared_pk_free (
+	bbs_prepared_pk *ppk
+	)
+{
+	if (! ppk)
+		return;
+	bbs_prepared_pk_clean (ppk);
+	free (ppk);
+}
+
+
+// calculate_domain_init, resuming from the hash state of a prepared public key
+// if there is one
+static int
+bbs_domain_init (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx,
+	const bbs_public_key   pk,
+	const bbs_prepared_pk *ppk,
+	uint64_t               num_messages
+	)
+{
+	uint64_t num_messages_be = UINT64_H2BE (num_messages);
+	int      res             = BBS_ERROR;
+
+	if (! ppk)
+	{
+		return calculate_domain_init (cipher_suite, ctx, pk, num_messages);
+	}
+	if (ppk->cipher_suite != cipher_suite)
+	{
+		goto cleanup;
+	}
+
+	*ctx = ppk->dom_ctx;
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ctx, (uint8_t*) &num_messages_be, 8))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+// bbs_verify, but leaves the final pairing check to the caller
+static int
+bbs_verify_deferred_v (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_pairing_check     *check,
+	const bbs_public_key   pk,
+	const bbs_prepared_pk *ppk,
+	const bbs_signature    signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	uint8_t          generator_ctx[48 + 8];
+	bbs_hash_context dom_ctx;
+	bbs_msg_batch    msg_batch;
+	bn_t             e, domain, msg_scalar;
+	sc_t             msg_sc;
+	ep_t             A, B, Q_1, H_i;
+	ep2_t            W;
+	int              res = BBS_ERROR;
+
+	bn_null (e);
+	bn_null (domain);
+	bn_null (msg_scalar);
+	ep_null (A);
+	ep_null (B);
+	ep_null (Q_1);
+	ep_null (H_i);
+	ep2_null (W);
+
+	if (! header)
+	{
+		header     = (uint8_t*) "";
+		header_len = 0;
+	}
+
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, num_messages, src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != create_generator_init (cipher_suite, generator_ctx))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_domain_init (cipher_suite, &dom_ctx, pk, ppk, num_messages))
+	{
+		goto cleanup;
+	}
+
+	RLC_TRY {
+		bn_new (e);
+		bn_new (domain);
+		bn_new (msg_scalar);
+		ep_new (A);
+		ep_new (B);
+		ep_new (Q_1);
+		ep_new (H_i);
+		ep2_new (W);
+
+		// Initialize B to P1, and parse signature
+		ep_read_bbs (B, cipher_suite->p1);
+		ep_read_bbs (A, signature);
+		bn_read_bbs (e, signature + BBS_G1_ELEM_LEN);
+		if (ppk)
+			ep2_copy (W, ppk->W);
+		else
+			ep2_read_bbs (W, pk);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// Calculate Q_1
+	if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+
+	for (int i = 0; i<num_messages; i++)
+	{
+		// Calculate H_i
+		if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, H_i))
+		{
+			goto cleanup;
+		}
+		if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, H_i))
+		{
+			goto cleanup;
+		}
+
+		// Calculate msg_scalar (batched)
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_sc))
+		{
+			goto cleanup;
+		}
+		RLC_TRY {
+			// Update B
+			sc_write_bn (msg_scalar, msg_sc);
+			ep_mul (H_i, H_i, msg_scalar);
+			ep_add (B, B, H_i);
+		}
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
+	}
+
+	// Finalize domain calculation
+	if (BBS_OK != calculate_domain_finalize (cipher_suite, &dom_ctx, domain, header,
+						 header_len))
+	{
+		goto cleanup;
+	}
+	RLC_TRY {
+		// Update B
+		ep_mul (Q_1, Q_1, domain);
+		ep_add (B, B, Q_1);
+
+		// The signature is valid iff e(A, W + BP2 * e) * e(B, -BP2) is
+		// the identity. We rewrite this as e(A, W) * e(B - A * e, -BP2),
+		// which trades a G2 for a G1 multiplication and fits the
+		// deferred pairing checks. This is up to the caller.
+		ep_copy (check->A, A);
+		ep_mul (A, A, e);
+		ep_sub (check->B, B, A);
+		ep2_copy (check->W, W);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bn_free (e);
+	bn_free (domain);
+	bn_free (msg_scalar);
+	ep_free (A);
+	ep_free (B);
+	ep_free (Q_1);
+	ep_free (H_i);
+	ep2_free (W);
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+int
+bbs_verify_deferred (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_pairing_check     *check,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list        ap;
+	bbs_msg_source src = { .ap = &ap };
+	int            res = BBS_ERROR;
+
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_verify_deferred_v (cipher_suite, check, pk, NULL, signature, header,
+					     header_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	return res;
+}
+
+
+int
+bbs_verify_deferred_prepared (
+	bbs_pairing_check     *check,
+	const bbs_prepared_pk *ppk,
+	const bbs_signature    signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_verify_deferred_v (ppk->cipher_suite, check, ppk->pk, ppk, signature,
+					     header, header_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+bbs_verify (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list           ap;
+	bbs_pairing_check check;
+	bbs_msg_source    src = { .ap = &ap };
+	int               res = BBS_ERROR;
+
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_verify_deferred_v (cipher_suite, &check, pk, NULL, signature, header,
+					     header_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+int
+bbs_verify_prepared (
+	const bbs_prepared_pk *ppk,
+	const bbs_signature    signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_pairing_check check;
+	int               res = BBS_ERROR;
+
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_verify_deferred_prepared (&check, ppk, signature, header, header_len,
+						    num_messages, messages))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+int
+bbs_verify_scalars (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list           ap;
+	bbs_pairing_check check;
+	bbs_msg_source    src = { .msg_scalars = 1, .ap = &ap };
+	int               res = BBS_ERROR;
+
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_verify_deferred_v (cipher_suite, &check, pk, NULL, signature, header,
+					     header_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+int
+bbs_verify_array (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_pairing_check check;
+	bbs_msg_source    src;
+	int               res = BBS_ERROR;
+
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_verify_deferred_v (cipher_suite, &check, pk, NULL, signature, header,
+					     header_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+// Hashes the scalars of the disclosed messages into the challenge. They are
+// taken from disclosed_scalars if set, or else mapped once more from src.
+static int
+bbs_challenge_update_disclosed (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ch_ctx,
+	const uint8_t         *disclosed_scalars,
+	uint64_t               disclosed_indexes_len,
+	const bbs_msg_source  *src
+	)
+{
+	uint8_t       scalar_buffer[BBS_SCALAR_LEN];
+	bbs_msg_batch msg_batch;
+	sc_t          msg_scalar;
+	int           res = BBS_ERROR;
+
+	if (disclosed_scalars || ! disclosed_indexes_len)
+	{
+		if (! disclosed_indexes_len)
+			return BBS_OK;
+		return hash_to_scalar_update (cipher_suite, ch_ctx, disclosed_scalars,
+					      disclosed_indexes_len * BBS_SCALAR_LEN);
+	}
+
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, disclosed_indexes_len, src))
+	{
+		goto cleanup;
+	}
+
+	for (uint64_t i = 0; i < disclosed_indexes_len; i++)
+	{
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_scalar))
+		{
+			goto cleanup;
+		}
+		sc_write_bbs (scalar_buffer, msg_scalar);
+		if (BBS_OK != hash_to_scalar_update (cipher_suite, ch_ctx, scalar_buffer,
+						     BBS_SCALAR_LEN))
+		{
+			goto cleanup;
+		}
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+// Completes the part of a proof that does not depend on the presentation
+// header, given the signature (A, e), B = P1 + Q_1 * domain + H_1 * msg_1 +
+// ... + H_L * msg_L and the sum of H_j * msg_tilde_j over the undisclosed
+// messages in T2. Writes Abar, Bbar and D to proof and hashes the challenge up
+// to the presentation header into precomp. Without disclosed_scalars, the
+// disclosed messages are mapped again from disclosed_src.
+static int
+bbs_proof_commit (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_proof_precomp     *precomp,
+	uint8_t               *proof,
+	const ep_t             A,
+	const bn_t             e,
+	const ep_t             B,
+	ep_t                   T2,
+	const uint8_t          domain[BBS_SCALAR_LEN],
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	const uint8_t         *disclosed_scalars,
+	const bbs_msg_source  *disclosed_src,
+	uint64_t               undisclosed_indexes_len,
+	bbs_bn_prf             prf,
+	void                  *prf_cookie
+	)
+{
+	uint8_t           T_buffer[2 * BBS_G1_ELEM_LEN];
+	uint64_t          be_buffer;
+	bbs_hash_context *ch_ctx = &precomp->ch_ctx;
+	bn_t              r1, r2, e_tilde, r1_tilde, r3_tilde;
+	ep_t              T1, D, Abar, Bbar, tmp;
+	int               res = BBS_ERROR;
+
+	bn_null (r1);
+	bn_null (r2);
+	bn_null (e_tilde);
+	bn_null (r1_tilde);
+	bn_null (r3_tilde);
+	ep_null (T1);
+	ep_null (D);
+	ep_null (Abar);
+	ep_null (Bbar);
+	ep_null (tmp);
+
+	RLC_TRY {
+		bn_new (r1);
+		bn_new (r2);
+		bn_new (e_tilde);
+		bn_new (r1_tilde);
+		bn_new (r3_tilde);
+		ep_new (T1);
+		ep_new (D);
+		ep_new (Abar);
+		ep_new (Bbar);
+		ep_new (tmp);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// Derive random scalars. The msg_scalar_tilde scalars are the caller's
+	if (BBS_OK != prf (r1,       BBS_PRF_R1,       0, prf_cookie))
+		goto cleanup;
+	if (BBS_OK != prf (r2,       BBS_PRF_R2,       0, prf_cookie))
+		goto cleanup;
+	if (BBS_OK != prf (e_tilde,  BBS_PRF_E_TILDE,  0, prf_cookie))
+		goto cleanup;
+	if (BBS_OK != prf (r1_tilde, BBS_PRF_R1_TILDE, 0, prf_cookie))
+		goto cleanup;
+	if (BBS_OK != prf (r3_tilde, BBS_PRF_R3_TILDE, 0, prf_cookie))
+		goto cleanup;
+
+	RLC_TRY {
+		// Calculate and write out D to proof
+		ep_mul (D, B, r2);
+		ep_write_bbs (proof + 2 * BBS_G1_ELEM_LEN, D);
+
+		// Calculate and write out Abar to proof
+		ep_mul (Abar, A,    r1);
+		ep_mul (Abar, Abar, r2);
+		ep_write_bbs (proof, Abar);
+
+		// Calculate and write out Bbar to proof
+		ep_mul (Bbar, D,    r1);
+		ep_mul (tmp,  Abar, e);
+		ep_neg (tmp, tmp);
+		ep_add (Bbar, Bbar, tmp);
+		ep_write_bbs (proof + BBS_G1_ELEM_LEN, Bbar);
+
+		// Calculate and write out T1 and T2 for the challenge
+		ep_mul (tmp, D, r3_tilde);
+		ep_add (T2, T2, tmp);
+		ep_mul (T1,  D,    r1_tilde);
+		ep_mul (tmp, Abar, e_tilde);
+		ep_add (T1, T1, tmp);
+		ep_write_bbs (T_buffer,                   T1);
+		ep_write_bbs (T_buffer + BBS_G1_ELEM_LEN, T2);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// Calculate the challenge up to the presentation header
+	if (BBS_OK != hash_to_scalar_init (cipher_suite, ch_ctx))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ch_ctx, proof, 3 * BBS_G1_ELEM_LEN))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ch_ctx, T_buffer, 2 * BBS_G1_ELEM_LEN))
+	{
+		goto cleanup;
+	}
+	be_buffer = UINT64_H2BE (disclosed_indexes_len);
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ch_ctx, (uint8_t*) &be_buffer, 8))
+	{
+		goto cleanup;
+	}
+	// Given a better spec, we could merge almost all for loops in here...
+	for (uint64_t i = 0; i<disclosed_indexes_len; i++)
+	{
+		be_buffer = UINT64_H2BE (disclosed_indexes[i]);
+		if (BBS_OK != hash_to_scalar_update (cipher_suite, ch_ctx, (uint8_t*) &be_buffer, 8))
+		{
+			goto cleanup;
+		}
+	}
+	if (BBS_OK != bbs_challenge_update_disclosed (cipher_suite, ch_ctx, disclosed_scalars,
+						      disclosed_indexes_len, disclosed_src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ch_ctx, domain, BBS_SCALAR_LEN))
+	{
+		goto cleanup;
+	}
+
+	// Keep the scalars for the responses, with r3 = 1 / r2
+	RLC_TRY {
+		sc_read_bn (precomp->e,        e);
+		sc_read_bn (precomp->r1,       r1);
+		sc_read_bn (precomp->r3,       r2);
+		sc_read_bn (precomp->e_tilde,  e_tilde);
+		sc_read_bn (precomp->r1_tilde, r1_tilde);
+		sc_read_bn (precomp->r3_tilde, r3_tilde);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+	sc_inv (precomp->r3, precomp->r3);
+	precomp->cipher_suite            = cipher_suite;
+	precomp->proof                   = proof;
+	precomp->undisclosed_indexes_len = undisclosed_indexes_len;
+	precomp->ready                   = 1;
+
+	res = BBS_OK;
+cleanup:
+	bn_free (r1);
+	bn_free (r2);
+	bn_free (e_tilde);
+	bn_free (r1_tilde);
+	bn_free (r3_tilde);
+	ep_free (T1);
+	ep_free (D);
+	ep_free (Abar);
+	ep_free (Bbar);
+	ep_free (tmp);
+	return res;
+}
+
+
+// The part of bbs_proof_gen that does not depend on the presentation header.
+// Writes Abar, Bbar, D and, if keep_msg_scalars is set, the undisclosed message
+// scalars to proof, and keeps everything else needed for the responses in
+// precomp. Makes callbacks to prf for random scalars.
+static int
+bbs_proof_gen_offline_det_v (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_proof_precomp     *precomp,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	uint8_t               *proof,
+	int                    keep_msg_scalars,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src,
+	bbs_bn_prf             prf,
+	void                  *prf_cookie
+	)
+{
+	uint8_t          generator_ctx[48 + 8];
+	uint8_t          scalar_buffer[BBS_SCALAR_LEN];
+	uint8_t         *proof_ptr, *disclosed_scalars = NULL;
+	bbs_msg_source   disclosed_src     = *src;
+	bbs_hash_context dom_ctx;
+	bbs_msg_batch    msg_batch;
+	bn_t             e, domain, msg_scalar, msg_scalar_tilde;
+	sc_t             msg_sc;
+	ep_t             A, B, Q_1, H_i, T2, tmp;
+	uint64_t         disclosed_indexes_idx   = 0;
+	uint64_t         undisclosed_indexes_idx = 0;
+	uint64_t         undisclosed_indexes_len = num_messages - disclosed_indexes_len;
+	int              res                     = BBS_ERROR;
+
+	precomp->ready = 0;
+
+	if (! header)
+	{
+		header     = (uint8_t*) "";
+		header_len = 0;
+	}
+
+	bn_null (e);
+	bn_null (domain);
+	bn_null (msg_scalar);
+	bn_null (msg_scalar_tilde);
+	ep_null (A);
+	ep_null (B);
+	ep_null (Q_1);
+	ep_null (H_i);
+	ep_null (T2);
+	ep_null (tmp);
+
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, num_messages, src))
+	{
+		goto cleanup;
+	}
+
+	// The disclosed message scalars enter the challenge only after the
+	// domain, which needs all generators first. We keep them from the single
+	// pass over the messages instead of mapping them again, unless streaming.
+	disclosed_src.skip     = NULL;
+	disclosed_src.skip_len = 0;
+	disclosed_src.pick     = disclosed_indexes;
+	if (! src->stream)
+	{
+		disclosed_scalars = bbs_scratch_alloc (disclosed_indexes_len * BBS_SCALAR_LEN);
+		if (! disclosed_scalars && disclosed_indexes_len)
+			goto cleanup;
+	}
+
+	if (BBS_OK != create_generator_init (cipher_suite, generator_ctx))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != calculate_domain_init (cipher_suite, &dom_ctx, pk, num_messages))
+	{
+		goto cleanup;
+	}
+
+	RLC_TRY {
+		bn_new (e);
+		bn_new (domain);
+		bn_new (msg_scalar);
+		bn_new (msg_scalar_tilde);
+		ep_new (A);
+		ep_new (B);
+		ep_new (Q_1);
+		ep_new (H_i);
+		ep_new (T2);
+		ep_new (tmp);
+
+		// Initialize B to P1 and T2 to the identity
+		ep_read_bbs (B, cipher_suite->p1);
+		ep_set_infty (T2);
+
+		// Parse the signature
+		ep_read_bbs (A, signature);
+		bn_read_bbs (e, signature + BBS_G1_ELEM_LEN);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// Calculate Q_1
+	if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+
+	proof_ptr = proof + 3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN; // m_hat
+	for (uint64_t i = 0; i<num_messages; i++)
+	{
+		// Calculate H_i
+		if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, H_i))
+		{
+			goto cleanup;
+		}
+		if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, H_i))
+		{
+			goto cleanup;
+		}
+
+		// Calculate msg_scalar (batched)
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_sc))
+		{
+			goto cleanup;
+		}
+		RLC_TRY {
+			// Update B. Use tmp, because we need H_i below
+			sc_write_bn (msg_scalar, msg_sc);
+			ep_mul (tmp, H_i, msg_scalar);
+			ep_add (B, B, tmp);
+		}
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
+
+		if (disclosed_indexes_idx < disclosed_indexes_len &&
+		    disclosed_indexes[disclosed_indexes_idx] == i)
+		{
+			// This message is disclosed. Keep its scalar for the
+			// challenge
+			if (disclosed_scalars)
+				sc_write_bbs (disclosed_scalars + disclosed_indexes_idx *
+					      BBS_SCALAR_LEN, msg_sc);
+			disclosed_indexes_idx++;
+		}
+		else
+		{
+			// This message is undisclosed. Derive new random scalar
+			// and accumulate it onto T2
+			if (BBS_OK != prf (msg_scalar_tilde, BBS_PRF_MSG_SCALAR,
+					   undisclosed_indexes_idx, prf_cookie))
+			{
+				goto cleanup;
+			}
+
+			RLC_TRY {
+				// Update T2
+				ep_mul (H_i, H_i, msg_scalar_tilde);
+				ep_add (T2, T2, H_i);
+			}
+			RLC_CATCH_ANY {
+				goto cleanup;
+			}
+
+			// Save msg_scalar in the proof so that one day we do not
+			// need to recalculate it
+			if (keep_msg_scalars)
+			{
+				sc_write_bbs (proof_ptr, msg_sc);
+				proof_ptr += BBS_SCALAR_LEN;
+			}
+			undisclosed_indexes_idx++;
+		}
+	}
+
+	// Sanity check. If any indices for disclosed messages were out of order
+	// or invalid, we fail here.
+	if (disclosed_indexes_idx != disclosed_indexes_len)
+	{
+		goto cleanup;
+	}
+
+	// Finalize domain calculation
+	if (BBS_OK != calculate_domain_finalize (cipher_suite, &dom_ctx, domain, header,
+						 header_len))
+	{
+		goto cleanup;
+	}
+	RLC_TRY {
+		// Update B
+		ep_mul (Q_1, Q_1, domain);
+		ep_add (B, B, Q_1);
+
+		bn_write_bbs (scalar_buffer, domain);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	if (BBS_OK != bbs_proof_commit (cipher_suite, precomp, proof, A, e, B, T2, scalar_buffer,
+					disclosed_indexes, disclosed_indexes_len,
+					disclosed_scalars, &disclosed_src, undisclosed_indexes_len,
+					prf, prf_cookie))
+	{
+		goto cleanup;
+	}
+
+	// Without message scalars in it, proof is no concern of
+	// bbs_proof_precomp_free
+	if (! keep_msg_scalars)
+		precomp->proof = NULL;
+
+	res = BBS_OK;
+cleanup:
+	// The message scalars written so far are secret
+	if (BBS_OK != res && keep_msg_scalars)
+		bbs_wipe (proof + 3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN,
+			  undisclosed_indexes_idx * BBS_SCALAR_LEN);
+	bbs_scratch_free (disclosed_scalars);
+	bn_free (e);
+	bn_free (domain);
+	bn_free (msg_scalar);
+	bn_free (msg_scalar_tilde);
+	ep_free (A);
+	ep_free (B);
+	ep_free (Q_1);
+	ep_free (H_i);
+	ep_free (T2);
+	ep_free (tmp);
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+// Hashes the presentation header into the challenge of precomp, and writes
+// e_hat, r1_hat and r3_hat to responses. The challenge is returned in c_sc.
+static int
+bbs_proof_respond (
+	const bbs_proof_precomp *precomp,
+	const uint8_t           *presentation_header,
+	uint64_t                 presentation_header_len,
+	sc_t                     c_sc,
+	uint8_t                  responses[3 * BBS_SCALAR_LEN]
+	)
+{
+	const bbs_ciphersuite *cipher_suite = precomp->cipher_suite;
+	uint64_t               be_buffer;
+	bbs_hash_context       ch_ctx;
+	bn_t                   challenge;
+	sc_t                   s_sc, t_sc;
+	int                    res = BBS_ERROR;
+
+	bn_null (challenge);
+
+	if (! precomp->ready)
+	{
+		goto cleanup;
+	}
+
+	if (! presentation_header)
+	{
+		presentation_header     = (uint8_t*) "";
+		presentation_header_len = 0;
+	}
+
+	RLC_TRY {
+		bn_new (challenge);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// Finish the challenge
+	ch_ctx    = precomp->ch_ctx;
+	be_buffer = UINT64_H2BE (presentation_header_len);
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx, (uint8_t*) &be_buffer, 8))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx, presentation_header,
+					     presentation_header_len))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_finalize (cipher_suite, &ch_ctx, challenge,
+					       cipher_suite->challenge_dst,
+					       cipher_suite->challenge_dst_len))
+	{
+		goto cleanup;
+	}
+	RLC_TRY {
+		sc_read_bn (c_sc, challenge);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// e_hat = e_tilde + e * c
+	sc_mul (s_sc, precomp->e, c_sc);
+	sc_add (t_sc, precomp->e_tilde, s_sc);
+	sc_write_bbs (responses, t_sc);
+
+	// r1_hat = r1_tilde - r1 * c
+	sc_mul (s_sc, precomp->r1, c_sc);
+	sc_sub (t_sc, precomp->r1_tilde, s_sc);
+	sc_write_bbs (responses + BBS_SCALAR_LEN, t_sc);
+
+	// r3_hat = r3_tilde - r3 * c
+	sc_mul (s_sc, precomp->r3, c_sc);
+	sc_sub (t_sc, precomp->r3_tilde, s_sc);
+	sc_write_bbs (responses + 2 * BBS_SCALAR_LEN, t_sc);
+
+	res = BBS_OK;
+cleanup:
+	bn_free (challenge);
+	return res;
+}
+
+
+// State of bbs_proof_prf. Per-message scalars are asked for in order, so they
+// are computed BBS_CHACHA20_LANES at a time and cached.
+typedef struct {
+	uint8_t  seed[32];
+	int      cached;
+	uint64_t cached_first;
+	uint8_t  cache[BBS_CHACHA20_LANES * 64];
+} bbs_proof_prf_state;
+
+
+// Scalar (input_type, input) is the first 48 octets of the ChaCha20 block
+// with nonce input_type and counter input under the seed, reduced modulo r.
+// Unlike hash_to_scalar, this needs one ChaCha20 block per scalar, and any
+// scalar can be computed without the others.
+static int
+bbs_proof_prf_sc (
+	sc_t                 out,
+	uint8_t              input_type,
+	uint64_t             input,
+	bbs_proof_prf_state *state
+	)
+{
+	uint8_t        block[64];
+	const uint8_t *uniform = NULL;
+	int            res     = BBS_ERROR;
+
+	if (input_type >= BBS_PRF_NUM_INPUT_TYPES)
+		goto cleanup;
+
+	if (BBS_PRF_MSG_SCALAR == input_type)
+	{
+		if (! state->cached || input - state->cached_first >= BBS_CHACHA20_LANES)
+		{
+			bbs_chacha20_blocks (state->seed, BBS_PRF_MSG_SCALAR, input, state->cache,
+					     BBS_CHACHA20_LANES);
+			state->cached       = 1;
+			state->cached_first = input;
+		}
+		uniform = state->cache + 64 * (input - state->cached_first);
+	}
+	else
+	{
+		bbs_chacha20_blocks (state->seed, input_type, input, block, 1);
+		uniform = block;
+	}
+	sc_read_wide (out, uniform);
+
+	res = BBS_OK;
+cleanup:
+	if (block == uniform)
+		bbs_wipe (block, sizeof(block));
+	return res;
+}
+
+
+// bbs_proof_prf_sc for the bbs_bn_prf interface, where the scalar is needed
+// for a point multiplication
+int
+bbs_proof_prf (
+	bn_t      out,
+	uint8_t   input_type,
+	uint64_t  input,
+	void     *cookie
+	)
+{
+	sc_t scalar;
+	int  res = BBS_ERROR;
+
+	if (BBS_OK != bbs_proof_prf_sc (scalar, input_type, input, cookie))
+	{
+		goto cleanup;
+	}
+	RLC_TRY {
+		sc_write_bn (out, scalar);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_wipe (scalar, sizeof(scalar));
+	return res;
+}
+
+
+// m_hat = m_tilde + m * c for the undisclosed message with index idx among the
+// undisclosed messages. Neither m nor m_tilde are needed for a point
+// multiplication here, so for bbs_proof_prf, m_tilde is taken as sc_t as well.
+static int
+bbs_proof_respond_msg (
+	uint8_t     msg_scalar_hat[BBS_SCALAR_LEN],
+	const sc_t  msg_scalar,
+	const sc_t  c_sc,
+	uint64_t    idx,
+	bbs_bn_prf  prf,
+	void       *prf_cookie
+	)
+{
+	bn_t msg_scalar_tilde;
+	sc_t s_sc, t_sc;
+	int  res = BBS_ERROR;
+
+	bn_null (msg_scalar_tilde);
+
+	if (bbs_proof_prf == prf)
+	{
+		if (BBS_OK != bbs_proof_prf_sc (t_sc, BBS_PRF_MSG_SCALAR, idx, prf_cookie))
+		{
+			goto cleanup;
+		}
+	}
+	else
+	{
+		RLC_TRY {
+			bn_new (msg_scalar_tilde);
+		}
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
+		if (BBS_OK != prf (msg_scalar_tilde, BBS_PRF_MSG_SCALAR, idx, prf_cookie))
+		{
+			goto cleanup;
+		}
+		RLC_TRY {
+			sc_read_bn (t_sc, msg_scalar_tilde);
+		}
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
+	}
+	sc_mul (s_sc, msg_scalar, c_sc);
+	sc_add (t_sc, t_sc, s_sc);
+	sc_write_bbs (msg_scalar_hat, t_sc);
+
+	res = BBS_OK;
+cleanup:
+	bn_free (msg_scalar_tilde);
+	return res;
+}
+
+
+// The part of bbs_proof_gen that depends on the presentation header. Hashes it
+// into the challenge and writes the responses to the proof. prf has to return
+// the same msg_scalar_tilde values as for bbs_proof_gen_offline_det_v. Once
+// the proof is complete, it no longer holds secrets, which tells
+// bbs_proof_precomp_free to leave it alone.
+static int
+bbs_proof_gen_online_det (
+	bbs_proof_precomp *precomp,
+	const uint8_t     *presentation_header,
+	uint64_t           presentation_header_len,
+	bbs_bn_prf         prf,
+	void              *prf_cookie
+	)
+{
+	uint8_t *proof_ptr = precomp->proof + 3 * BBS_G1_ELEM_LEN;
+	sc_t     c_sc, msg_sc;
+	int      res       = BBS_ERROR;
+
+	if (BBS_OK != bbs_proof_respond (precomp, presentation_header, presentation_header_len,
+					 c_sc, proof_ptr))
+	{
+		goto cleanup;
+	}
+	proof_ptr += 3 * BBS_SCALAR_LEN;
+
+	// m_j_hat = m_j_tilde + m_j * c, with m_j saved in the proof offline
+	for (uint64_t i = 0; i < precomp->undisclosed_indexes_len; i++)
+	{
+		if (BBS_OK != sc_read_bbs (msg_sc, proof_ptr))
+		{
+			goto cleanup;
+		}
+		if (BBS_OK != bbs_proof_respond_msg (proof_ptr, msg_sc, c_sc, i, prf, prf_cookie))
+		{
+			goto cleanup;
+		}
+		proof_ptr += BBS_SCALAR_LEN;
+	}
+
+	// Write out the challenge
+	sc_write_bbs (proof_ptr, c_sc);
+	precomp->ready = 0;
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+// bbs_proof_gen, but makes callbacks to prf for random scalars
+static int
+bbs_proof_gen_det_v (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	uint8_t               *proof,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src,
+	bbs_bn_prf             prf,
+	void                  *prf_cookie
+	)
+{
+	bbs_proof_precomp precomp;
+	int               res = BBS_ERROR;
+
+	if (BBS_OK != bbs_proof_gen_offline_det_v (cipher_suite, &precomp, pk, signature, proof, 1,
+						   header, header_len, disclosed_indexes,
+						   disclosed_indexes_len, num_messages, src, prf,
+						   prf_cookie))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_gen_online_det (&precomp, presentation_header,
+						presentation_header_len, prf, prf_cookie))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_proof_precomp_free (&precomp);
+	return res;
+}
+
+
+// We need to control the random scalars for the fixture tests. This way we do
+// not need to compile a dedicated library for the tests.
+int
+bbs_proof_gen_det (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	uint8_t               *proof,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	bbs_bn_prf             prf,
+	void                  *prf_cookie,
+	va_list                ap
+	)
+{
+	va_list        ap2;
+	bbs_msg_source src = { .ap = &ap2 };
+	int            res;
+
+	// The message batch reads from the va_list by reference
+	va_copy (ap2, ap);
+	res = bbs_proof_gen_det_v (cipher_suite, pk, signature, proof, header, header_len,
+				   presentation_header, presentation_header_len,
+				   disclosed_indexes, disclosed_indexes_len, num_messages, &src,
+				   prf, prf_cookie);
+	va_end (ap2);
+	return res;
+}
+
+
+static int
+bbs_proof_gen_v (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	uint8_t               *proof,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	bbs_proof_prf_state prf_state;
+	int                 ret = BBS_ERROR;
+
+	// Gather randomness. The seed is used for any randomness within this
+	// function. In particular, this implies that we do not need to store
+	// intermediate derivations.
+	prf_state.cached = 0;
+	if (BBS_OK != bbs_rand_bytes (prf_state.seed, 32))
+	{
+		goto cleanup;
+	}
+
+	if (BBS_OK != bbs_proof_gen_det_v (cipher_suite, pk, signature, proof, header,
+					   header_len, presentation_header,
+					   presentation_header_len, disclosed_indexes,
+					   disclosed_indexes_len, num_messages, src,
+					   bbs_proof_prf, &prf_state))
+	{
+		goto cleanup;
+	}
+
+	ret = BBS_OK;
+cleanup:
+	bbs_wipe (&prf_state, sizeof(prf_state));
+	return ret;
+}
+
+
+int
+bbs_proof_gen (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	uint8_t               *proof,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list        ap;
+	bbs_msg_source src = { .ap = &ap };
+	int            res = BBS_ERROR;
+
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_proof_gen_v (cipher_suite, pk, signature, proof, header, header_len,
+				       presentation_header, presentation_header_len,
+				       disclosed_indexes, disclosed_indexes_len,
+				       num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	return res;
+}
+
+
+int
+bbs_proof_gen_scalars (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	uint8_t               *proof,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list        ap;
+	bbs_msg_source src = { .msg_scalars = 1, .ap = &ap };
+	int            res = BBS_ERROR;
+
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_proof_gen_v (cipher_suite, pk, signature, proof, header, header_len,
+				       presentation_header, presentation_header_len,
+				       disclosed_indexes, disclosed_indexes_len,
+				       num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	return res;
+}
+
+
+int
+bbs_proof_gen_array (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	uint8_t               *proof,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_gen_v (cipher_suite, pk, signature, proof, header, header_len,
+				       presentation_header, presentation_header_len,
+				       disclosed_indexes, disclosed_indexes_len, num_messages,
+				       &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+void
+bbs_proof_precomp_free (
+	bbs_proof_precomp *precomp
+	)
+{
+	// Until the online step succeeded, the proof holds the undisclosed
+	// message scalars
+	if (precomp->ready && precomp->proof)
+		bbs_wipe (precomp->proof + 3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN,
+			  precomp->undisclosed_indexes_len * BBS_SCALAR_LEN);
+
+	// The randomness must never be used for two challenges, or the proof
+	// reveals the undisclosed messages
+	bbs_wipe (precomp, sizeof(*precomp));
+}
+
+
+static int
+bbs_proof_gen_offline_v (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_proof_precomp     *precomp,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	uint8_t               *proof,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	bbs_proof_prf_state prf_state;
+	int                 res = BBS_ERROR;
+
+	// The seed is kept, so that the online step derives the same
+	// msg_scalar_tilde values
+	precomp->ready   = 0;
+	prf_state.cached = 0;
+	if (BBS_OK != bbs_rand_bytes (prf_state.seed, 32))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_gen_offline_det_v (cipher_suite, precomp, pk, signature, proof, 1,
+						   header, header_len, disclosed_indexes,
+						   disclosed_indexes_len, num_messages, src,
+						   bbs_proof_prf, &prf_state))
+	{
+		goto cleanup;
+	}
+	memcpy (precomp->seed, prf_state.seed, 32);
+
+	res = BBS_OK;
+cleanup:
+	bbs_wipe (&prf_state, sizeof(prf_state));
+	return res;
+}
+
+
+int
+bbs_proof_gen_offline (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_proof_precomp     *precomp,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	uint8_t               *proof,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_gen_offline_v (cipher_suite, precomp, pk, signature, proof,
+					       header, header_len, disclosed_indexes,
+					       disclosed_indexes_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+bbs_proof_gen_online (
+	bbs_proof_precomp *precomp,
+	const uint8_t     *presentation_header,
+	uint64_t           presentation_header_len
+	)
+{
+	bbs_proof_prf_state prf_state;
+	int                 res = BBS_ERROR;
+
+	prf_state.cached = 0;
+	memcpy (prf_state.seed, precomp->seed, 32);
+	if (BBS_OK != bbs_proof_gen_online_det (precomp, presentation_header,
+						presentation_header_len, bbs_proof_prf,
+						&prf_state))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	// A precomputation is good for a single proof, whatever the outcome
+	bbs_proof_precomp_free (precomp);
+	bbs_wipe (&prf_state, sizeof(prf_state));
+	return res;
+}
+
+
+// bbs_proof_gen_det_v, but hands the proof to write. The undisclosed message
+// scalars are not kept offline, but mapped again once the challenge is known.
+static int
+bbs_proof_gen_stream_det_v (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	bbs_proof_write_fn     write,
+	void                  *write_cookie,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src,
+	bbs_bn_prf             prf,
+	void                  *prf_cookie
+	)
+{
+	uint8_t           head[3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN];
+	uint8_t           chunk[BBS_MSG_BATCH_LEN * BBS_SCALAR_LEN];
+	uint8_t           c_buffer[BBS_SCALAR_LEN];
+	uint8_t          *chunk_ptr;
+	bbs_msg_source    undisclosed_src         = *src;
+	bbs_proof_precomp precomp;
+	bbs_msg_batch     msg_batch;
+	sc_t              msg_scalar, c_sc;
+	uint64_t          undisclosed_indexes_len = num_messages - disclosed_indexes_len;
+	uint64_t          chunk_len;
+	int               res                     = BBS_ERROR;
+
+	memset (&precomp, 0, sizeof(precomp));
+
+	// The second pass over the messages leaves out the disclosed ones, whose
+	// indexes the offline step checks
+	undisclosed_src.skip     = disclosed_indexes;
+	undisclosed_src.skip_len = disclosed_indexes_len;
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, undisclosed_indexes_len,
+					  &undisclosed_src))
+	{
+		goto cleanup;
+	}
+
+	if (BBS_OK != bbs_proof_gen_offline_det_v (cipher_suite, &precomp, pk, signature, head, 0,
+						   header, header_len, disclosed_indexes,
+						   disclosed_indexes_len, num_messages, src, prf,
+						   prf_cookie))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_respond (&precomp, presentation_header, presentation_header_len,
+					 c_sc, head + 3 * BBS_G1_ELEM_LEN))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != write (write_cookie, 0, head, sizeof(head)))
+	{
+		goto cleanup;
+	}
+
+	// m_j_hat = m_j_tilde + m_j * c, a chunk at a time
+	for (uint64_t i = 0; i < undisclosed_indexes_len; i += chunk_len)
+	{
+		chunk_len = undisclosed_indexes_len - i < BBS_MSG_BATCH_LEN ?
+			    undisclosed_indexes_len - i : BBS_MSG_BATCH_LEN;
+		chunk_ptr = chunk;
+		for (uint64_t j = i; j < i + chunk_len; j++)
+		{
+			if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_scalar))
+			{
+				goto cleanup;
+			}
+			if (BBS_OK != bbs_proof_respond_msg (chunk_ptr, msg_scalar, c_sc, j, prf,
+							     prf_cookie))
+			{
+				goto cleanup;
+			}
+			chunk_ptr += BBS_SCALAR_LEN;
+		}
+		if (BBS_OK != write (write_cookie, sizeof(head) + i * BBS_SCALAR_LEN, chunk,
+				     chunk_len * BBS_SCALAR_LEN))
+		{
+			goto cleanup;
+		}
+	}
+
+	// Write out the challenge
+	sc_write_bbs (c_buffer, c_sc);
+	if (BBS_OK != write (write_cookie, BBS_PROOF_LEN (undisclosed_indexes_len) -
+			     BBS_SCALAR_LEN, c_buffer, BBS_SCALAR_LEN))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_proof_precomp_free (&precomp);
+	bbs_wipe (chunk, sizeof(chunk));
+	bbs_wipe (msg_scalar, sizeof(msg_scalar));
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+static int
+bbs_proof_gen_stream_v (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	bbs_proof_write_fn     write,
+	void                  *write_cookie,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	bbs_proof_prf_state prf_state;
+	int                 res = BBS_ERROR;
+
+	prf_state.cached = 0;
+	if (BBS_OK != bbs_rand_bytes (prf_state.seed, 32))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_gen_stream_det_v (cipher_suite, pk, signature, write,
+						  write_cookie, header, header_len,
+						  presentation_header, presentation_header_len,
+						  disclosed_indexes, disclosed_indexes_len,
+						  num_messages, src, bbs_proof_prf, &prf_state))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_wipe (&prf_state, sizeof(prf_state));
+	return res;
+}
+
+
+int
+bbs_proof_gen_stream (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	bbs_proof_write_fn     write,
+	void                  *cookie,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
+	{
+		goto cleanup;
+	}
+	src.stream = 1;
+	if (BBS_OK != bbs_proof_gen_stream_v (cipher_suite, pk, signature, write, cookie,
+					      header, header_len, presentation_header,
+					      presentation_header_len, disclosed_indexes,
+					      disclosed_indexes_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+// The part of proof verification shared by bbs_proof_verify_stream_v and the
+// verifier context. head holds Abar, Bbar, D, e_hat, r1_hat and r3_hat, and Bv
+// and T2 the sums of H_i * msg_scalar_i over the disclosed messages plus P1 +
+// Q_1 * domain, and of H_j * msg_scalar_hat_j over the undisclosed messages.
+// With generators, the disclosed messages first, those sums are completed here
+// from disclosed_scalars and msg_scalar_hats. The indexes enter the challenge
+// as index_octets, the number of disclosed messages and their indexes as
+// 8 octet big-endian integers, or else from disclosed_indexes. Without
+// disclosed_scalars, the disclosed messages are mapped again from src.
+// Assembles T1 and T2, checks the challenge and leaves the pairing check in
+// check.
+static int
+bbs_proof_verify_finish (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_pairing_check     *check,
+	const ep2_t            W,
+	const uint8_t         *head,
+	const uint8_t          challenge_octets[BBS_SCALAR_LEN],
+	ep_t                   Bv,
+	ep_t                   T2,
+	ep_t                  *generators,
+	const uint8_t         *msg_scalar_hats,
+	uint64_t               undisclosed_indexes_len,
+	const uint8_t          domain[BBS_SCALAR_LEN],
+	const uint8_t         *index_octets,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	const uint8_t         *disclosed_scalars,
+	const bbs_msg_source  *src,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len
+	)
+{
+	uint8_t          T_buffer[2 * BBS_G1_ELEM_LEN];
+	uint64_t         be_buffer;
+	bbs_hash_context ch_ctx;
+	bn_t             challenge, challenge_prime, k[3];
+	ep_t             Abar, Bbar, D, T1, P[3];
+	int              res = BBS_ERROR;
+
+	bn_null (challenge);
+	bn_null (challenge_prime);
+	ep_null (Abar);
+	ep_null (Bbar);
+	ep_null (D);
+	ep_null (T1);
+	for (int i = 0; i < 3; i++)
+	{
+		bn_null (k[i]);
+		ep_null (P[i]);
+	}
+
+	if (generators)
+	{
+		if (BBS_OK != bbs_msm_octets (Bv, generators, disclosed_scalars,
+					      disclosed_indexes_len))
+		{
+			goto cleanup;
+		}
+		if (BBS_OK != bbs_msm_octets (T2, generators + disclosed_indexes_len,
+					      msg_scalar_hats, undisclosed_indexes_len))
+		{
+			goto cleanup;
+		}
+	}
+
+	RLC_TRY {
+		bn_new (challenge);
+		bn_new (challenge_prime);
+		ep_new (Abar);
+		ep_new (Bbar);
+		ep_new (D);
+		ep_new (T1);
+		for (int i = 0; i < 3; i++)
+		{
+			bn_new (k[i]);
+			ep_new (P[i]);
+		}
+
+		ep_read_bbs (Abar, head);
+		ep_read_bbs (Bbar, head + BBS_G1_ELEM_LEN);
+		ep_read_bbs (D,    head + 2 * BBS_G1_ELEM_LEN);
+		bn_read_bbs (challenge, challenge_octets);
+		bn_copy (k[0], challenge);
+
+		// T2 += Bv * challenge + D * r3_hat. Use T1 as a temporary
+		bn_read_bbs (k[1], head + 3 * BBS_G1_ELEM_LEN + 2 * BBS_SCALAR_LEN);
+		ep_copy (P[0], Bv);
+		ep_copy (P[1], D);
+		ep_mul_sim_lot (T1, P, k, 2);
+		ep_add (T2, T2, T1);
+
+		// T1 = Bbar * challenge + Abar * e_hat + D * r1_hat
+		bn_read_bbs (k[1], head + 3 * BBS_G1_ELEM_LEN);
+		bn_read_bbs (k[2], head + 3 * BBS_G1_ELEM_LEN + BBS_SCALAR_LEN);
+		ep_copy (P[0], Bbar);
+		ep_copy (P[1], Abar);
+		ep_copy (P[2], D);
+		ep_mul_sim_lot (T1, P, k, 3);
+
+		ep_write_bbs (T_buffer,                   T1);
+		ep_write_bbs (T_buffer + BBS_G1_ELEM_LEN, T2);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// Calculate the challenge
+	if (BBS_OK != hash_to_scalar_init (cipher_suite, &ch_ctx))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx, head, 3 * BBS_G1_ELEM_LEN))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx, T_buffer, 2 * BBS_G1_ELEM_LEN))
+	{
+		goto cleanup;
+	}
+	if (index_octets)
+	{
+		if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx, index_octets,
+						     (disclosed_indexes_len + 1) * 8))
+		{
+			goto cleanup;
+		}
+	}
+	else
+	{
+		be_buffer = UINT64_H2BE (disclosed_indexes_len);
+		if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx, (uint8_t*) &be_buffer,
+						     8))
+		{
+			goto cleanup;
+		}
+		for (uint64_t i = 0; i < disclosed_indexes_len; i++)
+		{
+			be_buffer = UINT64_H2BE (disclosed_indexes[i]);
+			if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx,
+							     (uint8_t*) &be_buffer, 8))
+			{
+				goto cleanup;
+			}
+		}
+	}
+	if (BBS_OK != bbs_challenge_update_disclosed (cipher_suite, &ch_ctx, disclosed_scalars,
+						      disclosed_indexes_len, src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx, domain, BBS_SCALAR_LEN))
+	{
+		goto cleanup;
+	}
+	be_buffer = UINT64_H2BE (presentation_header_len);
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx, (uint8_t*) &be_buffer, 8))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, &ch_ctx, presentation_header,
+					     presentation_header_len))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != hash_to_scalar_finalize (cipher_suite, &ch_ctx, challenge_prime,
+					       cipher_suite->challenge_dst,
+					       cipher_suite->challenge_dst_len))
+	{
+		goto cleanup;
+	}
+
+	// Verification Step 1: The PoK was valid
+	if (RLC_EQ != bn_cmp (challenge, challenge_prime))
+	{
+		goto cleanup;
+	}
+
+	// Verification Step 2: The original signature was valid, i.e.
+	// e(Abar, W) * e(Bbar, -BP2) is the identity. This is up to the caller.
+	RLC_TRY {
+		ep_copy (check->A, Abar);
+		ep_copy (check->B, Bbar);
+		ep2_copy (check->W, W);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bn_free (challenge);
+	bn_free (challenge_prime);
+	ep_free (Abar);
+	ep_free (Bbar);
+	ep_free (D);
+	ep_free (T1);
+	for (int i = 0; i < 3; i++)
+	{
+		bn_free (k[i]);
+		ep_free (P[i]);
+	}
+	return res;
+}
+
+
+// bbs_proof_verify, but takes the proof from read and leaves the final pairing
+// check to the caller. The msg_scalar_hat values are read a chunk at a time.
+static int
+bbs_proof_verify_stream_v (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_pairing_check     *check,
+	const bbs_public_key   pk,
+	const bbs_prepared_pk *ppk,
+	bbs_proof_read_fn      read,
+	void                  *read_cookie,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	uint8_t          generator_ctx[48 + 8];
+	uint8_t          c_buffer[BBS_SCALAR_LEN];
+	uint8_t          domain_buffer[BBS_SCALAR_LEN];
+	uint8_t          head[3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN];
+	uint8_t          chunk[BBS_MSG_BATCH_LEN * BBS_SCALAR_LEN];
+	uint8_t         *disclosed_scalars = NULL;
+	const uint8_t   *proof_ptr         = chunk;
+	bbs_hash_context dom_ctx;
+	bbs_msg_batch    msg_batch;
+	bn_t             domain, msg_scalar;
+	sc_t             msg_sc;
+	ep_t             Bv, Q_1, H_i, T2;
+	ep2_t            W;
+	uint64_t         disclosed_indexes_idx   = 0;
+	uint64_t         undisclosed_indexes_idx = 0;
+	uint64_t         undisclosed_indexes_len = num_messages - disclosed_indexes_len;
+	uint64_t         chunk_len;
+	int              res                     = BBS_ERROR;
+
+	if (! header)
+	{
+		header     = (uint8_t*) "";
+		header_len = 0;
+	}
+
+	if (! presentation_header)
+	{
+		presentation_header     = (uint8_t*) "";
+		presentation_header_len = 0;
+	}
+
+	bn_null (domain);
+	bn_null (msg_scalar);
+	ep_null (Bv);
+	ep_null (Q_1);
+	ep_null (H_i);
+	ep_null (T2);
+	ep2_null (W);
+
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, disclosed_indexes_len,
+					  src))
+	{
+		goto cleanup;
+	}
+
+	// As in proof generation, the disclosed message scalars are kept for the
+	// challenge, which needs the domain first, or mapped again when streaming
+	if (! src->stream)
+	{
+		disclosed_scalars = bbs_scratch_alloc (disclosed_indexes_len * BBS_SCALAR_LEN);
+		if (! disclosed_scalars && disclosed_indexes_len)
+			goto cleanup;
+	}
+
+	// Sanity check. We let the application give us the length explicitly,
+	// and perform the length check here.
+	if (proof_len != BBS_PROOF_LEN (undisclosed_indexes_len))
+	{
+		goto cleanup;
+	}
+
+	// Everything but the msg_scalar_hat values
+	if (BBS_OK != read (read_cookie, 0, head, sizeof(head)))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != read (read_cookie, proof_len - BBS_SCALAR_LEN, c_buffer,
+			    BBS_SCALAR_LEN))
+	{
+		goto cleanup;
+	}
+
+	if (BBS_OK != create_generator_init (cipher_suite, generator_ctx))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_domain_init (cipher_suite, &dom_ctx, pk, ppk, num_messages))
+	{
+		goto cleanup;
+	}
+
+	RLC_TRY {
+		bn_new (domain);
+		bn_new (msg_scalar);
+		ep_new (Bv);
+		ep_new (Q_1);
+		ep_new (H_i);
+		ep_new (T2);
+		ep2_new (W);
+
+		// Parse pk, unless it was prepared
+		if (ppk)
+			ep2_copy (W, ppk->W);
+		else
+			ep2_read_bbs (W, pk);
+
+		// Initialize Bv to P1 and T2 to the identity
+		ep_read_bbs (Bv, cipher_suite->p1);
+		ep_set_infty (T2);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// Calculate Q_1
+	if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+
+	for (uint64_t i = 0; i<num_messages; i++)
+	{
+		// Calculate H_i
+		if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, H_i))
+		{
+			goto cleanup;
+		}
+		if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, H_i))
+		{
+			goto cleanup;
+		}
+
+		if (disclosed_indexes_idx < disclosed_indexes_len &&
+		    disclosed_indexes[disclosed_indexes_idx] == i)
+		{
+			// This message is disclosed.
+			// Calculate msg_scalar (batched) and accumulate onto Bv
+			if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_sc))
+			{
+				goto cleanup;
+			}
+			RLC_TRY {
+				// Update Bv
+				sc_write_bn (msg_scalar, msg_sc);
+				ep_mul (H_i, H_i, msg_scalar);
+				ep_add (Bv, Bv, H_i);
+			}
+			RLC_CATCH_ANY {
+				goto cleanup;
+			}
+			// Keep msg_scalar for the challenge
+			if (disclosed_scalars)
+				sc_write_bbs (disclosed_scalars + disclosed_indexes_idx *
+					      BBS_SCALAR_LEN, msg_sc);
+			disclosed_indexes_idx++;
+		}
+		else
+		{
+			// This message is undisclosed.
+			// Read a msg_scalar_hat value and accumulate it onto T2
+			if (0 == undisclosed_indexes_idx % BBS_MSG_BATCH_LEN)
+			{
+				chunk_len = undisclosed_indexes_len - undisclosed_indexes_idx;
+				if (chunk_len > BBS_MSG_BATCH_LEN)
+					chunk_len = BBS_MSG_BATCH_LEN;
+				if (BBS_OK != read (read_cookie, sizeof(head) + undisclosed_indexes_idx *
+						    BBS_SCALAR_LEN, chunk, chunk_len * BBS_SCALAR_LEN))
+				{
+					goto cleanup;
+				}
+				proof_ptr = chunk;
+			}
+			RLC_TRY {
+				// Update T2
+				bn_read_bbs (msg_scalar, proof_ptr);
+				proof_ptr += BBS_SCALAR_LEN;
+				ep_mul (H_i, H_i, msg_scalar);
+				ep_add (T2, T2, H_i);
+			}
+			RLC_CATCH_ANY {
+				goto cleanup;
+			}
+			undisclosed_indexes_idx++;
+		}
+	}
+
+	// Sanity check. If any indices for disclosed messages were out of order
+	// or invalid, we fail here.
+	if (disclosed_indexes_idx != disclosed_indexes_len)
+	{
+		goto cleanup;
+	}
+
+	// Finalize domain calculation
+	if (BBS_OK != calculate_domain_finalize (cipher_suite, &dom_ctx, domain, header,
+						 header_len))
+	{
+		goto cleanup;
+	}
+	RLC_TRY {
+		// Finalize Bv
+		ep_mul (Q_1, Q_1, domain);
+		ep_add (Bv, Bv, Q_1);
+
+		bn_write_bbs (domain_buffer, domain);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	if (BBS_OK != bbs_proof_verify_finish (cipher_suite, check, W, head, c_buffer, Bv, T2,
+					       NULL, NULL, undisclosed_indexes_len,
+					       domain_buffer, NULL, disclosed_indexes,
+					       disclosed_indexes_len, disclosed_scalars, src,
+					       presentation_header, presentation_header_len))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_scratch_free (disclosed_scalars);
+	bn_free (domain);
+	bn_free (msg_scalar);
+	ep_free (Bv);
+	ep_free (Q_1);
+	ep_free (H_i);
+	ep_free (T2);
+	ep2_free (W);
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+static int
+bbs_proof_read_buffer (
+	void          *cookie,
+	uint64_t       offset,
+	uint8_t       *data,
+	uint64_t       len
+	)
+{
+	memcpy (data, (const uint8_t*) cookie + offset, len);
+	return BBS_OK;
+}
+
+
+// bbs_proof_verify, but leaves the final pairing check to the caller
+static int
+bbs_proof_verify_deferred_v (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_pairing_check     *check,
+	const bbs_public_key   pk,
+	const bbs_prepared_pk *ppk,
+	const uint8_t         *proof,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	return bbs_proof_verify_stream_v (cipher_suite, check, pk, ppk, bbs_proof_read_buffer,
+					  (void*) proof, proof_len, header, header_len,
+					  presentation_header, presentation_header_len,
+					  disclosed_indexes, disclosed_indexes_len, num_messages,
+					  src);
+}
+
+
+int
+bbs_proof_verify_deferred (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_pairing_check     *check,
+	const bbs_public_key   pk,
+	const uint8_t         *proof,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list        ap;
+	bbs_msg_source src = { .ap = &ap };
+	int            res = BBS_ERROR;
+
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_proof_verify_deferred_v (cipher_suite, check, pk, NULL, proof, proof_len,
+						   header, header_len, presentation_header,
+						   presentation_header_len, disclosed_indexes,
+						   disclosed_indexes_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	return res;
+}
+
+
+int
+bbs_proof_verify_deferred_prepared (
+	bbs_pairing_check     *check,
+	const bbs_prepared_pk *ppk,
+	const uint8_t         *proof,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, disclosed_indexes_len))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_verify_deferred_v (ppk->cipher_suite, check, ppk->pk, ppk, proof,
+						   proof_len, header, header_len,
+						   presentation_header, presentation_header_len,
+						   disclosed_indexes, disclosed_indexes_len,
+						   num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+bbs_proof_verify (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const uint8_t         *proof,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list           ap;
+	bbs_pairing_check check;
+	bbs_msg_source    src = { .ap = &ap };
+	int               res = BBS_ERROR;
+
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_verify_deferred_v (cipher_suite, &check, pk, NULL, proof, proof_len,
+						   header, header_len, presentation_header,
+						   presentation_header_len, disclosed_indexes,
+						   disclosed_indexes_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+int
+bbs_proof_verify_prepared (
+	const bbs_prepared_pk *ppk,
+	const uint8_t         *proof,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_pairing_check check;
+	int               res = BBS_ERROR;
+
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_verify_deferred_prepared (&check, ppk, proof, proof_len, header,
+							  header_len, presentation_header,
+							  presentation_header_len, disclosed_indexes,
+							  disclosed_indexes_len, num_messages,
+							  messages))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+int
+bbs_proof_verify_scalars (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const uint8_t         *proof,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	...
+	)
+{
+	va_list           ap;
+	bbs_pairing_check check;
+	bbs_msg_source    src = { .msg_scalars = 1, .ap = &ap };
+	int               res = BBS_ERROR;
+
+	va_start (ap, num_messages);
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_verify_deferred_v (cipher_suite, &check, pk, NULL, proof, proof_len,
+						   header, header_len, presentation_header,
+						   presentation_header_len, disclosed_indexes,
+						   disclosed_indexes_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	va_end (ap);
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+int
+bbs_proof_verify_array (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	const uint8_t         *proof,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_pairing_check check;
+	bbs_msg_source    src;
+	int               res = BBS_ERROR;
+
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, disclosed_indexes_len))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_verify_deferred_v (cipher_suite, &check, pk, NULL, proof, proof_len,
+						   header, header_len, presentation_header,
+						   presentation_header_len, disclosed_indexes,
+						   disclosed_indexes_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+static int
+bbs_proof_verify_stream_src (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	bbs_proof_read_fn      read,
+	void                  *cookie,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	bbs_pairing_check check;
+	int               res = BBS_ERROR;
+
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_verify_stream_v (cipher_suite, &check, pk, NULL, read, cookie,
+						 proof_len, header, header_len,
+						 presentation_header, presentation_header_len,
+						 disclosed_indexes, disclosed_indexes_len,
+						 num_messages, src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+int
+bbs_proof_verify_stream (
+	const bbs_ciphersuite *cipher_suite,
+	const bbs_public_key   pk,
+	bbs_proof_read_fn      read,
+	void                  *cookie,
+	uint64_t               proof_len,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint8_t         *presentation_header,
+	uint64_t               presentation_header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, disclosed_indexes_len))
+	{
+		goto cleanup;
+	}
+	src.stream = 1;
+	if (BBS_OK != bbs_proof_verify_stream_src (cipher_suite, pk, read, cookie, proof_len,
+						   header, header_len, presentation_header,
+						   presentation_header_len, disclosed_indexes,
+						   disclosed_indexes_len, num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+// Orders disclosed indexes for qsort
+static int
+bbs_index_cmp (
+	const void *a,
+	const void *b
+	)
+{
+	uint64_t x = *(const uint64_t*) a;
+	uint64_t y = *(const uint64_t*) b;
+
+	return (x > y) - (x < y);
+}
+
+
+int
+bbs_proof_verifier_init (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_proof_verifier    *verifier,
+	const bbs_public_key   pk,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	const uint64_t        *disclosed_indexes,
+	uint64_t               disclosed_indexes_len,
+	ep_t                  *generators,
+	uint64_t               num_messages
+	)
+{
+	uint8_t          generator_ctx[48 + 8];
+	bbs_hash_context dom_ctx;
+	uint64_t        *sorted          = NULL;
+	uint64_t         disclosed_idx   = 0;
+	uint64_t         undisclosed_idx = 0;
+	uint64_t         be_buffer;
+	bn_t             domain;
+	ep_t             Q_1;
+	ep_t            *H_i;
+	int              res             = BBS_ERROR;
+
+	verifier->num_messages          = num_messages;
+	verifier->disclosed_indexes_len = disclosed_indexes_len;
+	verifier->index_octets          = NULL;
+	verifier->generators            = generators;
+
+	bn_null (domain);
+	ep_null (Q_1);
+	ep_null (verifier->Bv);
+	for (uint64_t i = 0; i < num_messages; i++)
+		ep_null (generators[i]);
+
+	if (BBS_OK != bbs_prepared_pk_init (cipher_suite, &verifier->ppk, pk))
+	{
+		goto cleanup;
+	}
+
+	if (! header)
+	{
+		header     = (uint8_t*) "";
+		header_len = 0;
+	}
+
+	// Sort the disclosed indexes, and reject duplicates and indexes out of
+	// range
+	if (disclosed_indexes_len > num_messages)
+	{
+		goto cleanup;
+	}
+	// The index octets stay with the verifier, so only the sorted copy can
+	// come from an arena
+	verifier->index_octets = malloc ((disclosed_indexes_len + 1) * 8);
+	sorted                 = bbs_scratch_alloc (disclosed_indexes_len * sizeof(*sorted));
+	if ((! sorted && disclosed_indexes_len) || ! verifier->index_octets)
+	{
+		goto cleanup;
+	}
+	if (disclosed_indexes_len)
+	{
+		memcpy (sorted, disclosed_indexes, disclosed_indexes_len * sizeof(*sorted));
+		qsort (sorted, disclosed_indexes_len, sizeof(*sorted), bbs_index_cmp);
+	}
+	for (uint64_t i = 0; i < disclosed_indexes_len; i++)
+	{
+		if (sorted[i] >= num_messages || (i && sorted[i] == sorted[i - 1]))
+		{
+			goto cleanup;
+		}
+	}
+
+	// The number of disclosed messages and their indexes, as they enter the
+	// challenge
+	be_buffer = UINT64_H2BE (disclosed_indexes_len);
+	memcpy (verifier->index_octets, &be_buffer, 8);
+	for (uint64_t i = 0; i < disclosed_indexes_len; i++)
+	{
+		be_buffer = UINT64_H2BE (sorted[i]);
+		memcpy (verifier->index_octets + 8 * (i + 1), &be_buffer, 8);
+	}
+
+	if (BBS_OK != create_generator_init (cipher_suite, generator_ctx))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_domain_init (cipher_suite, &dom_ctx, pk, &verifier->ppk, num_messages))
+	{
+		goto cleanup;
+	}
+
+	RLC_TRY {
+		bn_new (domain);
+		ep_new (Q_1);
+		ep_new (verifier->Bv);
+		for (uint64_t i = 0; i < num_messages; i++)
+			ep_new (generators[i]);
+
+		// Initialize Bv to P1
+		ep_read_bbs (verifier->Bv, cipher_suite->p1);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// Calculate Q_1
+	if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+
+	// The generators of disclosed messages go first, those of undisclosed
+	// messages after them
+	for (uint64_t i = 0; i < num_messages; i++)
+	{
+		if (disclosed_idx < disclosed_indexes_len && sorted[disclosed_idx] == i)
+			H_i = &generators[disclosed_idx++];
+		else
+			H_i = &generators[disclosed_indexes_len + undisclosed_idx++];
+
+		if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, *H_i))
+		{
+			goto cleanup;
+		}
+		if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, *H_i))
+		{
+			goto cleanup;
+		}
+	}
+
+	if (BBS_OK != calculate_domain_finalize (cipher_suite, &dom_ctx, domain, header,
+						 header_len))
+	{
+		goto cleanup;
+	}
+	RLC_TRY {
+		// P1 + Q_1 * domain is the same for every proof
+		ep_mul (Q_1, Q_1, domain);
+		ep_add (verifier->Bv, verifier->Bv, Q_1);
+
+		bn_write_bbs (verifier->domain, domain);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_scratch_free (sorted);
+	bn_free (domain);
+	ep_free (Q_1);
+	return res;
+}
+
+
+void
+bbs_proof_verifier_free (
+	bbs_proof_verifier *verifier
+	)
+{
+	for (uint64_t i = 0; i < verifier->num_messages; i++)
+		ep_free (verifier->generators[i]);
+	ep_free (verifier->Bv);
+	bbs_prepared_pk_clean (&verifier->ppk);
+	free (verifier->index_octets);
+}
+
+
+// bbs_proof_verify_deferred for a verifier context
+static int
+bbs_proof_verifier_deferred_v (
+	const bbs_proof_verifier *verifier,
+	bbs_pairing_check        *check,
+	const uint8_t            *proof,
+	uint64_t                  proof_len,
+	const uint8_t            *presentation_header,
+	uint64_t                  presentation_header_len,
+	uint64_t                  num_messages,
+	const bbs_msg_source     *src
+	)
+{
+	const bbs_ciphersuite *cipher_suite            = verifier->ppk.cipher_suite;
+	uint64_t               disclosed_indexes_len   = verifier->disclosed_indexes_len;
+	uint64_t               undisclosed_indexes_len = verifier->num_messages -
+							 disclosed_indexes_len;
+	uint8_t               *disclosed_scalars       = NULL;
+	bbs_msg_batch          msg_batch;
+	sc_t                   msg_scalar;
+	ep_t                   Bv, T2;
+	int                    res                     = BBS_ERROR;
+
+	if (! presentation_header)
+	{
+		presentation_header     = (uint8_t*) "";
+		presentation_header_len = 0;
+	}
+
+	ep_null (Bv);
+	ep_null (T2);
+
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, disclosed_indexes_len,
+					  src))
+	{
+		goto cleanup;
+	}
+
+	// The domain commits to the number of messages
+	if (num_messages != verifier->num_messages ||
+	    proof_len != BBS_PROOF_LEN (undisclosed_indexes_len))
+	{
+		goto cleanup;
+	}
+
+	disclosed_scalars = bbs_scratch_alloc (disclosed_indexes_len * BBS_SCALAR_LEN);
+	if (! disclosed_scalars && disclosed_indexes_len)
+		goto cleanup;
+
+	// Map the disclosed messages and keep their scalars for the challenge
+	for (uint64_t i = 0; i < disclosed_indexes_len; i++)
+	{
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_scalar))
+		{
+			goto cleanup;
+		}
+		sc_write_bbs (disclosed_scalars + i * BBS_SCALAR_LEN, msg_scalar);
+	}
+
+	// Start from P1 + Q_1 * domain, the message terms are added from the
+	// generator table
+	RLC_TRY {
+		ep_new (Bv);
+		ep_new (T2);
+		ep_copy (Bv, verifier->Bv);
+		ep_set_infty (T2);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_verify_finish (cipher_suite, check, verifier->ppk.W, proof,
+					       proof + proof_len - BBS_SCALAR_LEN, Bv, T2,
+					       verifier->generators,
+					       proof + 3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN,
+					       undisclosed_indexes_len, verifier->domain,
+					       verifier->index_octets, NULL, disclosed_indexes_len,
+					       disclosed_scalars, src, presentation_header,
+					       presentation_header_len))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_scratch_free (disclosed_scalars);
+	ep_free (Bv);
+	ep_free (T2);
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+static int
+bbs_proof_verifier_verify_v (
+	const bbs_proof_verifier *verifier,
+	const uint8_t            *proof,
+	uint64_t                  proof_len,
+	const uint8_t            *presentation_header,
+	uint64_t                  presentation_header_len,
+	uint64_t                  num_messages,
+	const bbs_msg_source     *src
+	)
+{
+	bbs_pairing_check check;
+	int               res = BBS_ERROR;
+
+	if (BBS_OK != bbs_pairing_check_init (&check))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_verifier_deferred_v (verifier, &check, proof, proof_len,
+						     presentation_header,
+						     presentation_header_len, num_messages, src))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_pairing_check_eval (&check))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_pairing_check_free (&check);
+	return res;
+}
+
+
+int
+bbs_proof_verifier_verify (
+	const bbs_proof_verifier *verifier,
+	const uint8_t            *proof,
+	uint64_t                  proof_len,
+	const uint8_t            *presentation_header,
+	uint64_t                  presentation_header_len,
+	uint64_t                  num_messages,
+	const bbs_messages       *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, verifier->disclosed_indexes_len))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_verifier_verify_v (verifier, proof, proof_len,
+						   presentation_header, presentation_header_len,
+						   num_messages, &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+static int
+bbs_credential_init_v (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_credential        *cred,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	ep_t                  *generators,
+	uint8_t               *scalars,
+	uint64_t               num_messages,
+	const bbs_msg_source  *src
+	)
+{
+	uint8_t          generator_ctx[48 + 8];
+	bbs_hash_context dom_ctx;
+	bbs_msg_batch    msg_batch;
+	bn_t             domain;
+	sc_t             msg_scalar;
+	ep_t             Q_1;
+	int              res = BBS_ERROR;
+
+	cred->cipher_suite = cipher_suite;
+	cred->generators   = generators;
+	cred->scalars      = scalars;
+	cred->num_messages = num_messages;
+
+	bn_null (domain);
+	ep_null (Q_1);
+	ep_null (cred->A);
+	bn_null (cred->e);
+	ep_null (cred->B);
+	for (uint64_t i = 0; i < num_messages; i++)
+		ep_null (generators[i]);
+
+	if (BBS_OK != bbs_msg_batch_init (cipher_suite, &msg_batch, num_messages, src))
+	{
+		goto cleanup;
+	}
+
+	if (! header)
+	{
+		header     = (uint8_t*) "";
+		header_len = 0;
+	}
+
+	if (BBS_OK != create_generator_init (cipher_suite, generator_ctx))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != calculate_domain_init (cipher_suite, &dom_ctx, pk, num_messages))
+	{
+		goto cleanup;
+	}
+
+	RLC_TRY {
+		bn_new (domain);
+		ep_new (Q_1);
+		ep_new (cred->A);
+		bn_new (cred->e);
+		ep_new (cred->B);
+		for (uint64_t i = 0; i < num_messages; i++)
+			ep_new (generators[i]);
+
+		// Initialize B to P1
+		ep_read_bbs (cred->B, cipher_suite->p1);
+
+		// Parse the signature
+		ep_read_bbs (cred->A, signature);
+		bn_read_bbs (cred->e, signature + BBS_G1_ELEM_LEN);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// Q_1 and all H_i, which go into the domain
+	if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, Q_1))
+	{
+		goto cleanup;
+	}
+	for (uint64_t i = 0; i < num_messages; i++)
+	{
+		if (BBS_OK != create_generator_next (cipher_suite, generator_ctx, generators[i]))
+		{
+			goto cleanup;
+		}
+		if (BBS_OK != calculate_domain_update (cipher_suite, &dom_ctx, generators[i]))
+		{
+			goto cleanup;
+		}
+
+		// Calculate msg_scalar (batched)
+		if (BBS_OK != bbs_msg_batch_next (&msg_batch, msg_scalar))
+		{
+			goto cleanup;
+		}
+		sc_write_bbs (scalars + i * BBS_SCALAR_LEN, msg_scalar);
+	}
+	if (BBS_OK != calculate_domain_finalize (cipher_suite, &dom_ctx, domain, header,
+						 header_len))
+	{
+		goto cleanup;
+	}
+
+	// B = P1 + Q_1 * domain + H_1 * msg_1 + ... + H_L * msg_L
+	RLC_TRY {
+		ep_mul (Q_1, Q_1, domain);
+		ep_add (cred->B, cred->B, Q_1);
+
+		bn_write_bbs (cred->domain, domain);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_msm_octets (cred->B, generators, scalars, num_messages))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bn_free (domain);
+	ep_free (Q_1);
+	bbs_msg_batch_free (&msg_batch);
+	return res;
+}
+
+
+int
+bbs_credential_init (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_credential        *cred,
+	const bbs_public_key   pk,
+	const bbs_signature    signature,
+	const uint8_t         *header,
+	uint64_t               header_len,
+	ep_t                  *generators,
+	uint8_t               *scalars,
+	uint64_t               num_messages,
+	const bbs_messages    *messages
+	)
+{
+	bbs_msg_source src;
+	int            res = BBS_ERROR;
+
+	if (BBS_OK != bbs_msg_source_messages (&src, messages, num_messages))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_credential_init_v (cipher_suite, cred, pk, signature, header,
+					     header_len, generators, scalars, num_messages,
+					     &src))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+void
+bbs_credential_free (
+	bbs_credential *cred
+	)
+{
+	for (uint64_t i = 0; i < cred->num_messages; i++)
+		ep_free (cred->generators[i]);
+	ep_free (cred->A);
+	bn_free (cred->e);
+	ep_free (cred->B);
+
+	// The undisclosed messages are the holder's secret
+	bbs_wipe (cred->scalars, cred->num_messages * BBS_SCALAR_LEN);
+}
+
+
+// bbs_proof_gen_offline_det_v for a credential. Only the randomized part of
+// the proof is computed here.
+static int
+bbs_credential_offline_det (
+	const bbs_credential *cred,
+	bbs_proof_precomp    *precomp,
+	uint8_t              *proof,
+	const uint64_t       *disclosed_indexes,
+	uint64_t              disclosed_indexes_len,
+	bbs_bn_prf            prf,
+	void                 *prf_cookie
+	)
+{
+	const bbs_ciphersuite *cipher_suite = cred->cipher_suite;
+	uint8_t               *proof_ptr, *disclosed_scalars = NULL;
+	bn_t                   msg_scalar_tilde[BBS_MSM_CHUNK_LEN];
+	ep_t                   H_i[BBS_MSM_CHUNK_LEN];
+	ep_t                   T2, partial;
+	uint64_t               disclosed_indexes_idx   = 0;
+	uint64_t               undisclosed_indexes_idx = 0;
+	uint64_t               undisclosed_indexes_len;
+	uint64_t               chunk_len               = 0;
+	int                    res                     = BBS_ERROR;
+
+	precomp->ready = 0;
+
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+	{
+		bn_null (msg_scalar_tilde[i]);
+		ep_null (H_i[i]);
+	}
+	ep_null (T2);
+	ep_null (partial);
+
+	// Disclosed indexes have to be sorted and within range
+	if (disclosed_indexes_len > cred->num_messages)
+	{
+		goto cleanup;
+	}
+	for (uint64_t i = 0; i < disclosed_indexes_len; i++)
+	{
+		if (disclosed_indexes[i] >= cred->num_messages ||
+		    (i && disclosed_indexes[i] <= disclosed_indexes[i - 1]))
+		{
+			goto cleanup;
+		}
+	}
+	undisclosed_indexes_len = cred->num_messages - disclosed_indexes_len;
+
+	disclosed_scalars = bbs_scratch_alloc (disclosed_indexes_len * BBS_SCALAR_LEN);
+	if (! disclosed_scalars && disclosed_indexes_len)
+		goto cleanup;
+
+	RLC_TRY {
+		for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+		{
+			bn_new (msg_scalar_tilde[i]);
+			ep_new (H_i[i]);
+		}
+		ep_new (T2);
+		ep_new (partial);
+
+		ep_set_infty (T2);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	// T2 = H_j1 * msg_tilde_1 + ... over the undisclosed messages, one
+	// multi-scalar multiplication per chunk. The message scalars are copied
+	// to the proof as in bbs_proof_gen_offline_det_v.
+	proof_ptr = proof + 3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN; // m_hat
+	for (uint64_t i = 0; i < cred->num_messages; i++)
+	{
+		if (disclosed_indexes_idx < disclosed_indexes_len &&
+		    disclosed_indexes[disclosed_indexes_idx] == i)
+		{
+			memcpy (disclosed_scalars + disclosed_indexes_idx * BBS_SCALAR_LEN,
+				cred->scalars + i * BBS_SCALAR_LEN, BBS_SCALAR_LEN);
+			disclosed_indexes_idx++;
+			continue;
+		}
+
+		if (BBS_OK != prf (msg_scalar_tilde[chunk_len], BBS_PRF_MSG_SCALAR,
+				   undisclosed_indexes_idx, prf_cookie))
+		{
+			goto cleanup;
+		}
+		RLC_TRY {
+			ep_copy (H_i[chunk_len], cred->generators[i]);
+		}
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
+		memcpy (proof_ptr, cred->scalars + i * BBS_SCALAR_LEN, BBS_SCALAR_LEN);
+		proof_ptr += BBS_SCALAR_LEN;
+		undisclosed_indexes_idx++;
+		chunk_len++;
+
+		if (BBS_MSM_CHUNK_LEN == chunk_len || undisclosed_indexes_idx ==
+		    undisclosed_indexes_len)
+		{
+			RLC_TRY {
+				ep_mul_sim_lot (partial, H_i, msg_scalar_tilde, chunk_len);
+				ep_add (T2, T2, partial);
+			}
+			RLC_CATCH_ANY {
+				goto cleanup;
+			}
+			chunk_len = 0;
+		}
+	}
+
+	if (BBS_OK != bbs_proof_commit (cipher_suite, precomp, proof, cred->A, cred->e, cred->B,
+					T2, cred->domain, disclosed_indexes,
+					disclosed_indexes_len, disclosed_scalars, NULL,
+					undisclosed_indexes_len, prf, prf_cookie))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	// The message scalars copied so far are secret
+	if (BBS_OK != res)
+		bbs_wipe (proof + 3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN,
+			  undisclosed_indexes_idx * BBS_SCALAR_LEN);
+	bbs_scratch_free (disclosed_scalars);
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+	{
+		bn_free (msg_scalar_tilde[i]);
+		ep_free (H_i[i]);
+	}
+	ep_free (T2);
+	ep_free (partial);
+	return res;
+}
+
+
+int
+bbs_credential_proof_gen_det (
+	const bbs_credential *cred,
+	uint8_t              *proof,
+	const uint8_t        *presentation_header,
+	uint64_t              presentation_header_len,
+	const uint64_t       *disclosed_indexes,
+	uint64_t              disclosed_indexes_len,
+	bbs_bn_prf            prf,
+	void                 *prf_cookie
+	)
+{
+	bbs_proof_precomp precomp;
+	int               res = BBS_ERROR;
+
+	if (BBS_OK != bbs_credential_offline_det (cred, &precomp, proof, disclosed_indexes,
+						  disclosed_indexes_len, prf, prf_cookie))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_proof_gen_online_det (&precomp, presentation_header,
+						presentation_header_len, prf, prf_cookie))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	bbs_proof_precomp_free (&precomp);
+	return res;
+}
+
+
+int
+bbs_credential_proof_gen_offline (
+	const bbs_credential *cred,
+	bbs_proof_precomp    *precomp,
+	uint8_t              *proof,
+	const uint64_t       *disclosed_indexes,
+	uint64_t              disclosed_indexes_len
+	)
+{
+	bbs_proof_prf_state prf_state;
+	int                 res = BBS_ERROR;
+
+	precomp->ready   = 0;
+	prf_state.cached = 0;
+	if (BBS_OK != bbs_rand_bytes (prf_state.seed, 32))
+	{
+		goto cleanup;
+	}
+	if (BBS_OK != bbs_credential_offline_det (cred, precomp, proof, disclosed_indexes,
+						  disclosed_indexes_len, bbs_proof_prf,
+						  &prf_state))
+	{
+		goto cleanup;
+	}
+	memcpy (precomp->seed, prf_state.seed, 32);
+
+	res = BBS_OK;
+cleanup:
+	bbs_wipe (&prf_state, sizeof(prf_state));
+	return res;
+}
+
+
+int
+bbs_credential_proof_gen (
+	const bbs_credential *cred,
+	uint8_t              *proof,
+	const uint8_t        *presentation_header,
+	uint64_t              presentation_header_len,
+	const uint64_t       *disclosed_indexes,
+	uint64_t              disclosed_indexes_len
+	)
+{
+	bbs_proof_precomp precomp;
+
+	if (BBS_OK != bbs_credential_proof_gen_offline (cred, &precomp, proof, disclosed_indexes,
+							disclosed_indexes_len))
+	{
+		bbs_proof_precomp_free (&precomp);
+		return BBS_ERROR;
+	}
+	return bbs_proof_gen_online (&precomp, presentation_header, presentation_header_len);
+}
+
+
+int
+bbs_pairing_check_init (
+	bbs_pairing_check *check
+	)
+{
+	int res = BBS_ERROR;
+
+	ep_null (check->A);
+	ep_null (check->B);
+	ep2_null (check->W);
+
+	RLC_TRY {
+		ep_new (check->A);
+		ep_new (check->B);
+		ep2_new (check->W);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+void
+bbs_pairing_check_free (
+	bbs_pairing_check *check
 	)
 {
-	// All these have length 17
-	static uint8_t *dsts[] = {
-		(uint8_t*) "random msg scalar", (uint8_t*) "random r_1 scalar",
-		(uint8_t*) "random r_2 scalar", (uint8_t*) "random e_t scalar",
-		(uint8_t*) "random r1t scalar", (uint8_t*) "random r3t scalar",
-	};
-
-	if (input_type >= LEN (dsts))
-		return BBS_ERROR;
-	return hash_to_scalar (out,  dsts[input_type], 17, seed, 32, input, 8, 0);
+	ep_free (check->A);
+	ep_free (check->B);
+	ep2_free (check->W);
 }
 
 
 int
-bbs_proof_gen (
-	const bbs_public_key  pk,
-	const bbs_signature   signature,
-	uint8_t              *proof,
-	const uint8_t        *header,
-	uint64_t              header_len,
-	const uint8_t        *presentation_header,
-	uint64_t              presentation_header_len,
-	const uint64_t       *disclosed_indexes,
-	uint64_t              disclosed_indexes_len,
-	uint64_t              num_messages,
-	...
+bbs_pairing_check_eval (
+	const bbs_pairing_check *check
 	)
 {
-	va_list ap;
-	uint8_t seed[32];
-	int     ret = BBS_ERROR;
+	ep_t   P[2];
+	ep2_t  Q[2];
+	fp12_t paired;
+	int    res = BBS_ERROR;
+
+	ep_null (P[0]);
+	ep_null (P[1]);
+	ep2_null (Q[0]);
+	ep2_null (Q[1]);
+	fp12_null (paired);
 
-	va_start (ap, num_messages);
 	RLC_TRY {
-		// Gather randomness. The seed is used for any randomness within this
-		// function. In particular, this implies that we do not need to store
-		// intermediate derivations. Currently, we derive new values via
-		// hash_to_scalar, but we might want to exchange that for
-		// something faster later on.
-		rand_bytes (seed, 32);
+		ep_new (P[0]);
+		ep_new (P[1]);
+		ep2_new (Q[0]);
+		ep2_new (Q[1]);
+		fp12_new (paired);
+
+		// Compute e(A, W) * e(B, -BP2) with a single final exponentiation
+		ep_copy (P[0], check->A);
+		ep2_copy (Q[0], check->W);
+		ep_copy (P[1], check->B);
+		ep2_curve_get_gen (Q[1]);
+		ep2_neg (Q[1], Q[1]);
+		pp_map_sim_oatep_k12 (paired, P, Q, 2);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
 	}
 
-	if (BBS_OK != bbs_proof_gen_det (pk, signature, proof, header, header_len,
-					 presentation_header, presentation_header_len,
-					 disclosed_indexes, disclosed_indexes_len,
-					 num_messages, bbs_proof_prf, seed, ap))
+	// For valid checks, this is the identity
+	if (RLC_EQ != fp12_cmp_dig (paired, 1))
 	{
 		goto cleanup;
 	}
 
-	ret = BBS_OK;
+	res = BBS_OK;
 cleanup:
-	va_end (ap);
-	return ret;
+	ep_free (P[0]);
+	ep_free (P[1]);
+	ep2_free (Q[0]);
+	ep2_free (Q[1]);
+	fp12_free (paired);
+	return res;
 }
 
 
 int
-bbs_proof_verify (
-	const bbs_public_key  pk,
-	const uint8_t        *proof,
-	uint64_t              proof_len,
-	const uint8_t        *header,
-	uint64_t              header_len,
-	const uint8_t        *presentation_header,
-	uint64_t              presentation_header_len,
-	const uint64_t       *disclosed_indexes,
-	uint64_t              disclosed_indexes_len,
-	uint64_t              num_messages,
-	...
+bbs_pairing_acc_init (
+	bbs_pairing_acc *acc,
+	ep_t            *A,
+	ep_t            *B,
+	ep2_t           *W,
+	uint64_t         max_checks
 	)
 {
-	va_list        ap;
-	uint8_t        generator_ctx[48 + 8];
-	uint8_t        T_buffer[2 * BBS_G1_ELEM_LEN];
-	uint8_t        scalar_buffer[BBS_SCALAR_LEN];
-	const uint8_t *proof_ptr, *msg;
-	uint64_t       msg_len, be_buffer;
-	SHA256Context  dom_ctx, ch_ctx;
-	bn_t           domain, msg_scalar, e_hat, r1_hat, r3_hat, challenge, challenge_prime;
-	ep_t           Bv, Q_1, H_i, T1, T2, D, Abar, Bbar;
-	ep2_t          W;
-	fp12_t         paired1, paired2;
-	uint64_t       disclosed_indexes_idx   = 0;
-	uint64_t       undisclosed_indexes_idx = 0;
-	uint64_t       undisclosed_indexes_len = num_messages - disclosed_indexes_len;
-	int            res                     = BBS_ERROR;
+	int res = BBS_ERROR;
 
-	if (! header)
+	acc->A          = A;
+	acc->B          = B;
+	acc->W          = W;
+	acc->num_checks = 0;
+	acc->max_checks = max_checks;
+
+	for (uint64_t i = 0; i < max_checks + 1; i++)
 	{
-		header     = (uint8_t*) "";
-		header_len = 0;
+		ep_null (A[i]);
+		ep2_null (W[i]);
+		if (i < max_checks)
+			ep_null (B[i]);
 	}
 
-	if (! presentation_header)
-	{
-		presentation_header     = (uint8_t*) "";
-		presentation_header_len = 0;
+	RLC_TRY {
+		for (uint64_t i = 0; i < max_checks + 1; i++)
+		{
+			ep_new (A[i]);
+			ep2_new (W[i]);
+			if (i < max_checks)
+				ep_new (B[i]);
+		}
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
 	}
 
-	bn_null (domain);
-	bn_null (msg_scalar);
-	bn_null (e_hat);
-	bn_null (r1_hat);
-	bn_null (r3_hat);
-	bn_null (challenge);
-	bn_null (challenge_prime);
-	ep_null (Bv);
-	ep_null (Q_1);
-	ep_null (H_i);
-	ep_null (T1);
-	ep_null (T2);
-	ep_null (D);
-	ep_null (Abar);
-	ep_null (Bbar);
-	ep2_null (W);
-	fp12_null (paired1);
-	fp12_null (paired2);
+	res = BBS_OK;
+cleanup:
+	return res;
+}
 
 
-	// Sanity check. We let the application give us the length explicitly,
-	// and perform the length check here.
-	if (proof_len != BBS_PROOF_LEN (undisclosed_indexes_len))
+void
+bbs_pairing_acc_free (
+	bbs_pairing_acc *acc
+	)
+{
+	for (uint64_t i = 0; i < acc->max_checks + 1; i++)
 	{
-		goto cleanup;
+		ep_free (acc->A[i]);
+		ep2_free (acc->W[i]);
+		if (i < acc->max_checks)
+			ep_free (acc->B[i]);
 	}
+	acc->num_checks = 0;
+}
+
+
+int
+bbs_pairing_acc_add (
+	bbs_pairing_acc         *acc,
+	const bbs_pairing_check *check
+	)
+{
+	int res = BBS_ERROR;
 
-	if (BBS_OK != create_generator_init (generator_ctx, (uint8_t*) BBS_SHA_256_API_ID, LEN (
-						     BBS_SHA_256_API_ID)
-					     - 1))
+	if (acc->num_checks >= acc->max_checks)
 	{
 		goto cleanup;
 	}
-	if (BBS_OK != calculate_domain_init (&dom_ctx, pk, num_messages))
-	{
+
+	RLC_TRY {
+		ep_copy (acc->A[acc->num_checks], check->A);
+		ep_copy (acc->B[acc->num_checks], check->B);
+		ep2_copy (acc->W[acc->num_checks], check->W);
+	}
+	RLC_CATCH_ANY {
 		goto cleanup;
 	}
+	acc->num_checks++;
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
 
-	RLC_TRY {
-		bn_new (domain);
-		bn_new (msg_scalar);
-		bn_new (e_hat);
-		bn_new (r1_hat);
-		bn_new (r3_hat);
-		bn_new (challenge);
-		bn_new (challenge_prime);
-		ep_new (Bv);
-		ep_new (Q_1);
-		ep_new (H_i);
-		ep_new (T1);
-		ep_new (T2);
-		ep_new (D);
-		ep_new (Abar);
-		ep_new (Bbar);
-		ep2_new (W);
-		fp12_new (paired1);
-		fp12_new (paired2);
-
-		// Parse pk
-		ep2_read_bbs (W, pk);
-
-		// Parse the proof excluding the msg_scalar_hat values
-		// Those will be read later
-		proof_ptr  = proof;
-		ep_read_bbs (Abar, proof_ptr);
-		proof_ptr += BBS_G1_ELEM_LEN;
-		ep_read_bbs (Bbar, proof_ptr);
-		proof_ptr += BBS_G1_ELEM_LEN;
-		ep_read_bbs (D,    proof_ptr);
-		proof_ptr += BBS_G1_ELEM_LEN;
-		bn_read_bbs (e_hat,     proof_ptr);
-		proof_ptr += BBS_SCALAR_LEN;
-		bn_read_bbs (r1_hat,    proof_ptr);
-		proof_ptr += BBS_SCALAR_LEN;
-		bn_read_bbs (r3_hat,    proof_ptr);
-		proof_ptr += BBS_SCALAR_LEN;
-		bn_read_bbs (challenge, proof + BBS_PROOF_LEN (undisclosed_indexes_len)
-			     - BBS_SCALAR_LEN);
 
-		// Calculate T1. We use T2 as a temporary variable here
-		ep_mul (T1, Bbar, challenge);
-		ep_mul (T2, Abar, e_hat);
-		ep_add (T1, T1, T2);
-		ep_mul (T2, D, r1_hat);
-		ep_add (T1, T1, T2);
+// Derives the random weight of the i-th check from a per-evaluation seed, so
+// that we do not need to store weights between the multi-scalar
+// multiplications for the A and B points
+static int
+bbs_pairing_weight (
+	bn_t           weight,
+	const uint8_t  seed[32],
+	uint64_t       i
+	)
+{
+	SHA256Context hctx;
+	uint8_t       buffer[32];
+	uint64_t      i_be = UINT64_H2BE (i);
+	int           res  = BBS_ERROR;
+
+	if (shaSuccess != bbs_sha256_reset (&hctx))
+		goto cleanup;
+	if (shaSuccess != bbs_sha256_input (&hctx, seed, 32))
+		goto cleanup;
+	if (shaSuccess != bbs_sha256_input (&hctx, (uint8_t*) &i_be, 8))
+		goto cleanup;
+	if (shaSuccess != bbs_sha256_result (&hctx, buffer))
+		goto cleanup;
 
-		// Initialize Bv to P1 and T2 to D*r3_hat
-		ep_read_bbs (Bv, P1);
-		ep_mul (T2, D, r3_hat);
+	RLC_TRY {
+		bn_read_bin (weight, buffer, BBS_PAIRING_WEIGHT_LEN);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
 	}
 
-	// Calculate Q_1
-	if (BBS_OK != create_generator_next (generator_ctx, Q_1, (uint8_t*) BBS_SHA_256_API_ID,
-					     LEN (BBS_SHA_256_API_ID)
-					     - 1))
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+bbs_pairing_acc_eval (
+	bbs_pairing_acc *acc
+	)
+{
+	uint8_t  seed[32];
+	ep_t     points[BBS_MSM_CHUNK_LEN];
+	bn_t     weights[BBS_MSM_CHUNK_LEN];
+	ep_t     sum, partial;
+	fp12_t   paired;
+	uint64_t num_checks = acc->num_checks;
+	uint64_t num_groups = 0;
+	uint64_t chunk_len, g;
+	int      res        = BBS_ERROR;
+
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
 	{
+		ep_null (points[i]);
+		bn_null (weights[i]);
+	}
+	ep_null (sum);
+	ep_null (partial);
+	fp12_null (paired);
+
+	// The accumulated points are consumed below, no matter the outcome
+	acc->num_checks = 0;
+
+	RLC_TRY {
+		for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+		{
+			ep_new (points[i]);
+			bn_new (weights[i]);
+		}
+		ep_new (sum);
+		ep_new (partial);
+		fp12_new (paired);
+	}
+	RLC_CATCH_ANY {
 		goto cleanup;
 	}
-	if (BBS_OK != calculate_domain_update (&dom_ctx, Q_1))
+
+	// Every check is weighed with an independent random scalar r_i, so that
+	// invalid checks can not cancel each other out
+	if (BBS_OK != bbs_rand_bytes (seed, 32))
 	{
 		goto cleanup;
 	}
 
-	va_start (ap, num_messages);
-	for (uint64_t i = 0; i<num_messages; i++)
+	// Group the checks by public key. Within a group,
+	// prod_i e(r_i * A_i, W) = e(sum_i r_i * A_i, W), so every distinct key
+	// costs a single Miller loop, and the sum is a multi-scalar
+	// multiplication. The group sums are compacted into the front of A and
+	// W. The slots we overwrite only ever belong to checks that have
+	// already been grouped.
+	for (uint64_t i = 0; i < num_checks; i++)
 	{
-		// Calculate H_i
-		if (BBS_OK != create_generator_next (generator_ctx, H_i,
-						     (uint8_t*) BBS_SHA_256_API_ID, LEN (
-							     BBS_SHA_256_API_ID)
-						     - 1))
+		for (g = 0; g < num_groups; g++)
 		{
-			goto cleanup;
+			if (RLC_EQ == ep2_cmp (acc->W[g], acc->W[i]))
+				break;
 		}
-		if (BBS_OK != calculate_domain_update (&dom_ctx, H_i))
-		{
+		if (g < num_groups)
+			continue;
+
+		chunk_len = 0;
+		RLC_TRY {
+			ep_set_infty (sum);
+		}
+		RLC_CATCH_ANY {
 			goto cleanup;
 		}
-
-		if (disclosed_indexes_idx < disclosed_indexes_len &&
-		    disclosed_indexes[disclosed_indexes_idx] == i)
+		for (uint64_t j = i; j < num_checks; j++)
 		{
-			// This message is disclosed.
-			// Read in the message and accumulate onto Bv
-			msg     = va_arg (ap, uint8_t*);
-			msg_len = va_arg (ap, uint32_t);
-
-			// Calculate msg_scalar (oneshot)
-			if (BBS_OK != hash_to_scalar (msg_scalar, (uint8_t*) BBS_SHA_256_MAP_DST,
-						      LEN (BBS_SHA_256_MAP_DST)
-						      - 1, msg, msg_len, 0))
+			if (j != i && RLC_EQ != ep2_cmp (acc->W[j], acc->W[i]))
+				continue;
+			if (BBS_OK != bbs_pairing_weight (weights[chunk_len], seed, j))
 			{
 				goto cleanup;
 			}
 			RLC_TRY {
-				// Update Bv.
-				ep_mul (H_i, H_i, msg_scalar);
-				ep_add (Bv, Bv, H_i);
+				ep_copy (points[chunk_len], acc->A[j]);
 			}
 			RLC_CATCH_ANY {
 				goto cleanup;
 			}
-			// Again, I would like to hash msg_scalar into the
-			// challenge, but can't yet. Thus we will have to
-			// recalculate it later...
-			disclosed_indexes_idx++;
-		}
-		else
-		{
-			// This message is undisclosed.
-			// Read a msg_scalar_hat value and accumulate it onto T2
-			RLC_TRY {
-				// Update T2.
-				bn_read_bbs (msg_scalar, proof_ptr);
-				proof_ptr += BBS_SCALAR_LEN;
-				ep_mul (H_i, H_i, msg_scalar);
-				ep_add (T2, T2, H_i);
+			chunk_len++;
+			if (BBS_MSM_CHUNK_LEN == chunk_len)
+			{
+				RLC_TRY {
+					ep_mul_sim_lot (partial, points, weights, chunk_len);
+					ep_add (sum, sum, partial);
+				}
+				RLC_CATCH_ANY {
+					goto cleanup;
+				}
+				chunk_len = 0;
 			}
-			RLC_CATCH_ANY {
-				goto cleanup;
+		}
+		RLC_TRY {
+			if (chunk_len)
+			{
+				ep_mul_sim_lot (partial, points, weights, chunk_len);
+				ep_add (sum, sum, partial);
 			}
-			undisclosed_indexes_idx++;
+			ep_copy (acc->A[num_groups], sum);
+			ep2_copy (acc->W[num_groups], acc->W[i]);
 		}
-	}
-	va_end (ap);
-
-	// Sanity check. If any indices for disclosed messages were out of order
-	// or invalid, we fail here.
-	if (disclosed_indexes_idx != disclosed_indexes_len)
-	{
-		goto cleanup;
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
+		num_groups++;
 	}
 
-	// Finalize domain calculation
-	if (BBS_OK != calculate_domain_finalize (&dom_ctx, domain, header, header_len,
-						 (uint8_t*) BBS_SHA_256_API_ID, LEN (
-							 BBS_SHA_256_API_ID)
-						 - 1))
-	{
-		goto cleanup;
-	}
+	// All B points are paired with -BP2, so they form a single group as well
 	RLC_TRY {
-		// Finalize Bv
-		ep_mul (Q_1, Q_1, domain);
-		ep_add (Bv, Bv, Q_1);
-
-		// Finalize T2
-		ep_mul (Bv, Bv, challenge);
-		ep_add (T2, T2, Bv);
-
-		// Write out T1 and T2 for the challenge
-		ep_write_bbs (T_buffer,                   T1);
-		ep_write_bbs (T_buffer + BBS_G1_ELEM_LEN, T2);
+		ep_set_infty (sum);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
 	}
-
-	// Calculate the challenge
-	if (BBS_OK != hash_to_scalar_init (&ch_ctx))
-	{
-		goto cleanup;
-	}
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, proof, 3 * BBS_G1_ELEM_LEN))
-	{
-		goto cleanup;
-	}
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, T_buffer, 2 * BBS_G1_ELEM_LEN))
-	{
-		goto cleanup;
-	}
-	be_buffer = UINT64_H2BE (disclosed_indexes_len);
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, (uint8_t*) &be_buffer, 8))
-	{
-		goto cleanup;
-	}
-	// Given a better spec, we could merge almost all for loops in here...
-	for (uint64_t i = 0; i<disclosed_indexes_len; i++)
-	{
-		be_buffer = UINT64_H2BE (disclosed_indexes[i]);
-		if (BBS_OK != hash_to_scalar_update (&ch_ctx, (uint8_t*) &be_buffer, 8))
-		{
-			goto cleanup;
-		}
-	}
-	// We have to go over all disclosed messages again. Someone please fix
-	// this in the spec...
-	va_start (ap, num_messages);
-	for (disclosed_indexes_idx = 0; disclosed_indexes_idx<disclosed_indexes_len;
-	     disclosed_indexes_idx++)
+	for (uint64_t i = 0; i < num_checks; i += chunk_len)
 	{
-		// Calculate msg_scalar (oneshot)
-		msg     = va_arg (ap, uint8_t*);
-		msg_len = va_arg (ap, uint32_t);
-		if (BBS_OK != hash_to_scalar (msg_scalar, (uint8_t*) BBS_SHA_256_MAP_DST, LEN (
-						      BBS_SHA_256_MAP_DST) - 1, msg, msg_len, 0))
+		chunk_len = num_checks - i;
+		if (chunk_len > BBS_MSM_CHUNK_LEN)
+			chunk_len = BBS_MSM_CHUNK_LEN;
+		for (uint64_t j = 0; j < chunk_len; j++)
 		{
-			goto cleanup;
+			if (BBS_OK != bbs_pairing_weight (weights[j], seed, i + j))
+			{
+				goto cleanup;
+			}
 		}
 		RLC_TRY {
-			bn_write_bbs (scalar_buffer, msg_scalar);
+			ep_mul_sim_lot (partial, acc->B + i, weights, chunk_len);
+			ep_add (sum, sum, partial);
 		}
 		RLC_CATCH_ANY {
 			goto cleanup;
 		}
-		if (BBS_OK != hash_to_scalar_update (&ch_ctx, scalar_buffer, BBS_SCALAR_LEN))
-		{
-			goto cleanup;
-		}
-	}
-	va_end (ap);
-	RLC_TRY {
-		// Write out the domain. We reuse scalar_buffer
-		bn_write_bbs (scalar_buffer, domain);
-	}
-	RLC_CATCH_ANY {
-		goto cleanup;
-	}
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, scalar_buffer, BBS_SCALAR_LEN))
-	{
-		goto cleanup;
-	}
-	be_buffer = UINT64_H2BE (presentation_header_len);
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, (uint8_t*) &be_buffer, 8))
-	{
-		goto cleanup;
-	}
-	if (BBS_OK != hash_to_scalar_update (&ch_ctx, presentation_header, presentation_header_len))
-	{
-		goto cleanup;
-	}
-	if (BBS_OK != hash_to_scalar_finalize (&ch_ctx, challenge_prime,
-					       (uint8_t*) BBS_SHA_256_CHALLENGE_DST, LEN (
-						       BBS_SHA_256_CHALLENGE_DST)
-					       - 1))
-	{
-		goto cleanup;
-	}
-
-	// Verification Step 1: The PoK was valid
-	if (RLC_EQ != bn_cmp (challenge, challenge_prime))
-	{
-		goto cleanup;
 	}
 
-	// Verification Step 2: The original signature was valid
 	RLC_TRY {
-		// Compute pairings e(Abar, W) * e(Bbar, -BP2)
-		// For valid signatures, this is the identity.
-		pp_map_oatep_k12 (paired1, Abar, W);
+		ep_copy (acc->A[num_groups], sum);
+		ep2_curve_get_gen (acc->W[num_groups]);
+		ep2_neg (acc->W[num_groups], acc->W[num_groups]);
 
-		ep2_curve_get_gen (W); // Reuse W
-		ep2_neg (W, W);
-		pp_map_oatep_k12 (paired2, Bbar, W);
-
-		fp12_mul (paired1, paired1, paired2);
+		// Compute prod_W e(sum_i r_i * A_i, W) * e(sum_i r_i * B_i, -BP2).
+		// For a batch under a single key, these are just two Miller loops.
+		pp_map_sim_oatep_k12 (paired, acc->A, acc->W, num_groups + 1);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
 	}
 
-	// Check signature equation
-	if (RLC_EQ != fp12_cmp_dig (paired1, 1))
+	// If all checks were valid, this is the identity
+	if (RLC_EQ != fp12_cmp_dig (paired, 1))
 	{
 		goto cleanup;
 	}
 
 	res = BBS_OK;
 cleanup:
-	bn_free (domain);
-	bn_free (msg_scalar);
-	bn_free (e_hat);
-	bn_free (r1_hat);
-	bn_free (r3_hat);
-	bn_free (challenge);
-	bn_free (challenge_prime);
-	ep_free (Bv);
-	ep_free (Q_1);
-	ep_free (H_i);
-	ep_free (T1);
-	ep_free (T2);
-	ep_free (D);
-	ep_free (Abar);
-	ep_free (Bbar);
-	ep2_free (W);
-	fp12_free (paired1);
-	fp12_free (paired2);
+	for (int i = 0; i < BBS_MSM_CHUNK_LEN; i++)
+	{
+		ep_free (points[i]);
+		bn_free (weights[i]);
+	}
+	ep_free (sum);
+	ep_free (partial);
+	fp12_free (paired);
 	return res;
 }
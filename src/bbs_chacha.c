@@ -0,0 +1,94 @@
+#include "bbs_chacha.h"
+
+typedef uint32_t bbs_chacha_vec __attribute__ ((vector_size (4 * BBS_CHACHA20_LANES)));
+
+#define CC_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define CC_QR(a, b, c, d) \
+	do { \
+		x[a] += x[b]; x[d] ^= x[a]; x[d] = CC_ROTL (x[d], 16); \
+		x[c] += x[d]; x[b] ^= x[c]; x[b] = CC_ROTL (x[b], 12); \
+		x[a] += x[b]; x[d] ^= x[a]; x[d] = CC_ROTL (x[d], 8);  \
+		x[c] += x[d]; x[b] ^= x[c]; x[b] = CC_ROTL (x[b], 7);  \
+	} while (0)
+
+
+static uint32_t
+cc_load32 (
+	const uint8_t *in
+	)
+{
+	return (uint32_t) in[0] | (uint32_t) in[1] << 8 | (uint32_t) in[2] << 16 |
+	       (uint32_t) in[3] << 24;
+}
+
+
+void
+bbs_chacha20_blocks (
+	const uint8_t key[32],
+	uint64_t      nonce,
+	uint64_t      counter,
+	uint8_t      *out,
+	uint64_t      num_blocks
+	)
+{
+	bbs_chacha_vec init[16], x[16];
+	uint32_t       words[16];
+	uint64_t       block_counter, lanes;
+
+	// "expand 32-byte k", key, counter (set per lane below) and nonce
+	words[0] = 0x61707865;
+	words[1] = 0x3320646e;
+	words[2] = 0x79622d32;
+	words[3] = 0x6b206574;
+	for (int i = 0; i < 8; i++)
+		words[4 + i] = cc_load32 (key + 4 * i);
+	words[12] = 0;
+	words[13] = 0;
+	words[14] = (uint32_t) nonce;
+	words[15] = (uint32_t) (nonce >> 32);
+	for (int i = 0; i < 16; i++)
+		for (int l = 0; l < BBS_CHACHA20_LANES; l++)
+			init[i][l] = words[i];
+
+	while (num_blocks)
+	{
+		// Lane l computes block counter + l
+		for (int l = 0; l < BBS_CHACHA20_LANES; l++)
+		{
+			block_counter = counter + l;
+			init[12][l]   = (uint32_t) block_counter;
+			init[13][l]   = (uint32_t) (block_counter >> 32);
+		}
+
+		for (int i = 0; i < 16; i++)
+			x[i] = init[i];
+		for (int round = 0; round < 10; round++)
+		{
+			CC_QR (0, 4,  8, 12);
+			CC_QR (1, 5,  9, 13);
+			CC_QR (2, 6, 10, 14);
+			CC_QR (3, 7, 11, 15);
+			CC_QR (0, 5, 10, 15);
+			CC_QR (1, 6, 11, 12);
+			CC_QR (2, 7,  8, 13);
+			CC_QR (3, 4,  9, 14);
+		}
+		for (int i = 0; i < 16; i++)
+			x[i] += init[i];
+
+		lanes = num_blocks < BBS_CHACHA20_LANES ? num_blocks : BBS_CHACHA20_LANES;
+		for (uint64_t l = 0; l < lanes; l++)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				out[4 * i]     = x[i][l];
+				out[4 * i + 1] = x[i][l] >> 8;
+				out[4 * i + 2] = x[i][l] >> 16;
+				out[4 * i + 3] = x[i][l] >> 24;
+			}
+			out += 64;
+		}
+		counter    += lanes;
+		num_blocks -= lanes;
+	}
+}
@@ -0,0 +1,23 @@
+#ifndef BBS_CHACHA_H
+#define BBS_CHACHA_H
+
+#include <stdint.h>
+
+// ChaCha20 keystream for the proof randomness. This is the original variant
+// with a 64 bit block counter and a 64 bit nonce in state words 12 to 15, so
+// that every (nonce, counter) pair names one 64 byte block that can be
+// computed directly.
+
+// Blocks computed side by side, one per 32 bit vector lane
+#define BBS_CHACHA20_LANES 4
+
+// Writes the num_blocks keystream blocks starting at counter to out
+void bbs_chacha20_blocks(
+		const uint8_t key[32],
+		uint64_t      nonce,
+		uint64_t      counter,
+		uint8_t      *out,
+		uint64_t      num_blocks
+	);
+
+#endif /*BBS_CHACHA_H*/
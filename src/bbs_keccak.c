@@ -0,0 +1,261 @@
+#include "bbs.h"
+#include "bbs_util.h"
+#include "bbs_keccak.h"
+
+static const uint64_t keccak_rc[24] = {
+	0x0000000000000001, 0x0000000000008082, 0x800000000000808a, 0x8000000080008000,
+	0x000000000000808b, 0x0000000080000001, 0x8000000080008081, 0x8000000000008009,
+	0x000000000000008a, 0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+	0x000000008000808b, 0x800000000000008b, 0x8000000000008089, 0x8000000000008003,
+	0x8000000000008002, 0x8000000000000080, 0x000000000000800a, 0x800000008000000a,
+	0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008
+};
+
+#define ROL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+// One round from the lanes A into the lanes E. Lanes are named by row (b, g,
+// k, m, s for y = 0, ..., 4) and column (a, e, i, o, u for x = 0, ..., 4).
+// theta, rho and pi are merged into computing the five B lanes of each output
+// row. For chi, the complemented input lanes let us pick for every output
+// lane one of A ^ (B & C), A ^ (B | C) and their negations, such that the
+// output lanes are complemented exactly like the input lanes again. This
+// leaves 8 instead of 25 NOT operations per round.
+#define KECCAK_ROUND(A, E, rc) \
+	do { \
+		Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa; \
+		Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se; \
+		Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si; \
+		Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so; \
+		Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su; \
+		Da = Cu ^ ROL64 (Ce, 1);                    \
+		De = Ca ^ ROL64 (Ci, 1);                    \
+		Di = Ce ^ ROL64 (Co, 1);                    \
+		Do = Ci ^ ROL64 (Cu, 1);                    \
+		Du = Co ^ ROL64 (Ca, 1);                    \
+		Ba = A##ba ^ Da;                            \
+		Be = ROL64 (A##ge ^ De, 44);                \
+		Bi = ROL64 (A##ki ^ Di, 43);                \
+		Bo = ROL64 (A##mo ^ Do, 21);                \
+		Bu = ROL64 (A##su ^ Du, 14);                \
+		E##ba = Ba ^ (Be | Bi) ^ rc;                \
+		E##be = Be ^ (~Bi | Bo);                    \
+		E##bi = Bi ^ (Bo & Bu);                     \
+		E##bo = Bo ^ (Bu | Ba);                     \
+		E##bu = Bu ^ (Ba & Be);                     \
+		Ba = ROL64 (A##bo ^ Do, 28);                \
+		Be = ROL64 (A##gu ^ Du, 20);                \
+		Bi = ROL64 (A##ka ^ Da, 3);                 \
+		Bo = ROL64 (A##me ^ De, 45);                \
+		Bu = ROL64 (A##si ^ Di, 61);                \
+		E##ga = Ba ^ (Be | Bi);                     \
+		E##ge = Be ^ (Bi & Bo);                     \
+		E##gi = Bi ^ (Bo | ~Bu);                    \
+		E##go = Bo ^ (Bu | Ba);                     \
+		E##gu = Bu ^ (Ba & Be);                     \
+		Ba = ROL64 (A##be ^ De, 1);                 \
+		Be = ROL64 (A##gi ^ Di, 6);                 \
+		Bi = ROL64 (A##ko ^ Do, 25);                \
+		Bo = ROL64 (A##mu ^ Du, 8);                 \
+		Bu = ROL64 (A##sa ^ Da, 18);                \
+		E##ka = Ba ^ (Be | Bi);                     \
+		E##ke = Be ^ (Bi & Bo);                     \
+		E##ki = Bi ^ (~Bo & Bu);                    \
+		E##ko = Bo ^ ~(Bu | Ba);                    \
+		E##ku = Bu ^ (Ba & Be);                     \
+		Ba = ROL64 (A##bu ^ Du, 27);                \
+		Be = ROL64 (A##ga ^ Da, 36);                \
+		Bi = ROL64 (A##ke ^ De, 10);                \
+		Bo = ROL64 (A##mi ^ Di, 15);                \
+		Bu = ROL64 (A##so ^ Do, 56);                \
+		E##ma = Ba ^ (Be & Bi);                     \
+		E##me = Be ^ (Bi | Bo);                     \
+		E##mi = Bi ^ (~Bo | Bu);                    \
+		E##mo = Bo ^ ~(Bu & Ba);                    \
+		E##mu = Bu ^ (Ba | Be);                     \
+		Ba = ROL64 (A##bi ^ Di, 62);                \
+		Be = ROL64 (A##go ^ Do, 55);                \
+		Bi = ROL64 (A##ku ^ Du, 39);                \
+		Bo = ROL64 (A##ma ^ Da, 41);                \
+		Bu = ROL64 (A##se ^ De, 2);                 \
+		E##sa = Ba ^ (~Be & Bi);                    \
+		E##se = Be ^ ~(Bi | Bo);                    \
+		E##si = Bi ^ (Bo & Bu);                     \
+		E##so = Bo ^ (Bu | Ba);                     \
+		E##su = Bu ^ (Ba & Be);                     \
+	} while (0)
+
+
+
+void
+bbs_keccak_f1600 (
+	uint64_t state[25]
+	)
+{
+	uint64_t Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki, Ako, Aku,
+	         Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+	uint64_t Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki, Eko, Eku,
+	         Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+	uint64_t Ba, Be, Bi, Bo, Bu, Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;
+
+	Aba = state[0];
+	Abe = state[1];
+	Abi = state[2];
+	Abo = state[3];
+	Abu = state[4];
+	Aga = state[5];
+	Age = state[6];
+	Agi = state[7];
+	Ago = state[8];
+	Agu = state[9];
+	Aka = state[10];
+	Ake = state[11];
+	Aki = state[12];
+	Ako = state[13];
+	Aku = state[14];
+	Ama = state[15];
+	Ame = state[16];
+	Ami = state[17];
+	Amo = state[18];
+	Amu = state[19];
+	Asa = state[20];
+	Ase = state[21];
+	Asi = state[22];
+	Aso = state[23];
+	Asu = state[24];
+
+	for (int i = 0; i < 24; i += 2)
+	{
+		KECCAK_ROUND (A, E, keccak_rc[i]);
+		KECCAK_ROUND (E, A, keccak_rc[i + 1]);
+	}
+
+	state[0] = Aba;
+	state[1] = Abe;
+	state[2] = Abi;
+	state[3] = Abo;
+	state[4] = Abu;
+	state[5] = Aga;
+	state[6] = Age;
+	state[7] = Agi;
+	state[8] = Ago;
+	state[9] = Agu;
+	state[10] = Aka;
+	state[11] = Ake;
+	state[12] = Aki;
+	state[13] = Ako;
+	state[14] = Aku;
+	state[15] = Ama;
+	state[16] = Ame;
+	state[17] = Ami;
+	state[18] = Amo;
+	state[19] = Amu;
+	state[20] = Asa;
+	state[21] = Ase;
+	state[22] = Asi;
+	state[23] = Aso;
+	state[24] = Asu;
+}
+
+
+// Lanes are serialized in little endian byte order
+static inline uint64_t
+keccak_load64 (
+	const uint8_t *in
+	)
+{
+	uint64_t lane = 0;
+
+	for (int i = 7; i >= 0; i--)
+		lane = (lane << 8) | in[i];
+	return lane;
+}
+
+
+int
+bbs_shake256_reset (
+	bbs_shake256_context *ctx
+	)
+{
+	for (int i = 0; i < 25; i++)
+		ctx->state[i] = (BBS_KECCAK_COMPLEMENTED >> i) & 1 ? ~(uint64_t) 0 : 0;
+	ctx->pos       = 0;
+	ctx->squeezing = 0;
+	return BBS_OK;
+}
+
+
+int
+bbs_shake256_input (
+	bbs_shake256_context *ctx,
+	const uint8_t        *msg,
+	uint64_t              msg_len
+	)
+{
+	if (ctx->squeezing)
+		return BBS_ERROR;
+
+	// XORing into the state does not care about complemented lanes. Top up
+	// a partial block first, then absorb full blocks lane by lane.
+	while (msg_len && ctx->pos)
+	{
+		ctx->state[ctx->pos / 8] ^= (uint64_t) *msg++ << (8 * (ctx->pos % 8));
+		msg_len--;
+		if (BBS_SHAKE256_RATE == ++ctx->pos)
+		{
+			bbs_keccak_f1600 (ctx->state);
+			ctx->pos = 0;
+		}
+	}
+	while (msg_len >= BBS_SHAKE256_RATE)
+	{
+		for (int i = 0; i < BBS_SHAKE256_RATE / 8; i++)
+			ctx->state[i] ^= keccak_load64 (msg + 8 * i);
+		bbs_keccak_f1600 (ctx->state);
+		msg     += BBS_SHAKE256_RATE;
+		msg_len -= BBS_SHAKE256_RATE;
+	}
+	for (; msg_len; msg_len--)
+	{
+		ctx->state[ctx->pos / 8] ^= (uint64_t) *msg++ << (8 * (ctx->pos % 8));
+		ctx->pos++;
+	}
+
+	return BBS_OK;
+}
+
+
+int
+bbs_shake256_result (
+	bbs_shake256_context *ctx,
+	uint8_t              *out,
+	uint64_t              out_len
+	)
+{
+	uint64_t lane;
+
+	if (! ctx->squeezing)
+	{
+		// Domain separation for SHAKE and pad10*1
+		ctx->state[ctx->pos / 8]                ^= (uint64_t) 0x1f << (8 * (ctx->pos % 8));
+		ctx->state[(BBS_SHAKE256_RATE - 1) / 8] ^= (uint64_t) 0x80 << 56;
+		bbs_keccak_f1600 (ctx->state);
+		ctx->pos       = 0;
+		ctx->squeezing = 1;
+	}
+
+	for (; out_len; out_len--)
+	{
+		if (BBS_SHAKE256_RATE == ctx->pos)
+		{
+			bbs_keccak_f1600 (ctx->state);
+			ctx->pos = 0;
+		}
+		lane = ctx->state[ctx->pos / 8];
+		if ((BBS_KECCAK_COMPLEMENTED >> (ctx->pos / 8)) & 1)
+			lane = ~lane;
+		*out++ = lane >> (8 * (ctx->pos % 8));
+		ctx->pos++;
+	}
+
+	return BBS_OK;
+}
@@ -0,0 +1,41 @@
+#ifndef BBS_KECCAK_H
+#define BBS_KECCAK_H
+
+#include <stdint.h>
+#include "bbs_util.h"
+
+// Keccak-f[1600] and SHAKE-256 for the BLS12-381-SHAKE-256 ciphersuite.
+// The state is kept in lane complementing representation, i.e. the lanes in
+// BBS_KECCAK_COMPLEMENTED are stored inverted. This saves most of the NOT
+// operations of the chi step. The representation is only visible through
+// bbs_keccak_f1600; the SHAKE functions take care of it.
+
+// Bit l is set iff lane l is stored complemented
+#define BBS_KECCAK_COMPLEMENTED ((1u << 1) | (1u << 2) | (1u << 8) | (1u << 12) | \
+				 (1u << 17) | (1u << 20))
+
+// Rate of SHAKE-256 in bytes
+#define BBS_SHAKE256_RATE 136
+
+void bbs_keccak_f1600(
+		uint64_t state[25]
+	);
+
+// Incremental SHAKE-256. Any amount of input may be absorbed before the first
+// call to result, which may then be called repeatedly to squeeze more output.
+// Absorbing after squeezing is an error.
+int bbs_shake256_reset(
+		bbs_shake256_context *ctx
+	);
+int bbs_shake256_input(
+		bbs_shake256_context *ctx,
+		const uint8_t        *msg,
+		uint64_t              msg_len
+	);
+int bbs_shake256_result(
+		bbs_shake256_context *ctx,
+		uint8_t              *out,
+		uint64_t              out_len
+	);
+
+#endif /*BBS_KECCAK_H*/
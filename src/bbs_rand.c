@@ -0,0 +1,159 @@
+#include "bbs.h"
+#include "bbs_rand.h"
+#include "bbs_chacha.h"
+#include <string.h>
+#include <unistd.h>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/random.h>
+#endif
+#include <pthread.h>
+
+// Keystream blocks per refill. The first 32 octets of every refill replace
+// the key, the rest is output.
+#define BBS_RAND_BLOCKS 4
+
+// Output octets between two reseeds
+#define BBS_RAND_RESEED (1 << 20)
+
+typedef struct {
+	uint8_t  key[32];
+	uint8_t  buffer[64 * BBS_RAND_BLOCKS];
+	uint64_t pos;
+	uint64_t since_reseed;
+	uint64_t generation;
+	int      seeded;
+} bbs_rand_state;
+
+static _Thread_local bbs_rand_state rand_state;
+
+// A fork copies the state of the forking thread into the child. The child has
+// to reseed, or it would repeat the output of the parent. A handler counts
+// the forks, so that telling the child apart costs no system call.
+// pthread_atfork is part of the C library wherever getrandom or getentropy
+// are, also without thread support.
+static uint64_t fork_generation;
+#ifdef BBS_THREADS
+static pthread_once_t fork_handler_once = PTHREAD_ONCE_INIT;
+#else
+static int            fork_handler_registered;
+#endif
+
+
+static void
+bbs_rand_fork_child (void)
+{
+	fork_generation++;
+}
+
+
+static void
+bbs_rand_fork_handler (void)
+{
+	pthread_atfork (NULL, NULL, bbs_rand_fork_child);
+}
+
+
+static uint64_t
+bbs_rand_generation (void)
+{
+#ifdef BBS_THREADS
+	pthread_once (&fork_handler_once, bbs_rand_fork_handler);
+#else
+	// Without thread support, all calls come from a single thread
+	if (! fork_handler_registered)
+	{
+		bbs_rand_fork_handler ();
+		fork_handler_registered = 1;
+	}
+#endif
+	return fork_generation;
+}
+
+
+static int
+bbs_rand_reseed (
+	bbs_rand_state *state
+	)
+{
+	uint8_t seed[32];
+	int     res = BBS_ERROR;
+
+#ifdef __linux__
+	if ((ssize_t) sizeof(seed) != getrandom (seed, sizeof(seed), 0))
+		goto cleanup;
+#else
+	if (0 != getentropy (seed, sizeof(seed)))
+		goto cleanup;
+#endif
+
+	for (int i = 0; i < 32; i++)
+		state->key[i] ^= seed[i];
+	memset (state->buffer, 0, sizeof(state->buffer));
+	state->pos          = sizeof(state->buffer);
+	state->since_reseed = 0;
+	state->generation   = bbs_rand_generation ();
+	state->seeded       = 1;
+
+	res = BBS_OK;
+cleanup:
+	bbs_wipe (seed, sizeof(seed));
+	return res;
+}
+
+
+int
+bbs_rand_bytes (
+	uint8_t *out,
+	uint64_t out_len
+	)
+{
+	bbs_rand_state *state = &rand_state;
+	uint64_t        chunk_len;
+	int             res = BBS_ERROR;
+
+	if (! state->seeded || state->generation != bbs_rand_generation () ||
+	    state->since_reseed >= BBS_RAND_RESEED)
+	{
+		if (BBS_OK != bbs_rand_reseed (state))
+			goto cleanup;
+	}
+
+	while (out_len)
+	{
+		if (state->pos == sizeof(state->buffer))
+		{
+			bbs_chacha20_blocks (state->key, 0, 0, state->buffer, BBS_RAND_BLOCKS);
+			memcpy (state->key, state->buffer, 32);
+			memset (state->buffer, 0, 32);
+			state->pos = 32;
+		}
+
+		// Output is wiped from the buffer as it is handed out
+		chunk_len = sizeof(state->buffer) - state->pos;
+		if (chunk_len > out_len)
+			chunk_len = out_len;
+		memcpy (out, state->buffer + state->pos, chunk_len);
+		memset (state->buffer + state->pos, 0, chunk_len);
+		state->pos          += chunk_len;
+		state->since_reseed += chunk_len;
+		out                 += chunk_len;
+		out_len             -= chunk_len;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+void
+bbs_wipe (
+	void  *buf,
+	size_t len
+	)
+{
+	volatile uint8_t *ptr = buf;
+
+	while (len--)
+		*ptr++ = 0;
+}
@@ -0,0 +1,23 @@
+#ifndef BBS_RAND_H
+#define BBS_RAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Random octets for keys, proof seeds and batch verification weights. Every
+// thread runs its own ChaCha20 generator with fast key erasure, seeded from
+// the operating system on first use, after BBS_RAND_RESEED octets of output
+// and in the child after a fork. Only (re)seeding makes a system call.
+int bbs_rand_bytes(
+		uint8_t *out,
+		uint64_t out_len
+	);
+
+// Clears secrets. Unlike memset, not dropped for buffers that are not read
+// afterwards.
+void bbs_wipe(
+		void  *buf,
+		size_t len
+	);
+
+#endif /*BBS_RAND_H*/
@@ -0,0 +1,326 @@
+#include "bbs.h"
+#include "bbs_util.h"
+#include <relic.h>
+
+// Arithmetic modulo the BLS12-381 group order
+// r = 0x73eda753299d7d483339d80809a1d80553bda402fffe5bfeffffffff00000001.
+// Scalars are kept in Montgomery form a * R mod r with R = 2^256, and every
+// function runs in time independent of its (secret) inputs.
+
+typedef unsigned __int128 sc_dlimb;
+
+static const uint64_t sc_r[4] = {
+	0xffffffff00000001, 0x53bda402fffe5bfe, 0x3339d80809a1d805, 0x73eda753299d7d48
+};
+
+// -r^-1 mod 2^64
+#define SC_R_INV 0xfffffffeffffffff
+
+// R^2 and R^3 mod r, to convert into Montgomery form
+static const uint64_t sc_r2[4] = {
+	0xc999e990f3f29c6d, 0x2b6cedcb87925c23, 0x05d314967254398f, 0x0748d9d99f59ff11
+};
+static const uint64_t sc_r3[4] = {
+	0xc62c1807439b73af, 0x1b3e0d188cf06990, 0x73d13c71c7b5f418, 0x6e2a5bb9c8db33e9
+};
+
+static const uint64_t sc_one[4] = {1, 0, 0, 0};
+
+
+// c = a - r if that does not underflow, a otherwise. carry is a carry out of
+// bit 256 of a.
+static void
+sc_reduce_once (
+	sc_t           c,
+	const uint64_t a[4],
+	uint64_t       carry
+	)
+{
+	uint64_t t[4], borrow = 0, mask;
+	sc_dlimb d;
+
+	for (int i = 0; i < 4; i++)
+	{
+		d      = (sc_dlimb) a[i] - sc_r[i] - borrow;
+		t[i]   = (uint64_t) d;
+		borrow = (uint64_t) (d >> 64) & 1;
+	}
+	// Keep a iff the subtraction borrowed beyond the carry
+	mask = 0 - (uint64_t) (borrow > carry);
+	for (int i = 0; i < 4; i++)
+		c[i] = (a[i] & mask) | (t[i] & ~mask);
+}
+
+
+// Montgomery multiplication c = a * b / R mod r (CIOS). Requires a * b < r * R,
+// e.g. a < R and b < r.
+static void
+sc_mont_mul (
+	sc_t           c,
+	const uint64_t a[4],
+	const uint64_t b[4]
+	)
+{
+	uint64_t t[6] = {0}, m;
+	sc_dlimb acc;
+
+	for (int i = 0; i < 4; i++)
+	{
+		acc = 0;
+		for (int j = 0; j < 4; j++)
+		{
+			acc  = (sc_dlimb) a[j] * b[i] + t[j] + (uint64_t) (acc >> 64);
+			t[j] = (uint64_t) acc;
+		}
+		acc  = (sc_dlimb) t[4] + (uint64_t) (acc >> 64);
+		t[4] = (uint64_t) acc;
+		t[5] = (uint64_t) (acc >> 64);
+
+		m   = t[0] * SC_R_INV;
+		acc = (sc_dlimb) m * sc_r[0] + t[0];
+		for (int j = 1; j < 4; j++)
+		{
+			acc      = (sc_dlimb) m * sc_r[j] + t[j] + (uint64_t) (acc >> 64);
+			t[j - 1] = (uint64_t) acc;
+		}
+		acc  = (sc_dlimb) t[4] + (uint64_t) (acc >> 64);
+		t[3] = (uint64_t) acc;
+		t[4] = t[5] + (uint64_t) (acc >> 64);
+	}
+	sc_reduce_once (c, t, t[4]);
+}
+
+
+static void
+sc_read_be (
+	uint64_t       c[4],
+	const uint8_t *bin
+	)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		c[3 - i] = 0;
+		for (int j = 0; j < 8; j++)
+			c[3 - i] = (c[3 - i] << 8) | bin[8 * i + j];
+	}
+}
+
+
+void
+sc_zero (
+	sc_t c
+	)
+{
+	for (int i = 0; i < 4; i++)
+		c[i] = 0;
+}
+
+
+int
+sc_is_zero (
+	const sc_t a
+	)
+{
+	return 0 == (a[0] | a[1] | a[2] | a[3]);
+}
+
+
+int
+sc_cmp (
+	const sc_t a,
+	const sc_t b
+	)
+{
+	return 0 == ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3])) ? RLC_EQ :
+	       RLC_NE;
+}
+
+
+int
+sc_read_bbs (
+	sc_t          c,
+	const uint8_t bin[BBS_SCALAR_LEN]
+	)
+{
+	uint64_t a[4], borrow = 0;
+	sc_dlimb d;
+
+	sc_read_be (a, bin);
+	for (int i = 0; i < 4; i++)
+	{
+		d      = (sc_dlimb) a[i] - sc_r[i] - borrow;
+		borrow = (uint64_t) (d >> 64) & 1;
+	}
+	if (! borrow)
+		return BBS_ERROR;
+
+	sc_mont_mul (c, a, sc_r2);
+	return BBS_OK;
+}
+
+
+void
+sc_write_bbs (
+	uint8_t    bin[BBS_SCALAR_LEN],
+	const sc_t a
+	)
+{
+	uint64_t t[4];
+
+	sc_mont_mul (t, a, sc_one);
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 8; j++)
+			bin[8 * i + j] = t[3 - i] >> (56 - 8 * j);
+}
+
+
+void
+sc_read_wide (
+	sc_t          c,
+	const uint8_t bin[48]
+	)
+{
+	uint64_t hi[4] = {0}, lo[4], t[4];
+
+	// bin = hi * 2^256 + lo with hi < 2^128. hi * R^3 / R = hi * 2^256 * R.
+	for (int j = 0; j < 8; j++)
+	{
+		hi[1] = (hi[1] << 8) | bin[j];
+		hi[0] = (hi[0] << 8) | bin[8 + j];
+	}
+	sc_read_be (lo, bin + 16);
+	sc_mont_mul (t, hi, sc_r3);
+	sc_mont_mul (c, lo, sc_r2);
+	sc_add (c, c, t);
+}
+
+
+void
+sc_read_bn (
+	sc_t       c,
+	const bn_t a
+	)
+{
+	uint8_t  bin[BBS_SCALAR_LEN];
+	uint64_t t[4];
+
+	bn_write_bin (bin, BBS_SCALAR_LEN, a);
+	sc_read_be (t, bin);
+	sc_mont_mul (c, t, sc_r2);
+}
+
+
+void
+sc_write_bn (
+	bn_t       c,
+	const sc_t a
+	)
+{
+	uint8_t bin[BBS_SCALAR_LEN];
+
+	sc_write_bbs (bin, a);
+	bn_read_bin (c, bin, BBS_SCALAR_LEN);
+}
+
+
+void
+sc_add (
+	sc_t       c,
+	const sc_t a,
+	const sc_t b
+	)
+{
+	uint64_t t[4];
+	sc_dlimb acc = 0;
+
+	// a + b < 2r < 2^256, so there is no carry out
+	for (int i = 0; i < 4; i++)
+	{
+		acc  = (sc_dlimb) a[i] + b[i] + (uint64_t) (acc >> 64);
+		t[i] = (uint64_t) acc;
+	}
+	sc_reduce_once (c, t, 0);
+}
+
+
+void
+sc_sub (
+	sc_t       c,
+	const sc_t a,
+	const sc_t b
+	)
+{
+	uint64_t t[4], borrow = 0, mask;
+	sc_dlimb d, acc = 0;
+
+	for (int i = 0; i < 4; i++)
+	{
+		d      = (sc_dlimb) a[i] - b[i] - borrow;
+		t[i]   = (uint64_t) d;
+		borrow = (uint64_t) (d >> 64) & 1;
+	}
+	// Add r back if a < b
+	mask = 0 - borrow;
+	for (int i = 0; i < 4; i++)
+	{
+		acc  = (sc_dlimb) t[i] + (sc_r[i] & mask) + (uint64_t) (acc >> 64);
+		c[i] = (uint64_t) acc;
+	}
+}
+
+
+void
+sc_neg (
+	sc_t       c,
+	const sc_t a
+	)
+{
+	static const uint64_t zero[4] = {0};
+
+	sc_sub (c, zero, a);
+}
+
+
+void
+sc_mul (
+	sc_t       c,
+	const sc_t a,
+	const sc_t b
+	)
+{
+	sc_mont_mul (c, a, b);
+}
+
+
+void
+sc_inv (
+	sc_t       c,
+	const sc_t a
+	)
+{
+	// a^(r - 2) with a fixed 4 bit window. The exponent is public.
+	static const uint64_t e[4] = {
+		0xfffffffeffffffff, 0x53bda402fffe5bfe, 0x3339d80809a1d805, 0x73eda753299d7d48
+	};
+	uint64_t table[16][4], t[4];
+	int      w;
+
+	// table[i] = a^i, in Montgomery form R is 1
+	sc_mont_mul (table[0], sc_r2, sc_one);
+	for (int i = 0; i < 4; i++)
+		table[1][i] = a[i];
+	for (int i = 2; i < 16; i++)
+		sc_mont_mul (table[i], table[i - 1], a);
+
+	for (int i = 0; i < 4; i++)
+		t[i] = table[0][i];
+	for (int bit = 252; bit >= 0; bit -= 4)
+	{
+		for (int s = 0; s < 4; s++)
+			sc_mont_mul (t, t, t);
+		w = (e[bit / 64] >> (bit % 64)) & 0xf;
+		sc_mont_mul (t, t, table[w]);
+	}
+	for (int i = 0; i < 4; i++)
+		c[i] = t[i];
+}
@@ -0,0 +1,330 @@
+#include "bbs.h"
+#include "bbs_util.h"
+#include "bbs_sha256.h"
+#include <string.h>
+#ifdef BBS_SHA256_ARMV8
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+const uint32_t bbs_sha256_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+const uint32_t bbs_sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define BSIG0(x)     (ROTR (x, 2) ^ ROTR (x, 13) ^ ROTR (x, 22))
+#define BSIG1(x)     (ROTR (x, 6) ^ ROTR (x, 11) ^ ROTR (x, 25))
+#define SSIG0(x)     (ROTR (x, 7) ^ ROTR (x, 18) ^ ((x) >> 3))
+#define SSIG1(x)     (ROTR (x, 17) ^ ROTR (x, 19) ^ ((x) >> 10))
+
+
+void
+bbs_sha256_compress_generic (
+	uint32_t       state[8],
+	const uint8_t *blocks,
+	uint64_t       num_blocks
+	)
+{
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h, t1, t2;
+
+	while (num_blocks--)
+	{
+		for (int t = 0; t < 16; t++)
+			w[t] = ((uint32_t) blocks[4 * t] << 24) | ((uint32_t) blocks[4 * t + 1] << 16)
+			       | ((uint32_t) blocks[4 * t + 2] << 8) | blocks[4 * t + 3];
+		for (int t = 16; t < 64; t++)
+			w[t] = SSIG1 (w[t - 2]) + w[t - 7] + SSIG0 (w[t - 15]) + w[t - 16];
+
+		a = state[0]; b = state[1]; c = state[2]; d = state[3];
+		e = state[4]; f = state[5]; g = state[6]; h = state[7];
+		for (int t = 0; t < 64; t++)
+		{
+			t1 = h + BSIG1 (e) + CH (e, f, g) + bbs_sha256_k[t] + w[t];
+			t2 = BSIG0 (a) + MAJ (a, b, c);
+			h  = g; g = f; f = e; e = d + t1;
+			d  = c; c = b; b = a; a = t1 + t2;
+		}
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+		blocks += 64;
+	}
+}
+
+
+// The backend is selected once, when the library is loaded
+static bbs_sha256_backend sha256_backend = BBS_SHA256_GENERIC;
+static void (*sha256_compress)(uint32_t[8], const uint8_t*,
+			       uint64_t) = bbs_sha256_compress_generic;
+
+
+static int
+sha256_backend_supported (
+	bbs_sha256_backend backend
+	)
+{
+	switch (backend)
+	{
+	case BBS_SHA256_GENERIC:
+		return 1;
+#ifdef BBS_SHA256_X86
+	case BBS_SHA256_SHANI:
+		return __builtin_cpu_supports ("sha") && __builtin_cpu_supports ("sse4.1");
+#endif
+#ifdef BBS_SHA256_ARMV8
+	case BBS_SHA256_ARMV8:
+#if defined(__APPLE__)
+		return 1;
+#elif defined(__linux__)
+		return 0 != (getauxval (AT_HWCAP) & HWCAP_SHA2);
+#else
+		return 0;
+#endif
+#endif
+	default:
+		return 0;
+	}
+}
+
+
+int
+bbs_sha256_set_backend (
+	bbs_sha256_backend backend
+	)
+{
+	int res = BBS_ERROR;
+
+	if (! sha256_backend_supported (backend))
+		goto cleanup;
+
+	switch (backend)
+	{
+#ifdef BBS_SHA256_X86
+	case BBS_SHA256_SHANI:
+		sha256_compress = bbs_sha256_compress_shani;
+		break;
+#endif
+#ifdef BBS_SHA256_ARMV8
+	case BBS_SHA256_ARMV8:
+		sha256_compress = bbs_sha256_compress_armv8;
+		break;
+#endif
+	default:
+		sha256_compress = bbs_sha256_compress_generic;
+		break;
+	}
+	sha256_backend = backend;
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+bbs_sha256_backend
+bbs_sha256_get_backend (void)
+{
+	return sha256_backend;
+}
+
+
+__attribute__ ((constructor)) static void
+sha256_select_backend (void)
+{
+	if (BBS_OK == bbs_sha256_set_backend (BBS_SHA256_SHANI))
+		return;
+	if (BBS_OK == bbs_sha256_set_backend (BBS_SHA256_ARMV8))
+		return;
+	bbs_sha256_set_backend (BBS_SHA256_GENERIC);
+}
+
+
+void
+bbs_sha256_compress (
+	uint32_t       state[8],
+	const uint8_t *blocks,
+	uint64_t       num_blocks
+	)
+{
+	sha256_compress (state, blocks, num_blocks);
+}
+
+
+int
+bbs_sha256_reset (
+	SHA256Context *ctx
+	)
+{
+	memcpy (ctx->Intermediate_Hash, bbs_sha256_iv, sizeof(bbs_sha256_iv));
+	ctx->Length_High         = 0;
+	ctx->Length_Low          = 0;
+	ctx->Message_Block_Index = 0;
+	ctx->Computed            = 0;
+	ctx->Corrupted           = shaSuccess;
+	return shaSuccess;
+}
+
+
+int
+bbs_sha256_input (
+	SHA256Context *ctx,
+	const uint8_t *msg,
+	uint64_t       msg_len
+	)
+{
+	uint64_t bit_len = ((uint64_t) ctx->Length_High << 32) | ctx->Length_Low;
+	uint64_t num_blocks, fill;
+
+	if (ctx->Corrupted)
+		return ctx->Corrupted;
+	if (ctx->Computed)
+		return ctx->Corrupted = shaStateError;
+	if (msg_len > (UINT64_MAX - bit_len) / 8)
+		return ctx->Corrupted = shaInputTooLong;
+
+	bit_len         += msg_len * 8;
+	ctx->Length_High = bit_len >> 32;
+	ctx->Length_Low  = bit_len;
+
+	// Top up a partial block first, then compress full blocks in place
+	if (ctx->Message_Block_Index)
+	{
+		fill = 64 - ctx->Message_Block_Index;
+		if (fill > msg_len)
+			fill = msg_len;
+		memcpy (ctx->Message_Block + ctx->Message_Block_Index, msg, fill);
+		ctx->Message_Block_Index += fill;
+		msg                      += fill;
+		msg_len                  -= fill;
+		if (ctx->Message_Block_Index < 64)
+			return shaSuccess;
+		sha256_compress (ctx->Intermediate_Hash, ctx->Message_Block, 1);
+		ctx->Message_Block_Index = 0;
+	}
+
+	num_blocks = msg_len / 64;
+	if (num_blocks)
+		sha256_compress (ctx->Intermediate_Hash, msg, num_blocks);
+	msg     += 64 * num_blocks;
+	msg_len -= 64 * num_blocks;
+
+	memcpy (ctx->Message_Block, msg, msg_len);
+	ctx->Message_Block_Index = msg_len;
+	return shaSuccess;
+}
+
+
+int
+bbs_sha256_result (
+	SHA256Context *ctx,
+	uint8_t        digest[32]
+	)
+{
+	uint64_t bit_len = ((uint64_t) ctx->Length_High << 32) | ctx->Length_Low;
+	int      idx     = ctx->Message_Block_Index;
+
+	if (ctx->Corrupted)
+		return ctx->Corrupted;
+
+	if (! ctx->Computed)
+	{
+		ctx->Message_Block[idx++] = 0x80;
+		if (idx > 56)
+		{
+			memset (ctx->Message_Block + idx, 0, 64 - idx);
+			sha256_compress (ctx->Intermediate_Hash, ctx->Message_Block, 1);
+			idx = 0;
+		}
+		memset (ctx->Message_Block + idx, 0, 56 - idx);
+		for (int i = 0; i < 8; i++)
+			ctx->Message_Block[63 - i] = bit_len >> (8 * i);
+		sha256_compress (ctx->Intermediate_Hash, ctx->Message_Block, 1);
+		ctx->Message_Block_Index = 0;
+		ctx->Computed            = 1;
+	}
+
+	bbs_sha256_digest (digest, ctx->Intermediate_Hash);
+	return shaSuccess;
+}
+
+
+void
+bbs_sha256_digest (
+	uint8_t        out[32],
+	const uint32_t state[8]
+	)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		out[4 * i]     = state[i] >> 24;
+		out[4 * i + 1] = state[i] >> 16;
+		out[4 * i + 2] = state[i] >> 8;
+		out[4 * i + 3] = state[i];
+	}
+}
+
+
+// 4 lanes fit into the 128 bit vectors that every target we build for has
+#define BBS_SHA256_MB_LANES 4
+#define BBS_SHA256_MB_NAME  bbs_sha256_compress_x4
+#include "bbs_sha256_mb.h"
+
+
+void
+bbs_sha256_compress_mb (
+	uint32_t             state[][8],
+	const uint8_t *const blocks[],
+	uint64_t             num_blocks,
+	uint64_t             num_lanes
+	)
+{
+	uint64_t i = 0;
+
+#ifdef BBS_SHA256_X86
+	if (__builtin_cpu_supports ("avx512f"))
+	{
+		for (; i + 16 <= num_lanes; i += 16)
+			bbs_sha256_compress_x16 (state + i, blocks + i, num_blocks);
+	}
+#endif
+	// Hardware SHA-256 outperforms the narrower multi-buffer variants
+	if (BBS_SHA256_GENERIC == sha256_backend)
+	{
+#ifdef BBS_SHA256_X86
+		if (__builtin_cpu_supports ("avx2"))
+		{
+			for (; i + 8 <= num_lanes; i += 8)
+				bbs_sha256_compress_x8 (state + i, blocks + i, num_blocks);
+		}
+#endif
+		for (; i + 4 <= num_lanes; i += 4)
+			bbs_sha256_compress_x4 (state + i, blocks + i, num_blocks);
+	}
+	for (; i < num_lanes; i++)
+		bbs_sha256_compress (state[i], blocks[i], num_blocks);
+}
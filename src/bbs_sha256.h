@@ -0,0 +1,91 @@
+#ifndef BBS_SHA256_H
+#define BBS_SHA256_H
+
+#include <stdint.h>
+#include <sha.h>
+
+// Raw SHA-256 primitives for the hashing fast paths. Callers are responsible
+// for padding; state is kept in host word order.
+
+extern const uint32_t bbs_sha256_iv[8];
+extern const uint32_t bbs_sha256_k[64];
+
+// Upper bound on the number of lanes processed in parallel
+#define BBS_SHA256_MAX_LANES 16
+
+// Compress num_blocks consecutive 64 byte blocks into state, using the
+// backend selected by bbs_sha256_set_backend
+void bbs_sha256_compress(
+		uint32_t       state[8],
+		const uint8_t *blocks,
+		uint64_t       num_blocks
+	);
+
+// The backends. shani is only built on x86 (BBS_SHA256_X86), armv8 only on
+// AArch64 (BBS_SHA256_ARMV8). Both need the respective CPU support.
+void bbs_sha256_compress_generic(
+		uint32_t       state[8],
+		const uint8_t *blocks,
+		uint64_t       num_blocks
+	);
+void bbs_sha256_compress_shani(
+		uint32_t       state[8],
+		const uint8_t *blocks,
+		uint64_t       num_blocks
+	);
+void bbs_sha256_compress_armv8(
+		uint32_t       state[8],
+		const uint8_t *blocks,
+		uint64_t       num_blocks
+	);
+
+// Multi-buffer variants. Lane l compresses num_blocks consecutive blocks
+// starting at blocks[l] into state[l]. The x8 and x16 versions are only built
+// on x86 (BBS_SHA256_X86) and need AVX2 and AVX-512F respectively.
+void bbs_sha256_compress_x4(
+		uint32_t             state[][8],
+		const uint8_t *const blocks[],
+		uint64_t             num_blocks
+	);
+void bbs_sha256_compress_x8(
+		uint32_t             state[][8],
+		const uint8_t *const blocks[],
+		uint64_t             num_blocks
+	);
+void bbs_sha256_compress_x16(
+		uint32_t             state[][8],
+		const uint8_t *const blocks[],
+		uint64_t             num_blocks
+	);
+
+// Compress num_lanes independent messages, using the multi-buffer variants
+// that beat the selected single-buffer backend on this CPU
+void bbs_sha256_compress_mb(
+		uint32_t             state[][8],
+		const uint8_t *const blocks[],
+		uint64_t             num_blocks,
+		uint64_t             num_lanes
+	);
+
+// Drop-in replacements for relic's SHA256Reset, SHA256Input and SHA256Result,
+// working on the same context, but compressing through bbs_sha256_compress
+int bbs_sha256_reset(
+		SHA256Context *ctx
+	);
+int bbs_sha256_input(
+		SHA256Context *ctx,
+		const uint8_t *msg,
+		uint64_t       msg_len
+	);
+int bbs_sha256_result(
+		SHA256Context *ctx,
+		uint8_t        digest[32]
+	);
+
+// Write state as a big endian digest
+void bbs_sha256_digest(
+		uint8_t        out[32],
+		const uint32_t state[8]
+	);
+
+#endif /*BBS_SHA256_H*/
@@ -0,0 +1,50 @@
+// SHA-256 compression with the ARMv8 cryptographic extensions, built with
+// -march=armv8-a+crypto
+#include "bbs_sha256.h"
+#include <arm_neon.h>
+
+
+void
+bbs_sha256_compress_armv8 (
+	uint32_t       state[8],
+	const uint8_t *blocks,
+	uint64_t       num_blocks
+	)
+{
+	uint32x4_t abcd, efgh, abcd_save, efgh_save, tmp, m[4];
+
+	abcd = vld1q_u32 (&state[0]);
+	efgh = vld1q_u32 (&state[4]);
+
+	while (num_blocks--)
+	{
+		abcd_save = abcd;
+		efgh_save = efgh;
+
+		for (int i = 0; i < 4; i++)
+			m[i] = vreinterpretq_u32_u8 (vrev32q_u8 (vld1q_u8 (blocks + 16 * i)));
+
+		// Four rounds per iteration. m[i & 3] holds W[4i .. 4i + 3] and is
+		// replaced by W[4i + 16 .. 4i + 19] once consumed.
+		for (int i = 0; i < 16; i++)
+		{
+			uint32x4_t abcd_prev = abcd;
+
+			tmp  = vaddq_u32 (m[i & 3], vld1q_u32 (&bbs_sha256_k[4 * i]));
+			abcd = vsha256hq_u32 (abcd, efgh, tmp);
+			efgh = vsha256h2q_u32 (efgh, abcd_prev, tmp);
+			if (i < 12)
+			{
+				m[i & 3] = vsha256su1q_u32 (vsha256su0q_u32 (m[i & 3], m[(i + 1) & 3]),
+							    m[(i + 2) & 3], m[(i + 3) & 3]);
+			}
+		}
+
+		abcd    = vaddq_u32 (abcd, abcd_save);
+		efgh    = vaddq_u32 (efgh, efgh_save);
+		blocks += 64;
+	}
+
+	vst1q_u32 (&state[0], abcd);
+	vst1q_u32 (&state[4], efgh);
+}
@@ -0,0 +1,71 @@
+// Multi-buffer SHA-256 compression. Each 32-bit lane of a vector holds the
+// state of an independent message, so that one pass over the rounds
+// compresses BBS_SHA256_MB_LANES blocks at once.
+// This file is a template. Define BBS_SHA256_MB_LANES and BBS_SHA256_MB_NAME
+// before including it, and compile the including file for an instruction set
+// with vectors of 4 * BBS_SHA256_MB_LANES bytes.
+
+#include "bbs_sha256.h"
+
+#if ! defined(BBS_SHA256_MB_LANES) || ! defined(BBS_SHA256_MB_NAME)
+#error "BBS_SHA256_MB_LANES and BBS_SHA256_MB_NAME must be defined"
+#endif
+
+typedef uint32_t bbs_sha256_vec __attribute__ ((vector_size (4 * BBS_SHA256_MB_LANES)));
+
+#define MB_ROTR(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+#define MB_CH(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define MB_MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define MB_BSIG0(x)     (MB_ROTR (x, 2) ^ MB_ROTR (x, 13) ^ MB_ROTR (x, 22))
+#define MB_BSIG1(x)     (MB_ROTR (x, 6) ^ MB_ROTR (x, 11) ^ MB_ROTR (x, 25))
+#define MB_SSIG0(x)     (MB_ROTR (x, 7) ^ MB_ROTR (x, 18) ^ ((x) >> 3))
+#define MB_SSIG1(x)     (MB_ROTR (x, 17) ^ MB_ROTR (x, 19) ^ ((x) >> 10))
+
+
+void
+BBS_SHA256_MB_NAME (
+	uint32_t             state[][8],
+	const uint8_t *const blocks[],
+	uint64_t             num_blocks
+	)
+{
+	bbs_sha256_vec w[64];
+	bbs_sha256_vec s[8];
+	bbs_sha256_vec a, b, c, d, e, f, g, h, t1, t2;
+	uint64_t       offset = 0;
+
+	for (int i = 0; i < 8; i++)
+		for (int l = 0; l < BBS_SHA256_MB_LANES; l++)
+			s[i][l] = state[l][i];
+
+	while (num_blocks--)
+	{
+		for (int t = 0; t < 16; t++)
+			for (int l = 0; l < BBS_SHA256_MB_LANES; l++)
+			{
+				const uint8_t *p = blocks[l] + offset + 4 * t;
+				w[t][l] = ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16)
+					  | ((uint32_t) p[2] << 8) | p[3];
+			}
+		for (int t = 16; t < 64; t++)
+			w[t] = MB_SSIG1 (w[t - 2]) + w[t - 7] + MB_SSIG0 (w[t - 15]) + w[t - 16];
+
+		a = s[0]; b = s[1]; c = s[2]; d = s[3];
+		e = s[4]; f = s[5]; g = s[6]; h = s[7];
+		for (int t = 0; t < 64; t++)
+		{
+			t1 = h + MB_BSIG1 (e) + MB_CH (e, f, g) + bbs_sha256_k[t] + w[t];
+			t2 = MB_BSIG0 (a) + MB_MAJ (a, b, c);
+			h  = g; g = f; f = e; e = d + t1;
+			d  = c; c = b; b = a; a = t1 + t2;
+		}
+		s[0] += a; s[1] += b; s[2] += c; s[3] += d;
+		s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+
+		offset += 64;
+	}
+
+	for (int i = 0; i < 8; i++)
+		for (int l = 0; l < BBS_SHA256_MB_LANES; l++)
+			state[l][i] = s[i][l];
+}
@@ -0,0 +1,57 @@
+// SHA-256 compression with the x86 SHA extensions, built with -msha -msse4.1
+#include "bbs_sha256.h"
+#include <immintrin.h>
+
+
+void
+bbs_sha256_compress_shani (
+	uint32_t       state[8],
+	const uint8_t *blocks,
+	uint64_t       num_blocks
+	)
+{
+	const __m128i bswap = _mm_set_epi64x (0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i       abef, cdgh, abef_save, cdgh_save, tmp, m[4];
+
+	// The round instructions keep the state as ABEF and CDGH
+	tmp  = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i*) &state[0]), 0xb1);
+	cdgh = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i*) &state[4]), 0x1b);
+	abef = _mm_alignr_epi8 (tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16 (cdgh, tmp, 0xf0);
+
+	while (num_blocks--)
+	{
+		abef_save = abef;
+		cdgh_save = cdgh;
+
+		for (int i = 0; i < 4; i++)
+			m[i] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i*) (blocks + 16 * i)),
+						 bswap);
+
+		// Four rounds per iteration. m[i & 3] holds W[4i .. 4i + 3] and is
+		// replaced by W[4i + 16 .. 4i + 19] once consumed.
+		for (int i = 0; i < 16; i++)
+		{
+			tmp  = _mm_add_epi32 (m[i & 3],
+					      _mm_loadu_si128 ((const __m128i*) &bbs_sha256_k[4 * i]));
+			cdgh = _mm_sha256rnds2_epu32 (cdgh, abef, tmp);
+			abef = _mm_sha256rnds2_epu32 (abef, cdgh, _mm_shuffle_epi32 (tmp, 0x0e));
+			if (i < 12)
+			{
+				m[i & 3] = _mm_sha256msg2_epu32 (
+					_mm_add_epi32 (_mm_sha256msg1_epu32 (m[i & 3], m[(i + 1) & 3]),
+						       _mm_alignr_epi8 (m[(i + 3) & 3], m[(i + 2) & 3], 4)),
+					m[(i + 3) & 3]);
+			}
+		}
+
+		abef    = _mm_add_epi32 (abef, abef_save);
+		cdgh    = _mm_add_epi32 (cdgh, cdgh_save);
+		blocks += 64;
+	}
+
+	tmp  = _mm_shuffle_epi32 (abef, 0x1b);
+	cdgh = _mm_shuffle_epi32 (cdgh, 0xb1);
+	_mm_storeu_si128 ((__m128i*) &state[0], _mm_blend_epi16 (tmp, cdgh, 0xf0));
+	_mm_storeu_si128 ((__m128i*) &state[4], _mm_alignr_epi8 (cdgh, tmp, 8));
+}
@@ -0,0 +1,4 @@
+// 16 lane SHA-256, built with AVX-512F
+#define BBS_SHA256_MB_LANES 16
+#define BBS_SHA256_MB_NAME  bbs_sha256_compress_x16
+#include "bbs_sha256_mb.h"
@@ -0,0 +1,4 @@
+// 8 lane SHA-256, built with AVX2
+#define BBS_SHA256_MB_LANES 8
+#define BBS_SHA256_MB_NAME  bbs_sha256_compress_x8
+#include "bbs_sha256_mb.h"
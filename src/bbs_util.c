@@ -1,5 +1,8 @@
 #include "bbs.h"
 #include "bbs_util.h"
+#include "bbs_sha256.h"
+#include "bbs_keccak.h"
+#include <string.h>
 
 inline void
 bn_write_bbs (
@@ -158,35 +161,42 @@ ep2_read_bbs (
 }
 
 
-int
-expand_message_init (
-	SHA256Context *ctx
+// SHA-256 state after absorbing Z_pad, i.e. 64 zero bytes. Every
+// expand_message_xmd call starts from here, so that the Z_pad block is never
+// compressed at runtime.
+static const SHA256Context expand_message_zpad_ctx = {
+	.Intermediate_Hash   = {
+		0xda5698be, 0x17b9b469, 0x62335799, 0x779fbeca,
+		0x8ce5d491, 0xc0d26243, 0xbafef9ea, 0x1837a9d8
+	},
+	.Length_High         = 0,
+	.Length_Low          = 512,
+	.Message_Block_Index = 0,
+	.Computed            = 0,
+	.Corrupted           = shaSuccess,
+};
+
+
+static int
+expand_message_xmd_init (
+	bbs_hash_context *ctx
 	)
 {
-	uint64_t zero[] = {0, 0, 0, 0, 0, 0, 0, 0};
-	int      res    = BBS_ERROR;
-
-	if (shaSuccess != SHA256Reset (ctx))
-		goto cleanup;
-	if (shaSuccess != SHA256Input (ctx, (uint8_t*) zero, 64))
-		goto cleanup;
-
-	res = BBS_OK;
-cleanup:
-	return res;
+	ctx->sha256 = expand_message_zpad_ctx;
+	return BBS_OK;
 }
 
 
-int
-expand_message_update (
-	SHA256Context *ctx,
-	const uint8_t *msg,
-	uint32_t       msg_len
+static int
+expand_message_xmd_update (
+	bbs_hash_context *ctx,
+	const uint8_t    *msg,
+	uint64_t          msg_len
 	)
 {
 	int res = BBS_ERROR;
 
-	if (shaSuccess != SHA256Input (ctx, msg, msg_len))
+	if (shaSuccess != bbs_sha256_input (&ctx->sha256, msg, msg_len))
 		goto cleanup;
 
 	res = BBS_OK;
@@ -195,95 +205,243 @@ cleanup:
 }
 
 
-int
-expand_message_finalize (
-	SHA256Context *ctx,
-	uint8_t        out[48],
-	const uint8_t *dst,
-	uint8_t        dst_len
+static int
+expand_message_xmd_finalize (
+	bbs_hash_context *ctx,
+	uint8_t          *out,
+	uint16_t          out_len,
+	const uint8_t    *dst,
+	uint8_t           dst_len
 	)
 {
-	uint8_t b_0[32];
-	uint8_t b_1[32];
-	uint8_t b_2[32];
-	int     res = BBS_ERROR;
-	uint8_t num = 0;
+	SHA256Context *sha = &ctx->sha256;
+	uint8_t        b_0[32];
+	uint8_t        b_i[32];
+	uint8_t        chain[32];
+	int            ell = (out_len + 31) / 32;
+	int            res = BBS_ERROR;
+	uint8_t        num;
+
+	if (ell > 255)
+		goto cleanup;
 
-	if (shaSuccess != SHA256Input (ctx, &num, 1))
+	// b_0 = H(Z_pad, msg, I2OSP(out_len, 2), I2OSP(0, 1), dst, I2OSP(dst_len, 1))
+	num = out_len >> 8;
+	if (shaSuccess != bbs_sha256_input (sha, &num, 1))
 		goto cleanup;
-	num = 48;
-	if (shaSuccess != SHA256Input (ctx, &num, 1))
+	num = out_len & 0xff;
+	if (shaSuccess != bbs_sha256_input (sha, &num, 1))
 		goto cleanup;
 	num = 0;
-	if (shaSuccess != SHA256Input (ctx, &num, 1))
+	if (shaSuccess != bbs_sha256_input (sha, &num, 1))
 		goto cleanup;
-	if (shaSuccess != SHA256Input (ctx, dst, dst_len))
+	if (shaSuccess != bbs_sha256_input (sha, dst, dst_len))
 		goto cleanup;
-	if (shaSuccess != SHA256Input (ctx, &dst_len, 1))
+	if (shaSuccess != bbs_sha256_input (sha, &dst_len, 1))
 		goto cleanup;
-	if (shaSuccess != SHA256Result (ctx, b_0))
+	if (shaSuccess != bbs_sha256_result (sha, b_0))
 		goto cleanup;
 
-	// b_1 = H( b_0, I2OSP(1,1), dst, I2OSP(dst_len, 1))
-	if (shaSuccess != SHA256Reset (ctx))
-		goto cleanup;
-	if (shaSuccess != SHA256Input (ctx, b_0, 32))
-		goto cleanup;
-	num = 1;
-	if (shaSuccess != SHA256Input (ctx, &num, 1))
-		goto cleanup;
-	if (shaSuccess != SHA256Input (ctx, dst, dst_len))
-		goto cleanup;
-	if (shaSuccess != SHA256Input (ctx, &dst_len, 1))
-		goto cleanup;
-	if (shaSuccess != SHA256Result (ctx, b_1))
-		goto cleanup;
+	for (int i = 1; i <= ell; i++)
+	{
+		// b_i = H(b_0 ^ b_(i-1), I2OSP(i, 1), dst, I2OSP(dst_len, 1)),
+		// where b_1 only uses b_0
+		for (int j = 0; j < 32; j++)
+			chain[j] = (1 == i) ? b_0[j] : b_0[j] ^ b_i[j];
+		if (shaSuccess != bbs_sha256_reset (sha))
+			goto cleanup;
+		if (shaSuccess != bbs_sha256_input (sha, chain, 32))
+			goto cleanup;
+		num = i;
+		if (shaSuccess != bbs_sha256_input (sha, &num, 1))
+			goto cleanup;
+		if (shaSuccess != bbs_sha256_input (sha, dst, dst_len))
+			goto cleanup;
+		if (shaSuccess != bbs_sha256_input (sha, &dst_len, 1))
+			goto cleanup;
+		if (shaSuccess != bbs_sha256_result (sha, b_i))
+			goto cleanup;
 
-	// b_0 ^= b_1
-	for (int i = 0; i<4; i++)
-		((uint64_t*) b_0)[i] ^= ((uint64_t*) b_1)[i];
+		for (int j = 0; j < 32 && (i - 1) * 32 + j < out_len; j++)
+			out[(i - 1) * 32 + j] = b_i[j];
+	}
 
-	// b_2 = H( b_0, I2OSP(2,1), dst, I2OSP(dst_len, 1))
-	if (shaSuccess != SHA256Reset (ctx))
-		goto cleanup;
-	if (shaSuccess != SHA256Input (ctx, b_0, 32))
-		goto cleanup;
-	num = 2;
-	if (shaSuccess != SHA256Input (ctx, &num, 1))
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+static int
+expand_message_xof_init (
+	bbs_hash_context *ctx
+	)
+{
+	return bbs_shake256_reset (&ctx->shake256);
+}
+
+
+static int
+expand_message_xof_update (
+	bbs_hash_context *ctx,
+	const uint8_t    *msg,
+	uint64_t          msg_len
+	)
+{
+	return bbs_shake256_input (&ctx->shake256, msg, msg_len);
+}
+
+
+static int
+expand_message_xof_finalize (
+	bbs_hash_context *ctx,
+	uint8_t          *out,
+	uint16_t          out_len,
+	const uint8_t    *dst,
+	uint8_t           dst_len
+	)
+{
+	uint8_t len_be[2] = { out_len >> 8, out_len & 0xff };
+	int     res       = BBS_ERROR;
+
+	// uniform_bytes = H(msg, I2OSP(out_len, 2), dst, I2OSP(dst_len, 1), out_len)
+	if (BBS_OK != bbs_shake256_input (&ctx->shake256, len_be, 2))
 		goto cleanup;
-	if (shaSuccess != SHA256Input (ctx, dst, dst_len))
+	if (BBS_OK != bbs_shake256_input (&ctx->shake256, dst, dst_len))
 		goto cleanup;
-	if (shaSuccess != SHA256Input (ctx, &dst_len, 1))
+	if (BBS_OK != bbs_shake256_input (&ctx->shake256, &dst_len, 1))
 		goto cleanup;
-	if (shaSuccess != SHA256Result (ctx, b_2))
+	if (BBS_OK != bbs_shake256_result (&ctx->shake256, out, out_len))
 		goto cleanup;
 
-	for (int i = 0; i<4; i++)
-		((uint64_t*) out)[i] = ((uint64_t*) b_1)[i];
-	for (int i = 4; i<6; i++)
-		((uint64_t*) out)[i] = ((uint64_t*) b_2)[i - 4];
-
 	res = BBS_OK;
 cleanup:
 	return res;
 }
 
 
+// Magic constants to be used as Domain Separation Tags
+#define BBS_SHA_256_CIPHER_ID         "BBS_BLS12381G1_XMD:SHA-256_SSWU_RO_"
+#define BBS_SHA_256_DEFAULT_KEY_DST   BBS_SHA_256_CIPHER_ID "KEYGEN_DST_"
+#define BBS_SHA_256_API_ID            BBS_SHA_256_CIPHER_ID "H2G_HM2S_"
+#define BBS_SHA_256_SIGNATURE_DST     BBS_SHA_256_API_ID "H2S_"
+#define BBS_SHA_256_CHALLENGE_DST     BBS_SHA_256_API_ID "H2S_"
+#define BBS_SHA_256_MAP_DST           BBS_SHA_256_API_ID "MAP_MSG_TO_SCALAR_AS_HASH_"
+#define BBS_SHAKE_256_CIPHER_ID       "BBS_BLS12381G1_XOF:SHAKE-256_SSWU_RO_"
+#define BBS_SHAKE_256_DEFAULT_KEY_DST BBS_SHAKE_256_CIPHER_ID "KEYGEN_DST_"
+#define BBS_SHAKE_256_API_ID          BBS_SHAKE_256_CIPHER_ID "H2G_HM2S_"
+#define BBS_SHAKE_256_SIGNATURE_DST   BBS_SHAKE_256_API_ID "H2S_"
+#define BBS_SHAKE_256_CHALLENGE_DST   BBS_SHAKE_256_API_ID "H2S_"
+#define BBS_SHAKE_256_MAP_DST         BBS_SHAKE_256_API_ID "MAP_MSG_TO_SCALAR_AS_HASH_"
+// The above collision stems from the ID. Possible oversight? Should not compromise
+// security too much...
+
+// Expands to the pointer and length members of a DST
+#define BBS_DST(dst) (const uint8_t*) dst, LEN (dst) - 1
+
+static const bbs_ciphersuite sha256_ciphersuite = {
+	.p1                      = {
+		0xa8, 0xce, 0x25, 0x61, 0x02, 0x84, 0x08, 0x21, 0xa3, 0xe9, 0x4e, 0xa9, 0x02,
+		0x5e, 0x46, 0x62, 0xb2, 0x05, 0x76, 0x2f, 0x97, 0x76, 0xb3, 0xa7, 0x66, 0xc8,
+		0x72, 0xb9, 0x48, 0xf1, 0xfd, 0x22, 0x5e, 0x7c, 0x59, 0x69, 0x85, 0x88, 0xe7,
+		0x0d, 0x11, 0x40, 0x6d, 0x16, 0x1b, 0x4e, 0x28, 0xc9
+	},
+	BBS_DST (BBS_SHA_256_DEFAULT_KEY_DST),
+	BBS_DST (BBS_SHA_256_API_ID),
+	BBS_DST (BBS_SHA_256_SIGNATURE_DST),
+	BBS_DST (BBS_SHA_256_CHALLENGE_DST),
+	BBS_DST (BBS_SHA_256_MAP_DST),
+	.expand_message_init     = expand_message_xmd_init,
+	.expand_message_update   = expand_message_xmd_update,
+	.expand_message_finalize = expand_message_xmd_finalize,
+};
+
+static const bbs_ciphersuite shake256_ciphersuite = {
+	.p1                      = {
+		0x89, 0x29, 0xdf, 0xbc, 0x7e, 0x66, 0x42, 0xc4, 0xed, 0x9c, 0xba, 0x08, 0x56,
+		0xe4, 0x93, 0xf8, 0xb9, 0xd7, 0xd5, 0xfc, 0xb0, 0xc3, 0x1e, 0xf8, 0xfd, 0xcd,
+		0x34, 0xd5, 0x06, 0x48, 0xa5, 0x6c, 0x79, 0x5e, 0x10, 0x6e, 0x9e, 0xad, 0xa6,
+		0xe0, 0xbd, 0xa3, 0x86, 0xb4, 0x14, 0x15, 0x07, 0x55
+	},
+	BBS_DST (BBS_SHAKE_256_DEFAULT_KEY_DST),
+	BBS_DST (BBS_SHAKE_256_API_ID),
+	BBS_DST (BBS_SHAKE_256_SIGNATURE_DST),
+	BBS_DST (BBS_SHAKE_256_CHALLENGE_DST),
+	BBS_DST (BBS_SHAKE_256_MAP_DST),
+	.expand_message_init     = expand_message_xof_init,
+	.expand_message_update   = expand_message_xof_update,
+	.expand_message_finalize = expand_message_xof_finalize,
+};
+
+const bbs_ciphersuite *const bbs_sha256_ciphersuite   = &sha256_ciphersuite;
+const bbs_ciphersuite *const bbs_shake256_ciphersuite = &shake256_ciphersuite;
+
+
+int
+expand_message_init (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx
+	)
+{
+	return cipher_suite->expand_message_init (ctx);
+}
+
+
+int
+expand_message_update (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx,
+	const uint8_t         *msg,
+	uint64_t               msg_len
+	)
+{
+	return cipher_suite->expand_message_update (ctx, msg, msg_len);
+}
+
+
+int
+expand_message_finalize_len (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx,
+	uint8_t               *out,
+	uint16_t               out_len,
+	const uint8_t         *dst,
+	uint8_t                dst_len
+	)
+{
+	return cipher_suite->expand_message_finalize (ctx, out, out_len, dst, dst_len);
+}
+
+
+int
+expand_message_finalize (
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx,
+	uint8_t                out[48],
+	const uint8_t         *dst,
+	uint8_t                dst_len
+	)
+{
+	return cipher_suite->expand_message_finalize (ctx, out, 48, dst, dst_len);
+}
+
+
 int
 expand_message (
-	uint8_t        out[48],
-	const uint8_t *dst,
-	uint8_t        dst_len,
+	const bbs_ciphersuite *cipher_suite,
+	uint8_t                out[48],
+	const uint8_t         *dst,
+	uint8_t                dst_len,
 	...
 	)
 {
-	va_list       ap;
-	SHA256Context hctx;
-	uint8_t      *msg     = 0;
-	uint32_t      msg_len = 0;
-	int           res     = BBS_ERROR;
+	va_list          ap;
+	bbs_hash_context hctx;
+	uint8_t         *msg     = 0;
+	uint32_t         msg_len = 0;
+	int              res     = BBS_ERROR;
 
-	if (BBS_OK != expand_message_init (&hctx))
+	if (BBS_OK != expand_message_init (cipher_suite, &hctx))
 	{
 		goto cleanup;
 	}
@@ -292,14 +450,14 @@ expand_message (
 	while ((msg = va_arg (ap, uint8_t*)))
 	{
 		msg_len = va_arg (ap, uint32_t);
-		if (BBS_OK != expand_message_update (&hctx, msg, msg_len))
+		if (BBS_OK != expand_message_update (cipher_suite, &hctx, msg, msg_len))
 		{
 			goto cleanup;
 		}
 	}
 	va_end (ap);
 
-	if (BBS_OK != expand_message_finalize (&hctx, out, dst, dst_len))
+	if (BBS_OK != expand_message_finalize (cipher_suite, &hctx, out, dst, dst_len))
 	{
 		goto cleanup;
 	}
@@ -312,43 +470,47 @@ cleanup:
 
 inline int
 hash_to_scalar_init (
-	SHA256Context *ctx
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx
 	)
 {
-	return expand_message_init (ctx);
+	return expand_message_init (cipher_suite, ctx);
 }
 
 
 inline int
 hash_to_scalar_update (
-	SHA256Context *ctx,
-	const uint8_t *msg,
-	uint32_t       msg_len
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx,
+	const uint8_t         *msg,
+	uint64_t               msg_len
 	)
 {
-	return expand_message_update (ctx, msg, msg_len);
+	return expand_message_update (cipher_suite, ctx, msg, msg_len);
 }
 
 
 inline int
 hash_to_scalar_finalize (
-	SHA256Context *ctx,
-	bn_t           out,
-	const uint8_t *dst,
-	uint8_t        dst_len
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx,
+	bn_t                   out,
+	const uint8_t         *dst,
+	uint8_t                dst_len
 	)
 {
 	uint8_t buffer[48];
+	sc_t    scalar;
 	int     res = BBS_ERROR;
 
-	if (BBS_OK != expand_message_finalize (ctx, buffer, dst, dst_len))
+	if (BBS_OK != expand_message_finalize (cipher_suite, ctx, buffer, dst, dst_len))
 	{
 		goto cleanup;
 	}
 
+	sc_read_wide (scalar, buffer);
 	RLC_TRY {
-		bn_read_bin (out, buffer, 48);
-		bn_mod (out, out, &(core_get ()->ep_r));
+		sc_write_bn (out, scalar);
 	}
 	RLC_CATCH_ANY {
 		goto cleanup;
@@ -362,19 +524,20 @@ cleanup:
 
 int
 hash_to_scalar (
-	bn_t           out,
-	const uint8_t *dst,
-	uint8_t        dst_len,
+	const bbs_ciphersuite *cipher_suite,
+	bn_t                   out,
+	const uint8_t         *dst,
+	uint8_t                dst_len,
 	...
 	)
 {
-	va_list       ap;
-	SHA256Context hctx;
-	uint8_t      *msg     = 0;
-	uint32_t      msg_len = 0;
-	int           res     = BBS_ERROR;
+	va_list          ap;
+	bbs_hash_context hctx;
+	uint8_t         *msg     = 0;
+	uint32_t         msg_len = 0;
+	int              res     = BBS_ERROR;
 
-	if (BBS_OK != hash_to_scalar_init (&hctx))
+	if (BBS_OK != hash_to_scalar_init (cipher_suite, &hctx))
 	{
 		goto cleanup;
 	}
@@ -383,18 +546,286 @@ hash_to_scalar (
 	while ((msg = va_arg (ap, uint8_t*)))
 	{
 		msg_len = va_arg (ap, uint32_t);
-		if (BBS_OK != hash_to_scalar_update (&hctx, msg, msg_len))
+		if (BBS_OK != hash_to_scalar_update (cipher_suite, &hctx, msg, msg_len))
 		{
 			goto cleanup;
 		}
 	}
 	va_end (ap);
 
-	if (BBS_OK != hash_to_scalar_finalize (&hctx, out, dst, dst_len))
+	if (BBS_OK != hash_to_scalar_finalize (cipher_suite, &hctx, out, dst, dst_len))
+	{
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+hash_to_scalar_fixed_init (
+	const bbs_ciphersuite    *cipher_suite,
+	hash_to_scalar_fixed_dst *fdst,
+	const uint8_t            *dst,
+	uint8_t                   dst_len
+	)
+{
+	uint64_t bit_len = (32 + 1 + dst_len + 1) * 8;
+	int      res     = BBS_ERROR;
+
+	fdst->cipher_suite = cipher_suite;
+	fdst->dst          = dst;
+	fdst->dst_len      = dst_len;
+	fdst->b_i_blocks   = 0;
+
+	// Only expand_message_xmd has a fast path. We mark the others by an
+	// empty template.
+	if (cipher_suite->expand_message_init != expand_message_xmd_init)
+	{
+		res = BBS_OK;
+		goto cleanup;
+	}
+	if (dst_len > 85)
+		goto cleanup;
+
+	// b_i = H(chain, I2OSP(i, 1), dst, I2OSP(dst_len, 1)) with SHA-256
+	// padding. Only chain and i change between calls.
+	fdst->b_i_blocks = (32 + 1 + dst_len + 1 + 9 + 63) / 64;
+	memset (fdst->b_i_tmpl, 0, sizeof(fdst->b_i_tmpl));
+	memcpy (fdst->b_i_tmpl + 33, dst, dst_len);
+	fdst->b_i_tmpl[33 + dst_len] = dst_len;
+	fdst->b_i_tmpl[34 + dst_len] = 0x80;
+	for (int i = 0; i < 8; i++)
+		fdst->b_i_tmpl[64 * fdst->b_i_blocks - 1 - i] = bit_len >> (8 * i);
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+// Expands up to BBS_SHA256_MAX_LANES messages under a fixed DST. Messages on
+// the fast path are laid out in fixed buffers and compressed side by side,
+// longer ones go through expand_message.
+static int
+hash_to_scalar_fixed_expand (
+	const hash_to_scalar_fixed_dst *fdst,
+	uint8_t                         uniform[][48],
+	const uint8_t *const            msgs[],
+	const uint64_t                  msg_lens[],
+	uint64_t                        num
+	)
+{
+	uint8_t          blocks[BBS_SHA256_MAX_LANES][128];
+	uint8_t          b_0[BBS_SHA256_MAX_LANES][32];
+	uint8_t          b_i[32];
+	uint32_t         state[BBS_SHA256_MAX_LANES][8];
+	const uint8_t   *lane_blocks[BBS_SHA256_MAX_LANES];
+	uint64_t         lane_msg[BBS_SHA256_MAX_LANES];
+	uint64_t         num_lanes, data_len, bit_len, i;
+	bbs_hash_context hctx;
+	int              res = BBS_ERROR;
+
+	if (num > BBS_SHA256_MAX_LANES)
+		goto cleanup;
+
+	// No fast path, expand the messages one by one
+	if (0 == fdst->b_i_blocks)
 	{
+		for (i = 0; i < num; i++)
+		{
+			if (BBS_OK != expand_message_init (fdst->cipher_suite, &hctx))
+				goto cleanup;
+			if (BBS_OK != expand_message_update (fdst->cipher_suite, &hctx, msgs[i],
+							     msg_lens[i]))
+				goto cleanup;
+			if (BBS_OK != expand_message_finalize (fdst->cipher_suite, &hctx, uniform[i],
+							       fdst->dst, fdst->dst_len))
+				goto cleanup;
+		}
+		res = BBS_OK;
 		goto cleanup;
 	}
 
+	// b_0 input after Z_pad: msg || I2OSP(48, 2) || I2OSP(0, 1) || dst ||
+	// I2OSP(dst_len, 1), plus at least 9 bytes of padding. Depending on the
+	// message length, this takes one or two blocks, and messages with the
+	// same block count are compressed together.
+	for (uint64_t num_blocks = 1; num_blocks <= 2; num_blocks++)
+	{
+		num_lanes = 0;
+		for (i = 0; i < num; i++)
+		{
+			data_len = (uint64_t) msg_lens[i] + 3 + fdst->dst_len + 1;
+			if ((data_len + 9 + 63) / 64 != num_blocks)
+				continue;
+
+			bit_len = (64 + data_len) * 8;
+			memset (blocks[i], 0, 64 * num_blocks);
+			memcpy (blocks[i], msgs[i], msg_lens[i]);
+			blocks[i][msg_lens[i] + 1] = 48;
+			memcpy (blocks[i] + msg_lens[i] + 3, fdst->dst, fdst->dst_len);
+			blocks[i][data_len - 1] = fdst->dst_len;
+			blocks[i][data_len]     = 0x80;
+			for (int j = 0; j < 8; j++)
+				blocks[i][64 * num_blocks - 1 - j] = bit_len >> (8 * j);
+
+			memcpy (state[num_lanes], expand_message_zpad_ctx.Intermediate_Hash, 32);
+			lane_blocks[num_lanes] = blocks[i];
+			lane_msg[num_lanes++]  = i;
+		}
+		bbs_sha256_compress_mb (state, lane_blocks, num_blocks, num_lanes);
+		for (uint64_t l = 0; l < num_lanes; l++)
+			bbs_sha256_digest (b_0[lane_msg[l]], state[l]);
+	}
+
+	// b_1 = H(b_0, I2OSP(1, 1), dst, I2OSP(dst_len, 1))
+	num_lanes = 0;
+	for (i = 0; i < num; i++)
+	{
+		data_len = (uint64_t) msg_lens[i] + 3 + fdst->dst_len + 1;
+		if (data_len + 9 > sizeof(blocks[i]))
+		{
+			if (BBS_OK != expand_message_init (fdst->cipher_suite, &hctx))
+				goto cleanup;
+			if (BBS_OK != expand_message_update (fdst->cipher_suite, &hctx, msgs[i],
+							     msg_lens[i]))
+				goto cleanup;
+			if (BBS_OK != expand_message_finalize (fdst->cipher_suite, &hctx, uniform[i],
+							       fdst->dst, fdst->dst_len))
+				goto cleanup;
+			continue;
+		}
+
+		memcpy (blocks[i], fdst->b_i_tmpl, 64 * fdst->b_i_blocks);
+		memcpy (blocks[i], b_0[i], 32);
+		blocks[i][32] = 1;
+		memcpy (state[num_lanes], bbs_sha256_iv, 32);
+		lane_blocks[num_lanes] = blocks[i];
+		lane_msg[num_lanes++]  = i;
+	}
+	bbs_sha256_compress_mb (state, lane_blocks, fdst->b_i_blocks, num_lanes);
+
+	// b_2 = H(b_0 ^ b_1, I2OSP(2, 1), dst, I2OSP(dst_len, 1))
+	for (uint64_t l = 0; l < num_lanes; l++)
+	{
+		i = lane_msg[l];
+		bbs_sha256_digest (b_i, state[l]);
+		memcpy (uniform[i], b_i, 32);
+		for (int j = 0; j < 32; j++)
+			blocks[i][j] = b_0[i][j] ^ b_i[j];
+		blocks[i][32] = 2;
+		memcpy (state[l], bbs_sha256_iv, 32);
+	}
+	bbs_sha256_compress_mb (state, lane_blocks, fdst->b_i_blocks, num_lanes);
+	for (uint64_t l = 0; l < num_lanes; l++)
+	{
+		bbs_sha256_digest (b_i, state[l]);
+		memcpy (uniform[lane_msg[l]] + 32, b_i, 16);
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+hash_to_scalar_fixed (
+	const hash_to_scalar_fixed_dst *fdst,
+	bn_t                            out,
+	const uint8_t                  *msg,
+	uint64_t                        msg_len
+	)
+{
+	uint8_t uniform[1][48];
+	sc_t    scalar;
+	int     res = BBS_ERROR;
+
+	if (BBS_OK != hash_to_scalar_fixed_expand (fdst, uniform, &msg, &msg_len, 1))
+	{
+		goto cleanup;
+	}
+
+	sc_read_wide (scalar, uniform[0]);
+	RLC_TRY {
+		sc_write_bn (out, scalar);
+	}
+	RLC_CATCH_ANY {
+		goto cleanup;
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+hash_to_scalar_batch_expand (
+	const hash_to_scalar_fixed_dst *fdst,
+	uint8_t                         uniform[][48],
+	const uint8_t *const           *msgs,
+	const uint64_t                 *msg_lens,
+	uint64_t                        num
+	)
+{
+	uint64_t chunk_len;
+	int      res = BBS_ERROR;
+
+	for (uint64_t i = 0; i < num; i += chunk_len)
+	{
+		chunk_len = num - i < BBS_SHA256_MAX_LANES ? num - i : BBS_SHA256_MAX_LANES;
+		if (BBS_OK != hash_to_scalar_fixed_expand (fdst, uniform + i, msgs + i, msg_lens + i,
+							   chunk_len))
+		{
+			goto cleanup;
+		}
+	}
+
+	res = BBS_OK;
+cleanup:
+	return res;
+}
+
+
+int
+hash_to_scalar_batch (
+	const hash_to_scalar_fixed_dst *fdst,
+	bn_t                           *out,
+	const uint8_t *const           *msgs,
+	const uint64_t                 *msg_lens,
+	uint64_t                        num
+	)
+{
+	uint8_t  uniform[BBS_SHA256_MAX_LANES][48];
+	uint64_t chunk_len;
+	sc_t     scalar;
+	int      res = BBS_ERROR;
+
+	for (uint64_t i = 0; i < num; i += chunk_len)
+	{
+		chunk_len = num - i < BBS_SHA256_MAX_LANES ? num - i : BBS_SHA256_MAX_LANES;
+		if (BBS_OK != hash_to_scalar_fixed_expand (fdst, uniform, msgs + i, msg_lens + i,
+							   chunk_len))
+		{
+			goto cleanup;
+		}
+
+		RLC_TRY {
+			for (uint64_t j = 0; j < chunk_len; j++)
+			{
+				sc_read_wide (scalar, uniform[j]);
+				sc_write_bn (out[i + j], scalar);
+			}
+		}
+		RLC_CATCH_ANY {
+			goto cleanup;
+		}
+	}
+
 	res = BBS_OK;
 cleanup:
 	return res;
@@ -403,25 +834,26 @@ cleanup:
 
 int
 calculate_domain_init (
-	SHA256Context *ctx,
-	const uint8_t  pk[BBS_PK_LEN],
-	uint64_t       num_messages
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx,
+	const uint8_t          pk[BBS_PK_LEN],
+	uint64_t               num_messages
 	)
 {
 	uint64_t num_messages_be = UINT64_H2BE (num_messages);
 	int      res             = BBS_ERROR;
 
-	if (BBS_OK != hash_to_scalar_init (ctx))
+	if (BBS_OK != hash_to_scalar_init (cipher_suite, ctx))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != hash_to_scalar_update (ctx, pk, BBS_PK_LEN))
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ctx, pk, BBS_PK_LEN))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != hash_to_scalar_update (ctx, (uint8_t*) &num_messages_be, 8))
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ctx, (uint8_t*) &num_messages_be, 8))
 	{
 		goto cleanup;
 	}
@@ -434,8 +866,9 @@ cleanup:
 
 int
 calculate_domain_update (
-	SHA256Context *ctx,
-	const ep_t     generator
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx,
+	const ep_t             generator
 	)
 {
 	int     res = BBS_ERROR;
@@ -448,7 +881,7 @@ calculate_domain_update (
 		goto cleanup;
 	}
 
-	if (BBS_OK != hash_to_scalar_update (ctx, buffer, BBS_G1_ELEM_LEN))
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ctx, buffer, BBS_G1_ELEM_LEN))
 	{
 		goto cleanup;
 	}
@@ -461,17 +894,18 @@ cleanup:
 
 int
 calculate_domain_finalize (
-	SHA256Context *ctx,
-	bn_t           out,
-	const uint8_t *header,
-	uint64_t       header_len,
-	const uint8_t *api_id,
-	uint8_t        api_id_len
+	const bbs_ciphersuite *cipher_suite,
+	bbs_hash_context      *ctx,
+	bn_t                   out,
+	const uint8_t         *header,
+	uint64_t               header_len
 	)
 {
-	int      res           = BBS_ERROR;
-	uint8_t  domain_dst[256];
-	uint64_t header_len_be = UINT64_H2BE (header_len);
+	const uint8_t *api_id        = cipher_suite->api_id;
+	uint8_t        api_id_len    = cipher_suite->api_id_len;
+	int            res           = BBS_ERROR;
+	uint8_t        domain_dst[256];
+	uint64_t       header_len_be = UINT64_H2BE (header_len);
 
 	if (api_id_len > 251)
 	{
@@ -483,22 +917,22 @@ calculate_domain_finalize (
 	for (int i = 0; i < 4; i++)
 		domain_dst[i + api_id_len] = "H2S_"[i];
 
-	if (BBS_OK != hash_to_scalar_update (ctx, api_id, api_id_len))
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ctx, api_id, api_id_len))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != hash_to_scalar_update (ctx, (uint8_t*) &header_len_be, 8))
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ctx, (uint8_t*) &header_len_be, 8))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != hash_to_scalar_update (ctx, header, header_len))
+	if (BBS_OK != hash_to_scalar_update (cipher_suite, ctx, header, header_len))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != hash_to_scalar_finalize (ctx, out, domain_dst, api_id_len + 4))
+	if (BBS_OK != hash_to_scalar_finalize (cipher_suite, ctx, out, domain_dst, api_id_len + 4))
 	{
 		goto cleanup;
 	}
@@ -511,38 +945,36 @@ cleanup:
 
 int
 calculate_domain (
-	bn_t           out,
-	const uint8_t  pk[BBS_PK_LEN],
-	uint64_t       num_messages,
-	const uint8_t *header,
-	uint64_t       header_len,
-	const uint8_t *api_id,
-	uint8_t        api_id_len,
+	const bbs_ciphersuite *cipher_suite,
+	bn_t                   out,
+	const uint8_t          pk[BBS_PK_LEN],
+	uint64_t               num_messages,
+	const uint8_t         *header,
+	uint64_t               header_len,
 	...
 	)
 {
-	va_list       ap;
-	SHA256Context hctx;
-	ep_t         *generator;
-	int           res = BBS_ERROR;
+	va_list          ap;
+	bbs_hash_context hctx;
+	ep_t            *generator;
+	int              res = BBS_ERROR;
 
-	if (BBS_OK != calculate_domain_init (&hctx, pk, num_messages))
+	if (BBS_OK != calculate_domain_init (cipher_suite, &hctx, pk, num_messages))
 	{
 		goto cleanup;
 	}
 
-	va_start (ap, api_id_len);
+	va_start (ap, header_len);
 	while ((generator = va_arg (ap, ep_t*)))
 	{
-		if (BBS_OK != calculate_domain_update (&hctx, *generator))
+		if (BBS_OK != calculate_domain_update (cipher_suite, &hctx, *generator))
 		{
 			goto cleanup;
 		}
 	}
 	va_end (ap);
 
-	if (BBS_OK != calculate_domain_finalize (&hctx, out, header, header_len, api_id,
-						 api_id_len))
+	if (BBS_OK != calculate_domain_finalize (cipher_suite, &hctx, out, header, header_len))
 	{
 		goto cleanup;
 	}
@@ -555,14 +987,15 @@ cleanup:
 
 int
 create_generator_init (
-	uint8_t        state[48 + 8],
-	const uint8_t *api_id,
-	uint8_t        api_id_len
+	const bbs_ciphersuite *cipher_suite,
+	uint8_t                state[48 + 8]
 	)
 {
-	uint8_t       buffer[256];
-	SHA256Context hctx;
-	int           res = BBS_ERROR;
+	const uint8_t   *api_id     = cipher_suite->api_id;
+	uint8_t          api_id_len = cipher_suite->api_id_len;
+	uint8_t          buffer[256];
+	bbs_hash_context hctx;
+	int              res = BBS_ERROR;
 
 	if (api_id_len > 255 - 19)
 	{
@@ -574,22 +1007,23 @@ create_generator_init (
 	for (int i = 0; i < 19; i++)
 		buffer[i + api_id_len] = "SIG_GENERATOR_SEED_"[i];
 
-	if (BBS_OK != expand_message_init (&hctx))
+	if (BBS_OK != expand_message_init (cipher_suite, &hctx))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != expand_message_update (&hctx, api_id, api_id_len))
+	if (BBS_OK != expand_message_update (cipher_suite, &hctx, api_id, api_id_len))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != expand_message_update (&hctx, (uint8_t*) "MESSAGE_GENERATOR_SEED", 22))
+	if (BBS_OK != expand_message_update (cipher_suite, &hctx,
+					     (uint8_t*) "MESSAGE_GENERATOR_SEED", 22))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != expand_message_finalize (&hctx, state, buffer, api_id_len + 19))
+	if (BBS_OK != expand_message_finalize (cipher_suite, &hctx, state, buffer, api_id_len + 19))
 	{
 		goto cleanup;
 	}
@@ -695,17 +1129,18 @@ ep_map_from_field (ep_t p,
 
 int
 create_generator_next (
-	uint8_t        state[48 + 8],
-	ep_t           generator,
-	const uint8_t *api_id,
-	uint8_t        api_id_len
+	const bbs_ciphersuite *cipher_suite,
+	uint8_t                state[48 + 8],
+	ep_t                   generator
 	)
 {
-	uint8_t       dst_buf[256];
-	uint8_t       rand_buf[128];
-	SHA256Context hctx;
-	uint64_t      i_be = UINT64_H2BE (*((uint64_t*) (state + 48)));
-	int           res  = BBS_ERROR;
+	const uint8_t   *api_id     = cipher_suite->api_id;
+	uint8_t          api_id_len = cipher_suite->api_id_len;
+	uint8_t          dst_buf[256];
+	uint8_t          rand_buf[128];
+	bbs_hash_context hctx;
+	uint64_t         i_be = UINT64_H2BE (*((uint64_t*) (state + 48)));
+	int              res  = BBS_ERROR;
 
 	if (api_id_len > 255 - 19)
 	{
@@ -719,22 +1154,23 @@ create_generator_next (
 	for (int i = 0; i < 19; i++)
 		dst_buf[i + api_id_len] = "SIG_GENERATOR_SEED_"[i];
 
-	if (BBS_OK != expand_message_init (&hctx))
+	if (BBS_OK != expand_message_init (cipher_suite, &hctx))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != expand_message_update (&hctx, state, 48))
+	if (BBS_OK != expand_message_update (cipher_suite, &hctx, state, 48))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != expand_message_update (&hctx, (uint8_t*) &i_be, 8))
+	if (BBS_OK != expand_message_update (cipher_suite, &hctx, (uint8_t*) &i_be, 8))
 	{
 		goto cleanup;
 	}
 
-	if (BBS_OK != expand_message_finalize (&hctx, state, dst_buf, api_id_len + 19))
+	if (BBS_OK != expand_message_finalize (cipher_suite, &hctx, state, dst_buf, api_id_len
+					       + 19))
 	{
 		goto cleanup;
 	}
@@ -743,10 +1179,27 @@ create_generator_next (
 		dst_buf[i + api_id_len] = "SIG_GENERATOR_DST_"[i];
 
 	// Hash to curve g1
-	// relic does implement this as ep_map_sswum, but hard-codes the dst, so
-	// we need to reimplement the high level parts here
+	// relic does implement this as ep_map_sswum, but hard-codes the dst and
+	// expand_message_xmd, so we need to reimplement the high level parts
+	// here. This also lets us start from the precomputed Z_pad state instead
+	// of using md_xmd.
+	if (BBS_OK != expand_message_init (cipher_suite, &hctx))
+	{
+		goto cleanup;
+	}
+
+	if (BBS_OK != expand_message_update (cipher_suite, &hctx, state, 48))
+	{
+		goto cleanup;
+	}
+
+	if (BBS_OK != expand_message_finalize_len (cipher_suite, &hctx, rand_buf, 128, dst_buf,
+						   api_id_len + 18))
+	{
+		goto cleanup;
+	}
+
 	RLC_TRY {
-		md_xmd (rand_buf, 128, state, 48, dst_buf, api_id_len + 18);
 		ep_map_from_field (generator, rand_buf, 128, ep_map_sswu);
 	}
 	RLC_CATCH_ANY {
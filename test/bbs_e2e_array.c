@@ -0,0 +1,324 @@
+#include "test_util.h"
+#include <string.h>
+#include <sys/mman.h>
+
+#define MSGS(m) \
+	m[0], 1, m[1], 16, m[2], 32, m[3], 48, m[4], 64, m[5], 80, m[6], 96, m[7], 112, \
+	m[8], 128, m[9], 1000, m[10], 0, m[11], 7, m[12], 33, m[13], 77, m[14], 150, \
+	m[15], 200, m[16], 3, m[17], 64, m[18], 65, m[19], 66
+
+#define SCALARS(s) \
+	s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], s[8], s[9], s[10], s[11], s[12], \
+	s[13], s[14], s[15], s[16], s[17], s[18], s[19]
+
+// Streamed proofs go to and come from a plain buffer
+static int proof_write(void *cookie, uint64_t offset, const uint8_t *data, uint64_t len) {
+	memcpy((uint8_t*)cookie + offset, data, len);
+	return BBS_OK;
+}
+
+static int proof_read(void *cookie, uint64_t offset, uint8_t *data, uint64_t len) {
+	memcpy(data, (uint8_t*)cookie + offset, len);
+	return BBS_OK;
+}
+
+// The streamed counterpart of a long message of zeros
+static const uint8_t zeros[1 << 20];
+
+static int next_zero_chunk(void *cookie, const uint8_t **chunk, uint64_t *chunk_len) {
+	uint64_t *remaining = cookie;
+
+	*chunk      = zeros;
+	*chunk_len  = *remaining < sizeof(zeros) ? *remaining : sizeof(zeros);
+	*remaining -= *chunk_len;
+	return BBS_OK;
+}
+
+int bbs_e2e_array() {
+	if (core_init() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+	if (pc_param_set_any() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+
+	static uint8_t msgs[20][1000];
+	static char header[] = "A header for array messages";
+	static char ph[] = "A presentation header for array messages";
+	const bbs_ciphersuite *cipher_suites[] = {bbs_sha256_ciphersuite, bbs_shake256_ciphersuite};
+	static const char *names[] = {"SHA-256", "SHAKE-256"};
+	const uint8_t *msg_ptrs[LEN(msgs)];
+	size_t msg_lens[LEN(msgs)] = {1, 16, 32, 48, 64, 80, 96, 112, 128, 1000, 0, 7, 33, 77, 150,
+		200, 3, 64, 65, 66};
+	uint64_t disclosed_indexes[] = {0, 9, 10, 19};
+	const uint8_t *disclosed_ptrs[LEN(disclosed_indexes)];
+	size_t disclosed_lens[LEN(disclosed_indexes)];
+
+	for(int i = 0; i < LEN(msgs); i++) {
+		for(int j = 0; j < sizeof(msgs[i]); j++) {
+			msgs[i][j] = i * 17 + j;
+		}
+		msg_ptrs[i] = msgs[i];
+	}
+	for(int i = 0; i < LEN(disclosed_indexes); i++) {
+		disclosed_ptrs[i] = msg_ptrs[disclosed_indexes[i]];
+		disclosed_lens[i] = msg_lens[disclosed_indexes[i]];
+	}
+	bbs_messages array = {.msgs = msg_ptrs, .msg_lens = msg_lens};
+	bbs_messages disclosed = {.msgs = disclosed_ptrs, .msg_lens = disclosed_lens};
+	bbs_messages last = {.msgs = &msg_ptrs[19], .msg_lens = &msg_lens[19]};
+
+	for(int s = 0; s < LEN(cipher_suites); s++) {
+		const bbs_ciphersuite *cs = cipher_suites[s];
+		printf("Ciphersuite %s\n", names[s]);
+
+		uint8_t ref[LEN(msgs) * BBS_SCALAR_LEN], scalars[LEN(msgs) * BBS_SCALAR_LEN];
+		const uint8_t *scalar_ptrs[LEN(msgs)], *disclosed_scalar_ptrs[LEN(disclosed_indexes)];
+		bbs_messages array_scalars = {.msg_scalars = scalar_ptrs};
+		bbs_messages disclosed_scalars = {.msg_scalars = disclosed_scalar_ptrs};
+		bbs_messages last_scalar = {.msg_scalars = &scalar_ptrs[19]};
+		bbs_secret_key sk;
+		bbs_public_key pk;
+		bbs_signature ref_sig, sig;
+		uint8_t proof[BBS_PROOF_LEN(LEN(msgs) - LEN(disclosed_indexes))];
+
+		if(BBS_OK != bbs_keygen_full(cs, sk, pk)) {
+			puts("Error during key generation");
+			return 1;
+		}
+
+		// The arrays have to agree with the varargs, with and without
+		// parallel mapping
+		if(BBS_OK != bbs_messages_to_scalars(cs, ref, LEN(msgs), MSGS(msgs))) {
+			puts("Error during message mapping");
+			return 1;
+		}
+		uint32_t threads[] = {1, 4};
+		for(int t = 0; t < LEN(threads); t++) {
+			if(BBS_OK != bbs_set_parallel_mapping(threads[t], 1)) {
+				continue;
+			}
+			if(BBS_OK != bbs_messages_to_scalars_array(cs, scalars, LEN(msgs), &array)) {
+				puts("Error during array message mapping");
+				return 1;
+			}
+			ASSERT_EQ("array message mapping", scalars, ref);
+		}
+		bbs_set_parallel_mapping(1, 0);
+		for(int i = 0; i < LEN(msgs); i++) {
+			scalar_ptrs[i] = ref + i * BBS_SCALAR_LEN;
+		}
+
+		// Signing is deterministic
+		if(BBS_OK != bbs_sign(cs, sk, pk, ref_sig, (uint8_t*)header, strlen(header), LEN(msgs),
+				      MSGS(msgs))) {
+			puts("Error during signing");
+			return 1;
+		}
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_sign_array(cs, sk, pk, sig, (uint8_t*)header, strlen(header), LEN(msgs),
+					    &array)) {
+			puts("Error during array signing");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_sign_array (20 messages)")
+		ASSERT_EQ("array signature", sig, ref_sig);
+		if(BBS_OK != bbs_sign_array(cs, sk, pk, sig, (uint8_t*)header, strlen(header), LEN(msgs),
+					    &array_scalars)) {
+			puts("Error during array signing of scalars");
+			return 1;
+		}
+		ASSERT_EQ("array signature of scalars", sig, ref_sig);
+
+		if(BBS_OK != bbs_verify_array(cs, pk, sig, (uint8_t*)header, strlen(header), LEN(msgs),
+					      &array)) {
+			puts("Error during array signature verification");
+			return 1;
+		}
+		if(BBS_OK != bbs_verify_array(cs, pk, sig, (uint8_t*)header, strlen(header), LEN(msgs),
+					      &array_scalars)) {
+			puts("Error during array signature verification of scalars");
+			return 1;
+		}
+		msgs[5][0] ^= 1;
+		if(BBS_OK == bbs_verify_array(cs, pk, sig, (uint8_t*)header, strlen(header), LEN(msgs),
+					      &array)) {
+			puts("Array signature verification accepted a modified message");
+			return 1;
+		}
+		msgs[5][0] ^= 1;
+
+		// Proofs are randomized, so check them against the other interface
+		if(BBS_OK != bbs_proof_gen_array(cs, pk, sig, proof, (uint8_t*)header, strlen(header),
+					         (uint8_t*)ph, strlen(ph), disclosed_indexes,
+					         LEN(disclosed_indexes), LEN(msgs), &array)) {
+			puts("Error during array proof generation");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_verify(cs, pk, proof, sizeof(proof), (uint8_t*)header,
+					      strlen(header), (uint8_t*)ph, strlen(ph), disclosed_indexes,
+					      LEN(disclosed_indexes), LEN(msgs), msgs[0], 1, msgs[9], 1000,
+					      msgs[10], 0, msgs[19], 66)) {
+			puts("Error during verification of an array proof");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_verify_array(cs, pk, proof, sizeof(proof), (uint8_t*)header,
+						    strlen(header), (uint8_t*)ph, strlen(ph),
+						    disclosed_indexes, LEN(disclosed_indexes), LEN(msgs),
+						    &disclosed)) {
+			puts("Error during array proof verification");
+			return 1;
+		}
+
+		if(BBS_OK != bbs_proof_gen_array(cs, pk, sig, proof, (uint8_t*)header, strlen(header),
+					         (uint8_t*)ph, strlen(ph), disclosed_indexes,
+					         LEN(disclosed_indexes), LEN(msgs), &array_scalars)) {
+			puts("Error during array proof generation of scalars");
+			return 1;
+		}
+		for(int i = 0; i < LEN(disclosed_indexes); i++) {
+			disclosed_scalar_ptrs[i] = scalar_ptrs[disclosed_indexes[i]];
+		}
+		if(BBS_OK != bbs_proof_verify_array(cs, pk, proof, sizeof(proof), (uint8_t*)header,
+						    strlen(header), (uint8_t*)ph, strlen(ph),
+						    disclosed_indexes, LEN(disclosed_indexes), LEN(msgs),
+						    &disclosed_scalars)) {
+			puts("Error during array proof verification of scalars");
+			return 1;
+		}
+
+		// Streamed proofs are regular proofs. With a single disclosed
+		// message, the undisclosed ones take more than one part.
+		uint64_t stream_disclosed[] = {19};
+		uint8_t stream_proof[BBS_PROOF_LEN(LEN(msgs) - LEN(stream_disclosed))];
+		if(BBS_OK != bbs_proof_gen_stream(cs, pk, sig, proof_write, stream_proof,
+						  (uint8_t*)header, strlen(header), (uint8_t*)ph,
+						  strlen(ph), stream_disclosed, LEN(stream_disclosed),
+						  LEN(msgs), &array)) {
+			puts("Error during streamed proof generation");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_verify_array(cs, pk, stream_proof, sizeof(stream_proof),
+						    (uint8_t*)header, strlen(header), (uint8_t*)ph,
+						    strlen(ph), stream_disclosed, LEN(stream_disclosed),
+						    LEN(msgs), &last)) {
+			puts("Error during verification of a streamed proof");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_verify_stream(cs, pk, proof_read, stream_proof,
+						     sizeof(stream_proof), (uint8_t*)header,
+						     strlen(header), (uint8_t*)ph, strlen(ph),
+						     stream_disclosed, LEN(stream_disclosed), LEN(msgs),
+						     &last)) {
+			puts("Error during streamed proof verification");
+			return 1;
+		}
+		stream_proof[sizeof(stream_proof) - 2 * BBS_SCALAR_LEN] ^= 1;
+		if(BBS_OK == bbs_proof_verify_stream(cs, pk, proof_read, stream_proof,
+						     sizeof(stream_proof), (uint8_t*)header,
+						     strlen(header), (uint8_t*)ph, strlen(ph),
+						     stream_disclosed, LEN(stream_disclosed), LEN(msgs),
+						     &last)) {
+			puts("Streamed proof verification accepted a modified proof");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_gen_stream(cs, pk, sig, proof_write, stream_proof,
+						  (uint8_t*)header, strlen(header), (uint8_t*)ph,
+						  strlen(ph), stream_disclosed, LEN(stream_disclosed),
+						  LEN(msgs), &array_scalars)) {
+			puts("Error during streamed proof generation of scalars");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_verify_stream(cs, pk, proof_read, stream_proof,
+						     sizeof(stream_proof), (uint8_t*)header,
+						     strlen(header), (uint8_t*)ph, strlen(ph),
+						     stream_disclosed, LEN(stream_disclosed), LEN(msgs),
+						     &last_scalar)) {
+			puts("Error during streamed proof verification of scalars");
+			return 1;
+		}
+
+		// The regular proof streams as well
+		if(BBS_OK != bbs_proof_verify_stream(cs, pk, proof_read, proof, sizeof(proof),
+						     (uint8_t*)header, strlen(header), (uint8_t*)ph,
+						     strlen(ph), disclosed_indexes,
+						     LEN(disclosed_indexes), LEN(msgs), &disclosed)) {
+			puts("Error during streamed verification of an array proof");
+			return 1;
+		}
+
+		// Streaming takes nothing from a scratch arena, even with parallel
+		// mapping on, and maps the disclosed messages again for the
+		// challenge, which regular verification has to agree with
+		static uint8_t arena[1];
+		bbs_set_parallel_mapping(4, 1);
+		bbs_set_scratch(arena, 0);
+		if(BBS_OK != bbs_proof_gen_stream(cs, pk, sig, proof_write, proof, (uint8_t*)header,
+						  strlen(header), (uint8_t*)ph, strlen(ph),
+						  disclosed_indexes, LEN(disclosed_indexes), LEN(msgs),
+						  &array)) {
+			puts("Error during streamed proof generation without scratch");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_verify_stream(cs, pk, proof_read, proof, sizeof(proof),
+						     (uint8_t*)header, strlen(header), (uint8_t*)ph,
+						     strlen(ph), disclosed_indexes,
+						     LEN(disclosed_indexes), LEN(msgs), &disclosed)) {
+			puts("Error during streamed proof verification without scratch");
+			return 1;
+		}
+		bbs_set_scratch(NULL, 0);
+		bbs_set_parallel_mapping(1, 0);
+		if(BBS_OK != bbs_proof_verify_array(cs, pk, proof, sizeof(proof), (uint8_t*)header,
+						    strlen(header), (uint8_t*)ph, strlen(ph),
+						    disclosed_indexes, LEN(disclosed_indexes), LEN(msgs),
+						    &disclosed)) {
+			puts("Error during verification of a streamed proof without scratch");
+			return 1;
+		}
+
+		// Lengths beyond the uint32_t of the varargs are hashed
+		// incrementally, to the scalar of the streamed message. The long
+		// message is a mapping of zero pages. Hashing it takes seconds, so
+		// this runs for SHA-256 only.
+		if(SIZE_MAX > UINT32_MAX && cs == bbs_sha256_ciphersuite) {
+			uint64_t long_len = (uint64_t)UINT32_MAX + 1, remaining = long_len;
+			uint8_t *long_msg = mmap(NULL, long_len, PROT_READ,
+						 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			if(MAP_FAILED == long_msg) {
+				puts("No address space for a long message");
+			} else {
+				const uint8_t *long_ptrs[LEN(msgs)];
+				size_t long_lens[LEN(msgs)];
+				uint8_t long_scalar[BBS_SCALAR_LEN];
+				memcpy(long_ptrs, msg_ptrs, sizeof(long_ptrs));
+				memcpy(long_lens, msg_lens, sizeof(long_lens));
+				long_ptrs[3] = long_msg;
+				long_lens[3] = long_len;
+				bbs_messages long_array = {.msgs = long_ptrs, .msg_lens = long_lens};
+				int mapped = BBS_OK == bbs_messages_to_scalars_array(cs, scalars, LEN(msgs),
+										     &long_array);
+				munmap(long_msg, long_len);
+				if(! mapped) {
+					puts("Error during mapping of a long array message");
+					return 1;
+				}
+				if(BBS_OK != bbs_message_to_scalar_stream(cs, long_scalar, next_zero_chunk,
+									  &remaining)) {
+					puts("Error during mapping of a long streamed message");
+					return 1;
+				}
+				ASSERT_EQ_LEN("long array message", (scalars + 3 * BBS_SCALAR_LEN),
+					      long_scalar, BBS_SCALAR_LEN);
+				ASSERT_EQ_LEN("messages before a long one", scalars, ref,
+					      3 * BBS_SCALAR_LEN);
+				ASSERT_EQ_LEN("messages after a long one", (scalars + 4 * BBS_SCALAR_LEN),
+					      (ref + 4 * BBS_SCALAR_LEN), (LEN(msgs) - 4) * BBS_SCALAR_LEN);
+			}
+		}
+	}
+
+	return 0;
+}
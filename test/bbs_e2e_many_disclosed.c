@@ -0,0 +1,81 @@
+#include "test_util.h"
+#include <string.h>
+
+// Varargs for up to 1000 messages of 32 octets each
+#define M(i)    msgs[i], (uint32_t) sizeof(msgs[i])
+#define M10(i)  M(i), M(i + 1), M(i + 2), M(i + 3), M(i + 4), M(i + 5), M(i + 6), \
+		M(i + 7), M(i + 8), M(i + 9)
+#define M100(i) M10(i), M10(i + 10), M10(i + 20), M10(i + 30), M10(i + 40), M10(i + 50), \
+		M10(i + 60), M10(i + 70), M10(i + 80), M10(i + 90)
+#define M1000   M100(0), M100(100), M100(200), M100(300), M100(400), M100(500), \
+		M100(600), M100(700), M100(800), M100(900)
+
+// Signs n + 1 messages and presents the first n of them, then verifies the
+// proof. Only the last message is undisclosed.
+#define SIGN_N_DISCLOSE(n, MSGS) \
+	if(BBS_OK != bbs_sign(cipher_suites[s], sk, pk, sig, (uint8_t*)header, strlen(header), \
+			      n + 1, MSGS, M(n))) { \
+		puts("Error during signing"); \
+		return 1; \
+	} \
+	if(BBS_OK != bbs_proof_gen(cipher_suites[s], pk, sig, proof, (uint8_t*)header, \
+				   strlen(header), (uint8_t*)ph, strlen(ph), disclosed_indexes, n, \
+				   n + 1, MSGS, M(n))) { \
+		puts("Error during proof generation"); \
+		return 1; \
+	} \
+	BBS_BENCH_START() \
+	if(BBS_OK != bbs_proof_verify(cipher_suites[s], pk, proof, BBS_PROOF_LEN(1), \
+				      (uint8_t*)header, strlen(header), (uint8_t*)ph, strlen(ph), \
+				      disclosed_indexes, n, n + 1, MSGS)) { \
+		puts("Error during proof verification (" #n " disclosed messages)"); \
+		return 1; \
+	} \
+	BBS_BENCH_END("bbs_proof_verify (" #n " disclosed messages)")
+
+int bbs_e2e_many_disclosed() {
+	if (core_init() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+	if (pc_param_set_any() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+
+	static uint8_t msgs[1001][32];
+	static uint64_t disclosed_indexes[1000];
+	static char header[] = "A credential with many attributes";
+	static char ph[] = "Presentation nonce";
+	const bbs_ciphersuite *cipher_suites[] = {bbs_sha256_ciphersuite, bbs_shake256_ciphersuite};
+	static const char *names[] = {"SHA-256", "SHAKE-256"};
+
+	for(int i = 0; i < LEN(msgs); i++) {
+		for(int j = 0; j < sizeof(msgs[i]); j++) {
+			msgs[i][j] = i * 31 + j;
+		}
+	}
+	for(int i = 0; i < LEN(disclosed_indexes); i++) {
+		disclosed_indexes[i] = i;
+	}
+
+	for(int s = 0; s < LEN(cipher_suites); s++) {
+		printf("Ciphersuite %s\n", names[s]);
+
+		bbs_secret_key sk;
+		bbs_public_key pk;
+		bbs_signature sig;
+		uint8_t proof[BBS_PROOF_LEN(1)];
+
+		if(BBS_OK != bbs_keygen_full(cipher_suites[s], sk, pk)) {
+			puts("Error during key generation");
+			return 1;
+		}
+
+		SIGN_N_DISCLOSE(10, M10(0))
+		SIGN_N_DISCLOSE(100, M100(0))
+		SIGN_N_DISCLOSE(1000, M1000)
+	}
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+#include "test_util.h"
+#include <string.h>
+
+// Many enough to give every thread of the pool a slice, with a shorter last
+// one: slices are rounded up to multiples of 16 messages, so with 64 threads
+// there are 63 slices of 16 and one of 12
+#define NUM_MAPPED 1020
+
+// Signed messages, 32 for each of 3 threads and 4 for the fourth
+#define NUM_SIGNED 100
+
+int bbs_e2e_parallel_mapping() {
+	if (core_init() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+	if (pc_param_set_any() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+
+	static uint8_t msgs[NUM_MAPPED][200];
+	static const uint8_t *msg_ptrs[NUM_MAPPED];
+	static size_t msg_lens[NUM_MAPPED];
+	static uint8_t ref[NUM_MAPPED * BBS_SCALAR_LEN], scalars[NUM_MAPPED * BBS_SCALAR_LEN];
+	static char header[] = "A header for many messages";
+	const bbs_ciphersuite *cipher_suites[] = {bbs_sha256_ciphersuite, bbs_shake256_ciphersuite};
+	static const char *names[] = {"SHA-256", "SHAKE-256"};
+	bbs_messages array = {.msgs = msg_ptrs, .msg_lens = msg_lens};
+
+	for(int i = 0; i < NUM_MAPPED; i++) {
+		for(int j = 0; j < sizeof(msgs[i]); j++) {
+			msgs[i][j] = i * 31 + j;
+		}
+		msg_ptrs[i] = msgs[i];
+		msg_lens[i] = i % sizeof(msgs[i]);
+	}
+
+	if(BBS_OK == bbs_set_parallel_mapping(65, 1)) {
+		puts("Too many mapping threads accepted");
+		return 1;
+	}
+	if(BBS_OK != bbs_set_parallel_mapping(4, 1)) {
+		puts("Parallel mapping not supported here");
+		return 0;
+	}
+
+	for(int s = 0; s < LEN(cipher_suites); s++) {
+		printf("Ciphersuite %s\n", names[s]);
+
+		bbs_secret_key sk;
+		bbs_public_key pk;
+		bbs_signature ref_sig, sig;
+
+		if(BBS_OK != bbs_keygen_full(cipher_suites[s], sk, pk)) {
+			puts("Error during key generation");
+			return 1;
+		}
+
+		// Sequential reference
+		bbs_set_parallel_mapping(1, 0);
+		if(BBS_OK != bbs_messages_to_scalars_array(cipher_suites[s], ref, NUM_MAPPED,
+							   &array)) {
+			puts("Error during message mapping");
+			return 1;
+		}
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_sign_array(cipher_suites[s], sk, pk, ref_sig, (uint8_t*)header,
+					    strlen(header), NUM_SIGNED, &array)) {
+			puts("Error during signing");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_sign (100 messages, sequential mapping)")
+
+		// The parallel mapping has to reproduce the reference for any number
+		// of threads, and so does deterministic signing
+		uint32_t threads[] = {2, 3, 4, 64};
+		for(int t = 0; t < LEN(threads); t++) {
+			bbs_set_parallel_mapping(threads[t], 1);
+			if(BBS_OK != bbs_messages_to_scalars_array(cipher_suites[s], scalars, NUM_MAPPED,
+								   &array)) {
+				puts("Error during parallel message mapping");
+				return 1;
+			}
+			ASSERT_EQ("parallel message mapping", scalars, ref);
+
+			BBS_BENCH_START()
+			if(BBS_OK != bbs_sign_array(cipher_suites[s], sk, pk, sig, (uint8_t*)header,
+						    strlen(header), NUM_SIGNED, &array)) {
+				puts("Error during signing with parallel mapping");
+				return 1;
+			}
+			BBS_BENCH_END("bbs_sign (100 messages, parallel mapping)")
+			ASSERT_EQ("signature with parallel mapping", sig, ref_sig);
+
+			if(BBS_OK != bbs_verify_array(cipher_suites[s], pk, sig, (uint8_t*)header,
+						      strlen(header), NUM_SIGNED, &array)) {
+				puts("Error during signature verification with parallel mapping");
+				return 1;
+			}
+		}
+
+		// Below the threshold, the messages are mapped sequentially
+		bbs_set_parallel_mapping(4, NUM_SIGNED + 1);
+		if(BBS_OK != bbs_verify_array(cipher_suites[s], pk, ref_sig, (uint8_t*)header,
+					      strlen(header), NUM_SIGNED, &array)) {
+			puts("Error during signature verification below the threshold");
+			return 1;
+		}
+
+		// From a scratch arena, the same operations do not allocate, and
+		// fail if the arena is too small
+		static uint8_t arena[16384];
+		uint64_t disclosed_indexes[] = {0, NUM_SIGNED - 1};
+		const uint8_t *disclosed_msgs[] = {msg_ptrs[0], msg_ptrs[NUM_SIGNED - 1]};
+		size_t disclosed_lens[] = {msg_lens[0], msg_lens[NUM_SIGNED - 1]};
+		bbs_messages disclosed = {.msgs = disclosed_msgs, .msg_lens = disclosed_lens};
+		uint8_t proof[BBS_PROOF_LEN(NUM_SIGNED - LEN(disclosed_indexes))];
+		if(bbs_scratch_size(NUM_SIGNED) > sizeof(arena)) {
+			puts("Scratch size out of bounds");
+			return 1;
+		}
+		bbs_set_parallel_mapping(4, 1);
+		bbs_set_scratch(arena, bbs_scratch_size(NUM_SIGNED));
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_sign_array(cipher_suites[s], sk, pk, sig, (uint8_t*)header,
+					    strlen(header), NUM_SIGNED, &array)) {
+			puts("Error during signing from a scratch arena");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_sign (100 messages, parallel mapping, scratch arena)")
+		ASSERT_EQ("signature from a scratch arena", sig, ref_sig);
+		if(BBS_OK != bbs_proof_gen_array(cipher_suites[s], pk, sig, proof, (uint8_t*)header,
+					         strlen(header), NULL, 0, disclosed_indexes,
+					         LEN(disclosed_indexes), NUM_SIGNED, &array)) {
+			puts("Error during proof generation from a scratch arena");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_verify_array(cipher_suites[s], pk, proof, sizeof(proof),
+						    (uint8_t*)header, strlen(header), NULL, 0,
+						    disclosed_indexes, LEN(disclosed_indexes), NUM_SIGNED,
+						    &disclosed)) {
+			puts("Error during proof verification from a scratch arena");
+			return 1;
+		}
+		bbs_set_scratch(arena, 16);
+		if(BBS_OK == bbs_sign_array(cipher_suites[s], sk, pk, sig, (uint8_t*)header,
+					    strlen(header), NUM_SIGNED, &array)) {
+			puts("Signing exceeded the scratch arena");
+			return 1;
+		}
+		bbs_set_scratch(NULL, 0);
+	}
+
+	bbs_set_parallel_mapping(1, 0);
+	return 0;
+}
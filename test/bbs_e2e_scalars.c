@@ -0,0 +1,146 @@
+#include "test_util.h"
+#include <string.h>
+
+#define ROUNDS 1000
+
+int bbs_e2e_scalars() {
+	if (core_init() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+	if (pc_param_set_any() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+
+	uint8_t bin[BBS_SCALAR_LEN], ref[BBS_SCALAR_LEN], wide[48];
+	sc_t a, b, c;
+	bn_t a_n, b_n, c_n, r;
+	bn_null(a_n);
+	bn_null(b_n);
+	bn_null(c_n);
+	bn_null(r);
+	RLC_TRY {
+		bn_new(a_n);
+		bn_new(b_n);
+		bn_new(c_n);
+		bn_new(r);
+		bn_copy(r, &(core_get()->ep_r));
+	}
+	RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+
+	// Every operation has to agree with relic's bn_t arithmetic modulo r.
+	// The first round covers 0 and r - 1.
+	for(int i = 0; i < ROUNDS; i++) {
+		RLC_TRY {
+			if(0 == i) {
+				bn_zero(a_n);
+				bn_sub_dig(b_n, r, 1);
+			}
+			else {
+				bn_rand_mod(a_n, r);
+				bn_rand_mod(b_n, r);
+			}
+			sc_read_bn(a, a_n);
+			sc_read_bn(b, b_n);
+		}
+		RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+
+		// Serialization round trip
+		RLC_TRY {
+			bn_write_bbs(ref, b_n);
+		} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+		if(BBS_OK != sc_read_bbs(c, ref)) {
+			puts("Error during scalar deserialization");
+			return 1;
+		}
+		sc_write_bbs(bin, c);
+		ASSERT_EQ("scalar serialization", bin, ref);
+
+		RLC_TRY {
+			bn_add(c_n, a_n, b_n);
+			bn_mod(c_n, c_n, r);
+			bn_write_bbs(ref, c_n);
+		} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+		sc_add(c, a, b);
+		sc_write_bbs(bin, c);
+		ASSERT_EQ("scalar addition", bin, ref);
+
+		RLC_TRY {
+			bn_sub(c_n, a_n, b_n);
+			bn_mod(c_n, c_n, r);
+			bn_write_bbs(ref, c_n);
+		} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+		sc_sub(c, a, b);
+		sc_write_bbs(bin, c);
+		ASSERT_EQ("scalar subtraction", bin, ref);
+
+		RLC_TRY {
+			bn_mul(c_n, a_n, b_n);
+			bn_mod(c_n, c_n, r);
+			bn_write_bbs(ref, c_n);
+		} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+		sc_mul(c, a, b);
+		sc_write_bbs(bin, c);
+		ASSERT_EQ("scalar multiplication", bin, ref);
+
+		RLC_TRY {
+			bn_mod_inv(c_n, b_n, r);
+			bn_write_bbs(ref, c_n);
+		} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+		sc_inv(c, b);
+		sc_write_bbs(bin, c);
+		ASSERT_EQ("scalar inversion", bin, ref);
+
+		// Wide reduction of 48 random octets
+		RLC_TRY {
+			rand_bytes(wide, sizeof(wide));
+			bn_read_bin(c_n, wide, sizeof(wide));
+			bn_mod(c_n, c_n, r);
+			bn_write_bbs(ref, c_n);
+		} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+		sc_read_wide(c, wide);
+		sc_write_bbs(bin, c);
+		ASSERT_EQ("wide scalar reduction", bin, ref);
+	}
+
+	// Neither r nor anything above is a scalar
+	RLC_TRY {
+		bn_write_bbs(bin, r);
+	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+	if(BBS_OK == sc_read_bbs(c, bin)) {
+		puts("Unreduced scalar accepted");
+		return 1;
+	}
+
+	// Benchmark against relic
+	BBS_BENCH_START()
+	for(int i = 0; i < ROUNDS; i++) {
+		sc_mul(a, a, b);
+		sc_add(a, a, b);
+	}
+	BBS_BENCH_END("sc_mul + sc_add (1000 times)")
+	BBS_BENCH_START()
+	RLC_TRY {
+		for(int i = 0; i < ROUNDS; i++) {
+			bn_mul(a_n, a_n, b_n);
+			bn_add(a_n, a_n, b_n);
+			bn_mod(a_n, a_n, r);
+		}
+	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+	BBS_BENCH_END("bn_mul + bn_add + bn_mod (1000 times)")
+	BBS_BENCH_START()
+	sc_inv(a, b);
+	BBS_BENCH_END("sc_inv")
+	BBS_BENCH_START()
+	RLC_TRY {
+		bn_mod_inv(a_n, b_n, r);
+	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+	BBS_BENCH_END("bn_mod_inv")
+
+	bn_free(a_n);
+	bn_free(b_n);
+	bn_free(c_n);
+	bn_free(r);
+	return 0;
+}
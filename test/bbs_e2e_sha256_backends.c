@@ -0,0 +1,131 @@
+#include "test_util.h"
+#include <string.h>
+
+#define HASHES 1000
+
+// One full batch of 16 messages for the x16 lanes, and 15 more, which split
+// into x8, x4 and single lanes
+#define BATCH_MSGS 31
+
+int bbs_e2e_sha256_backends() {
+	if (core_init() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+	if (pc_param_set_any() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+
+	static uint8_t map_dst[] = "BBS_BLS12381G1_XMD:SHA-256_SSWU_RO_H2G_HM2S_MAP_MSG_TO_SCALAR_AS_HASH_";
+	static uint8_t map_dst_len = 70;
+	static char msg[] = "A 32 byte credential attribute..";
+	static const char *names[] = {"generic", "SHA-NI", "ARMv8"};
+
+	uint8_t bin[BBS_SCALAR_LEN], ref[BBS_SCALAR_LEN];
+	bn_t scalar;
+	bn_null(scalar);
+	RLC_TRY {
+		bn_new(scalar);
+	}
+	RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+
+	bbs_sha256_backend selected = bbs_sha256_get_backend();
+	bbs_sha256_backend backends[] = {BBS_SHA256_GENERIC, BBS_SHA256_SHANI, BBS_SHA256_ARMV8};
+
+	// Every supported backend has to reproduce the generic result. In
+	// benchmark mode, this doubles as a per-hash comparison.
+	for(int b = 0; b < LEN(backends); b++) {
+		if(BBS_OK != bbs_sha256_set_backend(backends[b])) {
+			printf("SHA-256 backend %s not supported here\n", names[b]);
+			continue;
+		}
+
+		BBS_BENCH_START()
+		for(int i = 0; i < HASHES; i++) {
+			if(BBS_OK != hash_to_scalar(bbs_sha256_ciphersuite, scalar, map_dst, map_dst_len, msg, strlen(msg), 0)) {
+				puts("Error during hash to scalar");
+				return 1;
+			}
+		}
+		BBS_BENCH_END(names[b])
+
+		RLC_TRY {
+			bn_write_bbs(bin, scalar);
+		} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+		if(BBS_SHA256_GENERIC == backends[b]) {
+			memcpy(ref, bin, BBS_SCALAR_LEN);
+		}
+		else if(memcmp(ref, bin, BBS_SCALAR_LEN)) {
+			printf("SHA-256 backend %s disagrees with the generic one\n", names[b]);
+			return 1;
+		}
+	}
+
+	// The multi-buffer lanes have to agree with hashing every message on its
+	// own. Which lane widths run depends on the backend and the CPU.
+	static uint8_t batch_msgs[BATCH_MSGS][BATCH_MSGS];
+	const uint8_t *batch_ptrs[BATCH_MSGS];
+	uint64_t batch_lens[BATCH_MSGS];
+	bn_t batch_scalars[BATCH_MSGS];
+	hash_to_scalar_fixed_dst fdst;
+	for(int i = 0; i < BATCH_MSGS; i++) {
+		memset(batch_msgs[i], i * 13 + 1, sizeof(batch_msgs[i]));
+		batch_ptrs[i] = batch_msgs[i];
+		batch_lens[i] = i;
+		bn_null(batch_scalars[i]);
+		RLC_TRY {
+			bn_new(batch_scalars[i]);
+		}
+		RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+	}
+	if(BBS_OK != hash_to_scalar_fixed_init(bbs_sha256_ciphersuite, &fdst, map_dst, map_dst_len)) {
+		puts("Error during fixed DST preparation");
+		return 1;
+	}
+	for(int b = 0; b < LEN(backends); b++) {
+		if(BBS_OK != bbs_sha256_set_backend(backends[b])) {
+			continue;
+		}
+		if(BBS_OK != hash_to_scalar_batch(&fdst, batch_scalars, batch_ptrs, batch_lens,
+						  BATCH_MSGS)) {
+			puts("Error during batched hash to scalar");
+			return 1;
+		}
+		for(int i = 0; i < BATCH_MSGS; i++) {
+			if(BBS_OK != hash_to_scalar(bbs_sha256_ciphersuite, scalar, map_dst, map_dst_len,
+						    batch_msgs[i], batch_lens[i], 0)) {
+				puts("Error during hash to scalar");
+				return 1;
+			}
+			RLC_TRY {
+				bn_write_bbs(ref, scalar);
+				bn_write_bbs(bin, batch_scalars[i]);
+			} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+			if(memcmp(ref, bin, BBS_SCALAR_LEN)) {
+				printf("Batched hash to scalar %d disagrees with backend %s\n", i,
+				       names[b]);
+				return 1;
+			}
+		}
+	}
+	for(int i = 0; i < BATCH_MSGS; i++) {
+		bn_free(batch_scalars[i]);
+	}
+
+	if(BBS_OK != bbs_sha256_set_backend(selected)) {
+		puts("Could not restore the SHA-256 backend");
+		return 1;
+	}
+	if(BBS_OK == bbs_sha256_set_backend(3)) {
+		puts("Unknown SHA-256 backend accepted");
+		return 1;
+	}
+	if(selected != bbs_sha256_get_backend()) {
+		puts("Failed backend switch changed the SHA-256 backend");
+		return 1;
+	}
+
+	bn_free(scalar);
+	return 0;
+}
@@ -12,98 +12,230 @@ int bbs_e2e_sign_n_proof() {
 		return 1;
 	}
 
-	bbs_secret_key sk;
-	bbs_public_key pk;
-
-        BBS_BENCH_START()
-	if(BBS_OK != bbs_keygen_full(sk, pk)) {
-		puts("Error during key generation");
-		return 1;
-	}
-        BBS_BENCH_END("bbs_keygen_full")
-
-	bbs_signature sig;
 	static char msg1[] = "I am a message";
 	static char msg2[] = "And so am I. Crazy...";
 	static char header[] = "But I am a header!";
+	static char ph[] = "I am a challenge nonce!";
+	const bbs_ciphersuite *cipher_suites[] = {bbs_sha256_ciphersuite, bbs_shake256_ciphersuite};
+	static const char *names[] = {"SHA-256", "SHAKE-256"};
+	const uint8_t *msg_ptrs[] = {(uint8_t*)msg1, (uint8_t*)msg2};
+	size_t msg_lens[] = {strlen(msg1), strlen(msg2)};
+	bbs_messages messages = {.msgs = msg_ptrs, .msg_lens = msg_lens};
 
-        BBS_BENCH_START()
-	if(BBS_OK != bbs_sign(
-				sk,
-				pk,
-				sig,
-				(uint8_t*)header,
-				strlen(header),
-				2,
-				msg1,
-				strlen(msg1),
-				msg2,
-				strlen(msg2))) {
-		puts("Error during signing");
-		return 1;
-	}
-        BBS_BENCH_END("bbs_sign (2 messages, 1 header)")
-
-        BBS_BENCH_START()
-	if(BBS_OK != bbs_verify(
-				pk,
-				sig,
-				(uint8_t*)header,
-				strlen(header),
-				2,
-				msg1,
-				strlen(msg1),
-				msg2,
-				strlen(msg2))) {
-		puts("Error during signature verification");
-		return 1;
-	}
-        BBS_BENCH_END("bbs_verify (2 messages, 1 header)")
+	for(int s = 0; s < LEN(cipher_suites); s++) {
+		printf("Ciphersuite %s\n", names[s]);
 
-	uint8_t  proof[BBS_PROOF_LEN(1)];
-	uint64_t disclosed_indexes[] = {0};
-	static char ph[] = "I am a challenge nonce!";
+		bbs_secret_key sk;
+		bbs_public_key pk;
 
-        BBS_BENCH_START()
-	if(BBS_OK != bbs_proof_gen(
-				pk,
-				sig,
-				proof,
-				(uint8_t*)header,
-				strlen(header),
-				(uint8_t*)ph,
-				strlen(ph),
-				disclosed_indexes,
-				1,
-				2,
-				msg1,
-				strlen(msg1),
-				msg2,
-				strlen(msg2))) {
-		puts("Error during proof generation");
-		return 1;
-	}
-        BBS_BENCH_END("bbs_proof_gen (2 messages, 1 header, 1 disclosed index)")
-
-        BBS_BENCH_START()
-	if(BBS_OK != bbs_proof_verify(
-				pk,
-				proof,
-				BBS_PROOF_LEN(1),
-				(uint8_t*)header,
-				strlen(header),
-				(uint8_t*)ph,
-				strlen(ph),
-				disclosed_indexes,
-				1,
-				2,
-				msg1,
-				strlen(msg1))) {
-		puts("Error during proof verification");
-		return 1;
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_keygen_full(cipher_suites[s], sk, pk)) {
+			puts("Error during key generation");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_keygen_full")
+
+		bbs_signature sig;
+
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_sign(
+					cipher_suites[s],
+					sk,
+					pk,
+					sig,
+					(uint8_t*)header,
+					strlen(header),
+					2,
+					msg1,
+					strlen(msg1),
+					msg2,
+					strlen(msg2))) {
+			puts("Error during signing");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_sign (2 messages, 1 header)")
+
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_verify(
+					cipher_suites[s],
+					pk,
+					sig,
+					(uint8_t*)header,
+					strlen(header),
+					2,
+					msg1,
+					strlen(msg1),
+					msg2,
+					strlen(msg2))) {
+			puts("Error during signature verification");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_verify (2 messages, 1 header)")
+
+		uint8_t  proof[BBS_PROOF_LEN(1)];
+		uint64_t disclosed_indexes[] = {0};
+
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_proof_gen(
+					cipher_suites[s],
+					pk,
+					sig,
+					proof,
+					(uint8_t*)header,
+					strlen(header),
+					(uint8_t*)ph,
+					strlen(ph),
+					disclosed_indexes,
+					1,
+					2,
+					msg1,
+					strlen(msg1),
+					msg2,
+					strlen(msg2))) {
+			puts("Error during proof generation");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_proof_gen (2 messages, 1 header, 1 disclosed index)")
+
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_proof_verify(
+					cipher_suites[s],
+					pk,
+					proof,
+					BBS_PROOF_LEN(1),
+					(uint8_t*)header,
+					strlen(header),
+					(uint8_t*)ph,
+					strlen(ph),
+					disclosed_indexes,
+					1,
+					2,
+					msg1,
+					strlen(msg1))) {
+			puts("Error during proof verification");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_proof_verify (2 messages, 1 header, 1 disclosed index)")
+
+		// The same proof, with the curve arithmetic done before the
+		// presentation header is known
+		bbs_proof_precomp precomp;
+
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_proof_gen_offline(
+					cipher_suites[s],
+					&precomp,
+					pk,
+					sig,
+					proof,
+					(uint8_t*)header,
+					strlen(header),
+					disclosed_indexes,
+					1,
+					2,
+					&messages)) {
+			puts("Error during offline proof generation");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_proof_gen_offline (2 messages, 1 header, 1 disclosed index)")
+
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_proof_gen_online(&precomp, (uint8_t*)ph, strlen(ph))) {
+			puts("Error during online proof generation");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_proof_gen_online")
+
+		if(BBS_OK != bbs_proof_verify(
+					cipher_suites[s],
+					pk,
+					proof,
+					BBS_PROOF_LEN(1),
+					(uint8_t*)header,
+					strlen(header),
+					(uint8_t*)ph,
+					strlen(ph),
+					disclosed_indexes,
+					1,
+					2,
+					msg1,
+					strlen(msg1))) {
+			puts("Error during verification of an online proof");
+			return 1;
+		}
+
+		// A precomputation answers a single presentation header
+		if(BBS_OK == bbs_proof_gen_online(&precomp, (uint8_t*)ph, strlen(ph))) {
+			puts("Online proof generation reused a precomputation");
+			return 1;
+		}
+
+		// Discarding a precomputation wipes the message scalars from the proof
+		static const uint8_t zero_scalar[BBS_SCALAR_LEN];
+		if(BBS_OK != bbs_proof_gen_offline(cipher_suites[s], &precomp, pk, sig, proof,
+						   (uint8_t*)header, strlen(header), disclosed_indexes, 1,
+						   2, &messages)) {
+			puts("Error during offline proof generation");
+			return 1;
+		}
+		bbs_proof_precomp_free(&precomp);
+		ASSERT_EQ_LEN("discarded message scalars",
+			      (proof + 3 * BBS_G1_ELEM_LEN + 3 * BBS_SCALAR_LEN), zero_scalar,
+			      BBS_SCALAR_LEN);
+
+		// Proofs from a holder credential
+		bbs_credential cred;
+		ep_t           generators[2];
+		uint8_t        scalars[2 * BBS_SCALAR_LEN];
+
+		if(BBS_OK != bbs_credential_init(
+					cipher_suites[s],
+					&cred,
+					pk,
+					sig,
+					(uint8_t*)header,
+					strlen(header),
+					generators,
+					scalars,
+					2,
+					&messages)) {
+			puts("Error during credential initialization");
+			return 1;
+		}
+		for(int i = 0; i < 2; i++) {
+			BBS_BENCH_START()
+			if(BBS_OK != bbs_credential_proof_gen(
+						&cred,
+						proof,
+						(uint8_t*)ph,
+						strlen(ph),
+						disclosed_indexes,
+						1)) {
+				puts("Error during credential proof generation");
+				return 1;
+			}
+			BBS_BENCH_END("bbs_credential_proof_gen (2 messages, 1 disclosed index)")
+
+			if(BBS_OK != bbs_proof_verify(
+						cipher_suites[s],
+						pk,
+						proof,
+						BBS_PROOF_LEN(1),
+						(uint8_t*)header,
+						strlen(header),
+						(uint8_t*)ph,
+						strlen(ph),
+						disclosed_indexes,
+						1,
+						2,
+						msg1,
+						strlen(msg1))) {
+				puts("Error during verification of a credential proof");
+				return 1;
+			}
+		}
+		bbs_credential_free(&cred);
 	}
-        BBS_BENCH_END("bbs_proof_verify (2 messages, 1 header, 1 disclosed index)")
 
 	return 0;
 }
-
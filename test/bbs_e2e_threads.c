@@ -0,0 +1,180 @@
+#include "test_util.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#ifdef BBS_THREADS
+#include <pthread.h>
+#endif
+
+#define NUM_PROOFS 4
+#define RAND_LEN 1024
+
+typedef struct {
+	const bbs_ciphersuite *cipher_suite;
+	uint8_t                rand[RAND_LEN];
+	int                    res;
+} thread_run;
+
+// Signs, and proves and verifies repeatedly, on a relic context of its own
+static int
+sign_n_proof(
+		thread_run *run
+	) {
+	static char msg1[] = "I am a message";
+	static char msg2[] = "And so am I. Crazy...";
+	static char header[] = "But I am a header!";
+	static char ph[] = "I am a challenge nonce!";
+	uint64_t disclosed_indexes[] = {0};
+	bbs_secret_key sk;
+	bbs_public_key pk;
+	bbs_signature sig;
+	uint8_t proofs[NUM_PROOFS][BBS_PROOF_LEN(1)];
+
+	if(BBS_OK != bbs_keygen_full(run->cipher_suite, sk, pk)) {
+		puts("Error during key generation");
+		return 1;
+	}
+	if(BBS_OK != bbs_sign(run->cipher_suite, sk, pk, sig, (uint8_t*)header, strlen(header), 2,
+			      msg1, strlen(msg1), msg2, strlen(msg2))) {
+		puts("Error during signing");
+		return 1;
+	}
+	for(int p = 0; p < NUM_PROOFS; p++) {
+		if(BBS_OK != bbs_proof_gen(run->cipher_suite, pk, sig, proofs[p], (uint8_t*)header,
+					   strlen(header), (uint8_t*)ph, strlen(ph), disclosed_indexes,
+					   LEN(disclosed_indexes), 2, msg1, strlen(msg1), msg2,
+					   strlen(msg2))) {
+			puts("Error during proof generation");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_verify(run->cipher_suite, pk, proofs[p], sizeof(proofs[p]),
+					      (uint8_t*)header, strlen(header), (uint8_t*)ph,
+					      strlen(ph), disclosed_indexes, LEN(disclosed_indexes), 2,
+					      msg1, strlen(msg1))) {
+			puts("Error during proof verification");
+			return 1;
+		}
+		if(p > 0 && 0 == memcmp(proofs[p], proofs[p - 1], sizeof(proofs[p]))) {
+			puts("Proof randomness repeated");
+			return 1;
+		}
+	}
+
+	if(BBS_OK != bbs_rand_bytes(run->rand, sizeof(run->rand))) {
+		puts("Error during random generation");
+		return 1;
+	}
+	return 0;
+}
+
+#ifdef BBS_THREADS
+static void*
+run_thread(
+		void *arg
+	) {
+	thread_run *run = arg;
+
+	run->res = 1;
+	if (core_init() != RLC_OK) {
+		core_clean();
+		return NULL;
+	}
+	if (pc_param_set_any() != RLC_OK) {
+		core_clean();
+		return NULL;
+	}
+	run->res = sign_n_proof(run);
+	core_clean();
+	return NULL;
+}
+#endif
+
+int bbs_e2e_threads() {
+	if (core_init() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+	if (pc_param_set_any() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+
+	// Proofs on two threads at once, one per ciphersuite. Both draw from
+	// their own generators, so their random octets have to differ.
+	static thread_run runs[2];
+	runs[0].cipher_suite = bbs_sha256_ciphersuite;
+	runs[1].cipher_suite = bbs_shake256_ciphersuite;
+#ifdef BBS_THREADS
+	pthread_t threads[LEN(runs)];
+	for(int t = 0; t < LEN(runs); t++) {
+		if(0 != pthread_create(&threads[t], NULL, run_thread, &runs[t])) {
+			puts("Error during thread creation");
+			return 1;
+		}
+	}
+	for(int t = 0; t < LEN(runs); t++) {
+		pthread_join(threads[t], NULL);
+	}
+#else
+	puts("Threads not supported here, running sequentially");
+	for(int t = 0; t < LEN(runs); t++) {
+		runs[t].res = sign_n_proof(&runs[t]);
+	}
+#endif
+	for(int t = 0; t < LEN(runs); t++) {
+		if(0 != runs[t].res) {
+			printf("Error on thread %d\n", t);
+			return 1;
+		}
+	}
+	if(0 == memcmp(runs[0].rand, runs[1].rand, 32)) {
+		puts("Threads share their random octets");
+		return 1;
+	}
+
+	// After a fork, parent and child have the same generator state, which
+	// the child has to replace before its first output
+	uint8_t parent_rand[64], child_rand[64];
+	int fds[2];
+	if(BBS_OK != bbs_rand_bytes(parent_rand, sizeof(parent_rand))) {
+		puts("Error during random generation");
+		return 1;
+	}
+	if(0 != pipe(fds)) {
+		puts("Error during pipe creation");
+		return 1;
+	}
+	pid_t pid = fork();
+	if(pid < 0) {
+		puts("Error during fork");
+		return 1;
+	}
+	if(0 == pid) {
+		close(fds[0]);
+		int ok = BBS_OK == bbs_rand_bytes(child_rand, sizeof(child_rand)) &&
+			 sizeof(child_rand) == write(fds[1], child_rand, sizeof(child_rand));
+		_exit(ok ? 0 : 1);
+	}
+	close(fds[1]);
+	int status;
+	ssize_t got = 0, n;
+	while(got < sizeof(child_rand) && (n = read(fds[0], child_rand + got, sizeof(child_rand) - got)) > 0) {
+		got += n;
+	}
+	close(fds[0]);
+	if(pid != waitpid(pid, &status, 0) || ! WIFEXITED(status) || 0 != WEXITSTATUS(status) ||
+	   got != sizeof(child_rand)) {
+		puts("Error in the forked child");
+		return 1;
+	}
+	if(BBS_OK != bbs_rand_bytes(parent_rand, sizeof(parent_rand))) {
+		puts("Error during random generation");
+		return 1;
+	}
+	if(0 == memcmp(parent_rand, child_rand, sizeof(parent_rand))) {
+		puts("Child repeated the random octets of its parent");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,326 @@
+#include "fixtures.h"
+#include "test_util.h"
+#include <string.h>
+
+// Varargs for 40 messages, more than one multi-scalar multiplication takes
+#define M(i)   msgs[i], (uint32_t) sizeof(msgs[i])
+#define M10(i) M(i), M(i + 1), M(i + 2), M(i + 3), M(i + 4), M(i + 5), M(i + 6), \
+	       M(i + 7), M(i + 8), M(i + 9)
+#define MSGS   M10(0), M10(10), M10(20), M10(30)
+
+// Keys for the positive batch, and how often the check under the first key is
+// repeated. Both the checks under the first key and all checks together
+// exceed the 32 points of one multi-scalar multiplication.
+#define NUM_KEYS    3
+#define NUM_REPEATS 34
+
+int bbs_fix_batch_verify() {
+	if (core_init() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+	if (pc_param_set_any() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+
+	bbs_pairing_check check1, check2, check3, sig_check1, sig_check2, sig_check3;
+	bbs_pairing_acc   acc;
+	ep_t  acc_A[6], acc_B[5];
+	ep2_t acc_W[6];
+
+	if(BBS_OK != bbs_pairing_check_init(&check1) ||
+	   BBS_OK != bbs_pairing_check_init(&check2) ||
+	   BBS_OK != bbs_pairing_check_init(&check3) ||
+	   BBS_OK != bbs_pairing_check_init(&sig_check1) ||
+	   BBS_OK != bbs_pairing_check_init(&sig_check2) ||
+	   BBS_OK != bbs_pairing_check_init(&sig_check3) ||
+	   BBS_OK != bbs_pairing_acc_init(&acc, acc_A, acc_B, acc_W, 5)) {
+		puts("Internal error");
+		return 1;
+	}
+
+	if(BBS_OK != bbs_verify_deferred(
+				bbs_sha256_ciphersuite,
+				&sig_check1,
+				fixture_bls12_381_sha_256_signature1_PK,
+				fixture_bls12_381_sha_256_signature1_signature,
+				fixture_bls12_381_sha_256_signature1_header,
+				sizeof(fixture_bls12_381_sha_256_signature1_header),
+				1,
+				fixture_bls12_381_sha_256_signature1_m_1,
+				sizeof(fixture_bls12_381_sha_256_signature1_m_1))) {
+		puts("Error during deferred signature 1 verification");
+		return 1;
+	}
+
+	if(BBS_OK != bbs_verify_deferred(
+				bbs_sha256_ciphersuite,
+				&sig_check2,
+				fixture_bls12_381_sha_256_signature2_PK,
+				fixture_bls12_381_sha_256_signature2_signature,
+				fixture_bls12_381_sha_256_signature2_header,
+				sizeof(fixture_bls12_381_sha_256_signature2_header),
+				10,
+				fixture_bls12_381_sha_256_signature2_m_1,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_1),
+				fixture_bls12_381_sha_256_signature2_m_2,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_2),
+				fixture_bls12_381_sha_256_signature2_m_3,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_3),
+				fixture_bls12_381_sha_256_signature2_m_4,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_4),
+				fixture_bls12_381_sha_256_signature2_m_5,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_5),
+				fixture_bls12_381_sha_256_signature2_m_6,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_6),
+				fixture_bls12_381_sha_256_signature2_m_7,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_7),
+				fixture_bls12_381_sha_256_signature2_m_8,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_8),
+				fixture_bls12_381_sha_256_signature2_m_9,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_9),
+				fixture_bls12_381_sha_256_signature2_m_10,
+				sizeof(fixture_bls12_381_sha_256_signature2_m_10))) {
+		puts("Error during deferred signature 2 verification");
+		return 1;
+	}
+
+	// Signature under the wrong public key. This yields a check for a
+	// different key, which does not hold.
+	if(BBS_OK != bbs_verify_deferred(
+				bbs_sha256_ciphersuite,
+				&sig_check3,
+				fixture_bls12_381_sha_256_a_signature6_PK,
+				fixture_bls12_381_sha_256_a_signature6_signature,
+				fixture_bls12_381_sha_256_a_signature6_header,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_header),
+				10,
+				fixture_bls12_381_sha_256_a_signature6_m_1,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_1),
+				fixture_bls12_381_sha_256_a_signature6_m_2,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_2),
+				fixture_bls12_381_sha_256_a_signature6_m_3,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_3),
+				fixture_bls12_381_sha_256_a_signature6_m_4,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_4),
+				fixture_bls12_381_sha_256_a_signature6_m_5,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_5),
+				fixture_bls12_381_sha_256_a_signature6_m_6,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_6),
+				fixture_bls12_381_sha_256_a_signature6_m_7,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_7),
+				fixture_bls12_381_sha_256_a_signature6_m_8,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_8),
+				fixture_bls12_381_sha_256_a_signature6_m_9,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_9),
+				fixture_bls12_381_sha_256_a_signature6_m_10,
+				sizeof(fixture_bls12_381_sha_256_a_signature6_m_10))) {
+		puts("Error during deferred signature 3 verification");
+		return 1;
+	}
+	if(BBS_OK == bbs_pairing_check_eval(&sig_check3)) {
+		puts("Signature under wrong public key evaluated successfully");
+		return 1;
+	}
+
+	if(BBS_OK != bbs_proof_verify_deferred(
+				bbs_sha256_ciphersuite,
+				&check1,
+				fixture_bls12_381_sha_256_proof1_public_key,
+				fixture_bls12_381_sha_256_proof1_proof,
+				sizeof(fixture_bls12_381_sha_256_proof1_proof),
+				fixture_bls12_381_sha_256_proof1_header,
+				sizeof(fixture_bls12_381_sha_256_proof1_header),
+				fixture_bls12_381_sha_256_proof1_presentation_header,
+				sizeof(fixture_bls12_381_sha_256_proof1_presentation_header),
+				fixture_bls12_381_sha_256_proof1_revealed_indexes,
+				LEN(fixture_bls12_381_sha_256_proof1_revealed_indexes),
+				1,
+				fixture_bls12_381_sha_256_proof1_m_1,
+				sizeof(fixture_bls12_381_sha_256_proof1_m_1))) {
+		puts("Error during deferred proof 1 verification");
+		return 1;
+	}
+
+	if(BBS_OK != bbs_proof_verify_deferred(
+				bbs_sha256_ciphersuite,
+				&check2,
+				fixture_bls12_381_sha_256_proof2_public_key,
+				fixture_bls12_381_sha_256_proof2_proof,
+				sizeof(fixture_bls12_381_sha_256_proof2_proof),
+				fixture_bls12_381_sha_256_proof2_header,
+				sizeof(fixture_bls12_381_sha_256_proof2_header),
+				fixture_bls12_381_sha_256_proof2_presentation_header,
+				sizeof(fixture_bls12_381_sha_256_proof2_presentation_header),
+				fixture_bls12_381_sha_256_proof2_revealed_indexes,
+				LEN(fixture_bls12_381_sha_256_proof2_revealed_indexes),
+				10,
+				fixture_bls12_381_sha_256_proof2_m_1,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_1),
+				fixture_bls12_381_sha_256_proof2_m_2,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_2),
+				fixture_bls12_381_sha_256_proof2_m_3,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_3),
+				fixture_bls12_381_sha_256_proof2_m_4,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_4),
+				fixture_bls12_381_sha_256_proof2_m_5,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_5),
+				fixture_bls12_381_sha_256_proof2_m_6,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_6),
+				fixture_bls12_381_sha_256_proof2_m_7,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_7),
+				fixture_bls12_381_sha_256_proof2_m_8,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_8),
+				fixture_bls12_381_sha_256_proof2_m_9,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_9),
+				fixture_bls12_381_sha_256_proof2_m_10,
+				sizeof(fixture_bls12_381_sha_256_proof2_m_10))) {
+		puts("Error during deferred proof 2 verification");
+		return 1;
+	}
+
+	if(BBS_OK != bbs_proof_verify_deferred(
+				bbs_sha256_ciphersuite,
+				&check3,
+				fixture_bls12_381_sha_256_proof3_public_key,
+				fixture_bls12_381_sha_256_proof3_proof,
+				sizeof(fixture_bls12_381_sha_256_proof3_proof),
+				fixture_bls12_381_sha_256_proof3_header,
+				sizeof(fixture_bls12_381_sha_256_proof3_header),
+				fixture_bls12_381_sha_256_proof3_presentation_header,
+				sizeof(fixture_bls12_381_sha_256_proof3_presentation_header),
+				fixture_bls12_381_sha_256_proof3_revealed_indexes,
+				LEN(fixture_bls12_381_sha_256_proof3_revealed_indexes),
+				10,
+				fixture_bls12_381_sha_256_proof3_m_1,
+				sizeof(fixture_bls12_381_sha_256_proof3_m_1),
+				fixture_bls12_381_sha_256_proof3_m_3,
+				sizeof(fixture_bls12_381_sha_256_proof3_m_3),
+				fixture_bls12_381_sha_256_proof3_m_5,
+				sizeof(fixture_bls12_381_sha_256_proof3_m_5),
+				fixture_bls12_381_sha_256_proof3_m_7,
+				sizeof(fixture_bls12_381_sha_256_proof3_m_7))) {
+		puts("Error during deferred proof 3 verification");
+		return 1;
+	}
+
+	if(BBS_OK != bbs_pairing_check_eval(&check1) ||
+	   BBS_OK != bbs_pairing_check_eval(&sig_check1)) {
+		puts("Error during single pairing check evaluation");
+		return 1;
+	}
+
+	// All of these are under the same key
+        BBS_BENCH_START()
+	if(BBS_OK != bbs_pairing_acc_add(&acc, &check1) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &check2) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &check3) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &sig_check1) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &sig_check2) ||
+	   BBS_OK != bbs_pairing_acc_eval(&acc)) {
+		puts("Error during batch evaluation");
+		return 1;
+	}
+        BBS_BENCH_END("Batch evaluation of 5 pairing checks under one key")
+
+	// A check under another key spoils the batch
+	if(BBS_OK != bbs_pairing_acc_add(&acc, &check1) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &sig_check3) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &check2) ||
+	   BBS_OK == bbs_pairing_acc_eval(&acc)) {
+		puts("Batch with wrong public key evaluated successfully");
+		return 1;
+	}
+
+	// The accumulator is full after five checks
+	if(BBS_OK != bbs_pairing_acc_add(&acc, &check1) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &check2) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &check3) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &sig_check1) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &sig_check2) ||
+	   BBS_OK == bbs_pairing_acc_add(&acc, &check3)) {
+		puts("Error during accumulator capacity check");
+		return 1;
+	}
+
+	// A single invalid check spoils the batch
+	RLC_TRY {
+		ep_copy(check2.A, check2.B);
+	} RLC_CATCH_ANY { puts("Internal error"); return 1; }
+	if(BBS_OK == bbs_pairing_check_eval(&check2)) {
+		puts("Invalid pairing check evaluated successfully");
+		return 1;
+	}
+	if(BBS_OK != bbs_pairing_acc_eval(&acc) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &check1) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &check2) ||
+	   BBS_OK != bbs_pairing_acc_add(&acc, &check3) ||
+	   BBS_OK == bbs_pairing_acc_eval(&acc)) {
+		puts("Invalid batch evaluated successfully");
+		return 1;
+	}
+
+	// Valid signatures under several keys. There are more checks, and more
+	// checks under the first key, than fit into one multi-scalar
+	// multiplication.
+	static uint8_t msgs[40][24];
+	static char header[] = "A header for the batch";
+	static bbs_pairing_acc big_acc;
+	static ep_t big_A[NUM_REPEATS + NUM_KEYS], big_B[NUM_REPEATS + NUM_KEYS - 1];
+	static ep2_t big_W[NUM_REPEATS + NUM_KEYS];
+	bbs_pairing_check key_checks[NUM_KEYS];
+	bbs_secret_key sk;
+	bbs_public_key pk;
+	bbs_signature sig;
+
+	for(int i = 0; i < LEN(msgs); i++) {
+		memset(msgs[i], i + 1, sizeof(msgs[i]));
+	}
+	if(BBS_OK != bbs_pairing_acc_init(&big_acc, big_A, big_B, big_W,
+					  NUM_REPEATS + NUM_KEYS - 1)) {
+		puts("Internal error");
+		return 1;
+	}
+	for(int k = 0; k < NUM_KEYS; k++) {
+		if(BBS_OK != bbs_pairing_check_init(&key_checks[k]) ||
+		   BBS_OK != bbs_keygen_full(bbs_sha256_ciphersuite, sk, pk) ||
+		   BBS_OK != bbs_sign(bbs_sha256_ciphersuite, sk, pk, sig, (uint8_t*)header,
+				      strlen(header), LEN(msgs), MSGS) ||
+		   BBS_OK != bbs_verify_deferred(bbs_sha256_ciphersuite, &key_checks[k], pk, sig,
+						 (uint8_t*)header, strlen(header), LEN(msgs),
+						 MSGS)) {
+			puts("Error during deferred verification of a 40 message signature");
+			return 1;
+		}
+	}
+	for(int i = 0; i < NUM_REPEATS; i++) {
+		if(BBS_OK != bbs_pairing_acc_add(&big_acc, &key_checks[0])) {
+			puts("Error during accumulation");
+			return 1;
+		}
+	}
+	for(int k = 1; k < NUM_KEYS; k++) {
+		if(BBS_OK != bbs_pairing_acc_add(&big_acc, &key_checks[k])) {
+			puts("Error during accumulation");
+			return 1;
+		}
+	}
+	if(BBS_OK != bbs_pairing_acc_eval(&big_acc)) {
+		puts("Valid batch under several keys failed to evaluate");
+		return 1;
+	}
+	for(int k = 0; k < NUM_KEYS; k++) {
+		bbs_pairing_check_free(&key_checks[k]);
+	}
+	bbs_pairing_acc_free(&big_acc);
+
+	bbs_pairing_check_free(&check1);
+	bbs_pairing_check_free(&check2);
+	bbs_pairing_check_free(&check3);
+	bbs_pairing_check_free(&sig_check1);
+	bbs_pairing_check_free(&sig_check2);
+	bbs_pairing_check_free(&sig_check3);
+	bbs_pairing_acc_free(&acc);
+	return 0;
+}
@@ -21,112 +21,28 @@ int bbs_fix_generators() {
 	}
 	RLC_CATCH_ANY { puts("Internal Error"); return 1; }
 
-	static uint8_t api_id[] = "BBS_BLS12381G1_XMD:SHA-256_SSWU_RO_H2G_HM2S_";
-	static uint8_t api_id_len = 44;
-
-	if(BBS_OK != create_generator_init(state, api_id, api_id_len)) {
-		puts("Error during generator initialization");
-		return 1;
-	}
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator Q_1 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator Q_1 creation", bin, fixture_bls12_381_sha_256_Q_1);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_1 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_1 creation", bin, fixture_bls12_381_sha_256_H_1);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_2 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_2 creation", bin, fixture_bls12_381_sha_256_H_2);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_3 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_3 creation", bin, fixture_bls12_381_sha_256_H_3);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_4 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_4 creation", bin, fixture_bls12_381_sha_256_H_4);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_5 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_5 creation", bin, fixture_bls12_381_sha_256_H_5);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_6 creation");
-		return 1;
+	fixture_ciphersuite suites[] = FIXTURE_CIPHERSUITES;
+	for(int s = 0; s < LEN(suites); s++) {
+		const fixture_ciphersuite *f = &suites[s];
+		printf("Ciphersuite %s\n", f->name);
+
+		if(BBS_OK != create_generator_init(f->cipher_suite, state)) {
+			puts("Error during generator initialization");
+			return 1;
+		}
+
+		// Q_1, followed by H_1 to H_10
+		for(int i = 0; i < LEN(f->generators); i++) {
+			if(BBS_OK != create_generator_next(f->cipher_suite, state, generator)) {
+				printf("Error during generator %d creation\n", i);
+				return 1;
+			}
+			RLC_TRY {
+				ep_write_bbs(bin, generator);
+			} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+			ASSERT_EQ_LEN("generator creation", bin, f->generators[i], BBS_G1_ELEM_LEN);
+		}
 	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_6 creation", bin, fixture_bls12_381_sha_256_H_6);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_7 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_7 creation", bin, fixture_bls12_381_sha_256_H_7);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_8 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_8 creation", bin, fixture_bls12_381_sha_256_H_8);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_9 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_9 creation", bin, fixture_bls12_381_sha_256_H_9);
-
-	if(BBS_OK != create_generator_next(state, generator, api_id, api_id_len)) {
-		puts("Error during generator H_10 creation");
-		return 1;
-	}
-	RLC_TRY {
-		ep_write_bbs(bin, generator);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("generator H_10 creation", bin, fixture_bls12_381_sha_256_H_10);
 
 	ep_free(generator);
 	return 0;
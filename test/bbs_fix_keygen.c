@@ -11,26 +11,33 @@ int bbs_fix_keygen() {
 		return 1;
 	}
 
-	bbs_secret_key sk;
-	if(BBS_OK != bbs_keygen(
-				sk,
-				fixture_bls12_381_sha_256_key_material,
-				sizeof(fixture_bls12_381_sha_256_key_material),
-				fixture_bls12_381_sha_256_key_info,
-				sizeof(fixture_bls12_381_sha_256_key_info),
-				fixture_bls12_381_sha_256_key_dst,
-				sizeof(fixture_bls12_381_sha_256_key_dst))) {
-		puts("Error during secret key generation");
-		return 1;
-	}
-	ASSERT_EQ("secret key generation", sk, fixture_bls12_381_sha_256_SK);
+	fixture_ciphersuite suites[] = FIXTURE_CIPHERSUITES;
+	for(int s = 0; s < LEN(suites); s++) {
+		const fixture_ciphersuite *f = &suites[s];
+		printf("Ciphersuite %s\n", f->name);
 
-	bbs_public_key pk;
-	if(BBS_OK != bbs_sk_to_pk(fixture_bls12_381_sha_256_SK, pk)) {
-		puts("Error during public key generation");
-		return 1;
+		bbs_secret_key sk;
+		if(BBS_OK != bbs_keygen(
+					f->cipher_suite,
+					sk,
+					f->key_material,
+					f->key_material_len,
+					f->key_info,
+					f->key_info_len,
+					f->key_dst,
+					f->key_dst_len)) {
+			puts("Error during secret key generation");
+			return 1;
+		}
+		ASSERT_EQ_LEN("secret key generation", sk, f->SK, BBS_SK_LEN);
+
+		bbs_public_key pk;
+		if(BBS_OK != bbs_sk_to_pk(f->SK, pk)) {
+			puts("Error during public key generation");
+			return 1;
+		}
+		ASSERT_EQ_LEN("public key generation", pk, f->PK, BBS_PK_LEN);
 	}
-	ASSERT_EQ("public key generation", pk, fixture_bls12_381_sha_256_PK);
 
 	return 0;
 }
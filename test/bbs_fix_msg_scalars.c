@@ -1,5 +1,6 @@
 #include "fixtures.h"
 #include "test_util.h"
+#include <string.h>
 
 int bbs_fix_msg_scalars() {
 	if (core_init() != RLC_OK) {
@@ -20,99 +21,88 @@ int bbs_fix_msg_scalars() {
 	}
 	RLC_CATCH_ANY { puts("Internal Error"); return 1; }
 
-	static uint8_t map_dst[] = "BBS_BLS12381G1_XMD:SHA-256_SSWU_RO_H2G_HM2S_MAP_MSG_TO_SCALAR_AS_HASH_";
-	static uint8_t map_dst_len = 70;
-
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_1, sizeof(fixture_m_1), 0)) {
-		puts("Error during hash to scalar for message 1");
-		return 1;
+	const uint8_t *msgs[] = {fixture_m_1, fixture_m_2, fixture_m_3, fixture_m_4, fixture_m_5,
+		fixture_m_6, fixture_m_7, fixture_m_8, fixture_m_9, fixture_m_10};
+	uint64_t msg_lens[] = {sizeof(fixture_m_1), sizeof(fixture_m_2), sizeof(fixture_m_3),
+		sizeof(fixture_m_4), sizeof(fixture_m_5), sizeof(fixture_m_6), sizeof(fixture_m_7),
+		sizeof(fixture_m_8), sizeof(fixture_m_9), sizeof(fixture_m_10)};
+	bn_t scalars[LEN(msgs)];
+	for(int i = 0; i < LEN(msgs); i++) {
+		bn_null(scalars[i]);
+		RLC_TRY {
+			bn_new(scalars[i]);
+		}
+		RLC_CATCH_ANY { puts("Internal Error"); return 1; }
 	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 1 generation", bin, fixture_bls12_381_sha_256_msg_scalar_1);
 
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_2, sizeof(fixture_m_2), 0)) {
-		puts("Error during hash to scalar for message 2");
-		return 1;
-	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 2 generation", bin, fixture_bls12_381_sha_256_msg_scalar_2);
+	fixture_ciphersuite suites[] = FIXTURE_CIPHERSUITES;
+	for(int s = 0; s < LEN(suites); s++) {
+		const fixture_ciphersuite *f = &suites[s];
+		const uint8_t *map_dst = f->cipher_suite->map_dst;
+		uint8_t map_dst_len = f->cipher_suite->map_dst_len;
+		printf("Ciphersuite %s\n", f->name);
 
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_3, sizeof(fixture_m_3), 0)) {
-		puts("Error during hash to scalar for message 3");
-		return 1;
-	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 3 generation", bin, fixture_bls12_381_sha_256_msg_scalar_3);
+		for(int i = 0; i < LEN(msgs); i++) {
+			if(BBS_OK != hash_to_scalar(f->cipher_suite, scalar, map_dst, map_dst_len,
+						    msgs[i], msg_lens[i], 0)) {
+				printf("Error during hash to scalar for message %d\n", i + 1);
+				return 1;
+			}
+			RLC_TRY {
+				bn_write_bbs(bin, scalar);
+			} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+			if(memcmp(bin, f->msg_scalars[i], BBS_SCALAR_LEN)) {
+				printf("Mismatch in scalar %d generation\n", i + 1);
+				return 1;
+			}
+		}
 
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_4, sizeof(fixture_m_4), 0)) {
-		puts("Error during hash to scalar for message 4");
-		return 1;
-	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 4 generation", bin, fixture_bls12_381_sha_256_msg_scalar_4);
+		// The fixed DST path has to agree with the streaming one, including
+		// around the switch from two to one b_0 block and to the fallback
+		hash_to_scalar_fixed_dst fdst;
+		uint8_t msg[130], bin_fixed[BBS_SCALAR_LEN];
+		if(BBS_OK != hash_to_scalar_fixed_init(f->cipher_suite, &fdst, map_dst, map_dst_len)) {
+			puts("Error during fixed DST preparation");
+			return 1;
+		}
+		for(int len = 0; len <= sizeof(msg); len++) {
+			if(len) msg[len - 1] = len * 7;
+			if(BBS_OK != hash_to_scalar(f->cipher_suite, scalar, map_dst, map_dst_len, msg, len, 0)) {
+				puts("Error during hash to scalar");
+				return 1;
+			}
+			RLC_TRY {
+				bn_write_bbs(bin, scalar);
+			} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+			if(BBS_OK != hash_to_scalar_fixed(&fdst, scalar, msg, len)) {
+				puts("Error during fixed DST hash to scalar");
+				return 1;
+			}
+			RLC_TRY {
+				bn_write_bbs(bin_fixed, scalar);
+			} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+			ASSERT_EQ("fixed DST scalar generation", bin_fixed, bin);
+		}
 
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_5, sizeof(fixture_m_5), 0)) {
-		puts("Error during hash to scalar for message 5");
-		return 1;
+		// All messages at once, through the multi-buffer path where there is one
+		if(BBS_OK != hash_to_scalar_batch(&fdst, scalars, msgs, msg_lens, LEN(msgs))) {
+			puts("Error during batched hash to scalar");
+			return 1;
+		}
+		for(int i = 0; i < LEN(msgs); i++) {
+			RLC_TRY {
+				bn_write_bbs(bin, scalars[i]);
+			} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
+			if(memcmp(bin, f->msg_scalars[i], BBS_SCALAR_LEN)) {
+				printf("Mismatch in batched scalar %d generation\n", i + 1);
+				return 1;
+			}
+		}
 	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 5 generation", bin, fixture_bls12_381_sha_256_msg_scalar_5);
 
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_6, sizeof(fixture_m_6), 0)) {
-		puts("Error during hash to scalar for message 6");
-		return 1;
+	for(int i = 0; i < LEN(msgs); i++) {
+		bn_free(scalars[i]);
 	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 6 generation", bin, fixture_bls12_381_sha_256_msg_scalar_6);
-
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_7, sizeof(fixture_m_7), 0)) {
-		puts("Error during hash to scalar for message 7");
-		return 1;
-	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 7 generation", bin, fixture_bls12_381_sha_256_msg_scalar_7);
-
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_8, sizeof(fixture_m_8), 0)) {
-		puts("Error during hash to scalar for message 8");
-		return 1;
-	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 8 generation", bin, fixture_bls12_381_sha_256_msg_scalar_8);
-
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_9, sizeof(fixture_m_9), 0)) {
-		puts("Error during hash to scalar for message 9");
-		return 1;
-	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 9 generation", bin, fixture_bls12_381_sha_256_msg_scalar_9);
-
-	if(BBS_OK != hash_to_scalar(scalar, map_dst, map_dst_len, fixture_m_10, sizeof(fixture_m_10), 0)) {
-		puts("Error during hash to scalar for message 10");
-		return 1;
-	}
-	RLC_TRY {
-		bn_write_bbs(bin, scalar);
-	} RLC_CATCH_ANY { puts("Internal Error"); return 1; }
-	ASSERT_EQ("scalar 10 generation", bin, fixture_bls12_381_sha_256_msg_scalar_10);
-
 	bn_free(scalar);
 	return 0;
 }
@@ -11,82 +11,155 @@ int bbs_fix_proof_verify() {
 		return 1;
 	}
 
-	if(BBS_OK != bbs_proof_verify(
-				fixture_bls12_381_sha_256_proof1_public_key,
-				fixture_bls12_381_sha_256_proof1_proof,
-				sizeof(fixture_bls12_381_sha_256_proof1_proof),
-				fixture_bls12_381_sha_256_proof1_header,
-				sizeof(fixture_bls12_381_sha_256_proof1_header),
-				fixture_bls12_381_sha_256_proof1_presentation_header,
-				sizeof(fixture_bls12_381_sha_256_proof1_presentation_header),
-				fixture_bls12_381_sha_256_proof1_revealed_indexes,
-				LEN(fixture_bls12_381_sha_256_proof1_revealed_indexes),
-				1,
-				fixture_bls12_381_sha_256_proof1_m_1,
-				sizeof(fixture_bls12_381_sha_256_proof1_m_1))) {
-		puts("Error during proof 1 verification");
-		return 1;
-	}
+	fixture_ciphersuite suites[] = FIXTURE_CIPHERSUITES;
+	for(int s = 0; s < LEN(suites); s++) {
+		const fixture_ciphersuite *f = &suites[s];
+		printf("Ciphersuite %s\n", f->name);
 
-	if(BBS_OK != bbs_proof_verify(
-				fixture_bls12_381_sha_256_proof2_public_key,
-				fixture_bls12_381_sha_256_proof2_proof,
-				sizeof(fixture_bls12_381_sha_256_proof2_proof),
-				fixture_bls12_381_sha_256_proof2_header,
-				sizeof(fixture_bls12_381_sha_256_proof2_header),
-				fixture_bls12_381_sha_256_proof2_presentation_header,
-				sizeof(fixture_bls12_381_sha_256_proof2_presentation_header),
-				fixture_bls12_381_sha_256_proof2_revealed_indexes,
-				LEN(fixture_bls12_381_sha_256_proof2_revealed_indexes),
-				10,
-				fixture_bls12_381_sha_256_proof2_m_1,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_1),
-				fixture_bls12_381_sha_256_proof2_m_2,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_2),
-				fixture_bls12_381_sha_256_proof2_m_3,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_3),
-				fixture_bls12_381_sha_256_proof2_m_4,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_4),
-				fixture_bls12_381_sha_256_proof2_m_5,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_5),
-				fixture_bls12_381_sha_256_proof2_m_6,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_6),
-				fixture_bls12_381_sha_256_proof2_m_7,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_7),
-				fixture_bls12_381_sha_256_proof2_m_8,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_8),
-				fixture_bls12_381_sha_256_proof2_m_9,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_9),
-				fixture_bls12_381_sha_256_proof2_m_10,
-				sizeof(fixture_bls12_381_sha_256_proof2_m_10))) {
-		puts("Error during proof 2 verification");
-		return 1;
-	}
+		if(BBS_OK != bbs_proof_verify(
+					f->cipher_suite,
+					f->proofs[0].public_key,
+					f->proofs[0].proof,
+					f->proofs[0].proof_len,
+					f->proofs[0].header,
+					f->proofs[0].header_len,
+					f->proofs[0].presentation_header,
+					f->proofs[0].presentation_header_len,
+					f->proofs[0].revealed_indexes,
+					f->proofs[0].revealed_indexes_len,
+					1,
+					fixture_m_1,
+					sizeof(fixture_m_1))) {
+			puts("Error during proof 1 verification");
+			return 1;
+		}
 
-	// Only some messages are being revealed here
-	if(BBS_OK != bbs_proof_verify(
-				fixture_bls12_381_sha_256_proof3_public_key,
-				fixture_bls12_381_sha_256_proof3_proof,
-				sizeof(fixture_bls12_381_sha_256_proof3_proof),
-				fixture_bls12_381_sha_256_proof3_header,
-				sizeof(fixture_bls12_381_sha_256_proof3_header),
-				fixture_bls12_381_sha_256_proof3_presentation_header,
-				sizeof(fixture_bls12_381_sha_256_proof3_presentation_header),
-				fixture_bls12_381_sha_256_proof3_revealed_indexes,
-				LEN(fixture_bls12_381_sha_256_proof3_revealed_indexes),
-				10,
-				fixture_bls12_381_sha_256_proof3_m_1,
-				sizeof(fixture_bls12_381_sha_256_proof3_m_1),
-				fixture_bls12_381_sha_256_proof3_m_3,
-				sizeof(fixture_bls12_381_sha_256_proof3_m_3),
-				fixture_bls12_381_sha_256_proof3_m_5,
-				sizeof(fixture_bls12_381_sha_256_proof3_m_5),
-				fixture_bls12_381_sha_256_proof3_m_7,
-				sizeof(fixture_bls12_381_sha_256_proof3_m_7))) {
-		puts("Error during proof 3 verification");
-		return 1;
+		if(BBS_OK != bbs_proof_verify(
+					f->cipher_suite,
+					f->proofs[1].public_key,
+					f->proofs[1].proof,
+					f->proofs[1].proof_len,
+					f->proofs[1].header,
+					f->proofs[1].header_len,
+					f->proofs[1].presentation_header,
+					f->proofs[1].presentation_header_len,
+					f->proofs[1].revealed_indexes,
+					f->proofs[1].revealed_indexes_len,
+					10,
+					fixture_m_1,
+					sizeof(fixture_m_1),
+					fixture_m_2,
+					sizeof(fixture_m_2),
+					fixture_m_3,
+					sizeof(fixture_m_3),
+					fixture_m_4,
+					sizeof(fixture_m_4),
+					fixture_m_5,
+					sizeof(fixture_m_5),
+					fixture_m_6,
+					sizeof(fixture_m_6),
+					fixture_m_7,
+					sizeof(fixture_m_7),
+					fixture_m_8,
+					sizeof(fixture_m_8),
+					fixture_m_9,
+					sizeof(fixture_m_9),
+					fixture_m_10,
+					sizeof(fixture_m_10))) {
+			puts("Error during proof 2 verification");
+			return 1;
+		}
+
+		// Only some messages are being revealed here
+		if(BBS_OK != bbs_proof_verify(
+					f->cipher_suite,
+					f->proofs[2].public_key,
+					f->proofs[2].proof,
+					f->proofs[2].proof_len,
+					f->proofs[2].header,
+					f->proofs[2].header_len,
+					f->proofs[2].presentation_header,
+					f->proofs[2].presentation_header_len,
+					f->proofs[2].revealed_indexes,
+					f->proofs[2].revealed_indexes_len,
+					10,
+					fixture_m_1,
+					sizeof(fixture_m_1),
+					fixture_m_3,
+					sizeof(fixture_m_3),
+					fixture_m_5,
+					sizeof(fixture_m_5),
+					fixture_m_7,
+					sizeof(fixture_m_7))) {
+			puts("Error during proof 3 verification");
+			return 1;
+		}
+
+		// All proofs are under the same key, so it is prepared once
+		bbs_prepared_pk *ppk;
+		if(BBS_OK != bbs_prepared_pk_new(f->cipher_suite, &ppk, f->proofs[2].public_key)) {
+			puts("Error during public key preparation");
+			return 1;
+		}
+		const uint8_t *disclosed[] = {fixture_m_1, fixture_m_3, fixture_m_5, fixture_m_7};
+		size_t disclosed_lens[] = {sizeof(fixture_m_1), sizeof(fixture_m_3),
+			sizeof(fixture_m_5), sizeof(fixture_m_7)};
+		bbs_messages messages = {.msgs = disclosed, .msg_lens = disclosed_lens};
+		if(BBS_OK != bbs_proof_verify_prepared(
+					ppk,
+					f->proofs[2].proof,
+					f->proofs[2].proof_len,
+					f->proofs[2].header,
+					f->proofs[2].header_len,
+					f->proofs[2].presentation_header,
+					f->proofs[2].presentation_header_len,
+					f->proofs[2].revealed_indexes,
+					f->proofs[2].revealed_indexes_len,
+					10,
+					&messages)) {
+			puts("Error during proof 3 verification with a prepared key");
+			return 1;
+		}
+		bbs_prepared_pk_free(ppk);
+
+		// A verifier for the disclosed index set of proof 3, given out of
+		// order
+		bbs_proof_verifier verifier;
+		ep_t generators[10];
+		uint64_t indexes[] = {6, 0, 4, 2};
+		if(BBS_OK != bbs_proof_verifier_init(f->cipher_suite, &verifier, f->proofs[2].public_key,
+						     f->proofs[2].header, f->proofs[2].header_len,
+						     indexes, LEN(indexes), generators, LEN(generators))) {
+			puts("Error during verifier initialization");
+			return 1;
+		}
+		for(int i = 0; i < 2; i++) {
+			if(BBS_OK != bbs_proof_verifier_verify(&verifier, f->proofs[2].proof,
+							       f->proofs[2].proof_len,
+							       f->proofs[2].presentation_header,
+							       f->proofs[2].presentation_header_len,
+							       10, &messages)) {
+				puts("Error during proof 3 verification with a verifier");
+				return 1;
+			}
+		}
+		if(BBS_OK == bbs_proof_verifier_verify(&verifier, f->proofs[2].proof,
+						       f->proofs[2].proof_len, NULL, 0, 10, &messages)) {
+			puts("Verifier accepted a proof for another presentation header");
+			return 1;
+		}
+		bbs_proof_verifier_free(&verifier);
+
+		uint64_t duplicate_indexes[] = {0, 2, 2, 4};
+		if(BBS_OK == bbs_proof_verifier_init(f->cipher_suite, &verifier, f->proofs[2].public_key,
+						     f->proofs[2].header, f->proofs[2].header_len,
+						     duplicate_indexes, LEN(duplicate_indexes),
+						     generators, LEN(generators))) {
+			puts("Verifier accepted duplicate indexes");
+			return 1;
+		}
+		bbs_proof_verifier_free(&verifier);
 	}
 
 	return 0;
 }
-
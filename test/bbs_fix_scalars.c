@@ -0,0 +1,204 @@
+#include "fixtures.h"
+#include "test_util.h"
+
+// Hands out a message in chunks of growing length
+typedef struct {
+	const uint8_t *msg;
+	uint64_t       msg_len;
+	uint64_t       pos;
+	uint64_t       chunk_len;
+} chunked_msg;
+
+static int
+next_chunk(
+		void           *cookie,
+		const uint8_t **chunk,
+		uint64_t       *chunk_len
+	) {
+	chunked_msg *m = cookie;
+
+	*chunk     = m->msg + m->pos;
+	*chunk_len = m->msg_len - m->pos < m->chunk_len ? m->msg_len - m->pos : m->chunk_len;
+	m->pos    += *chunk_len;
+	m->chunk_len++;
+	return BBS_OK;
+}
+
+int bbs_fix_scalars() {
+	if (core_init() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+	if (pc_param_set_any() != RLC_OK) {
+		core_clean();
+		return 1;
+	}
+
+	uint8_t msg_scalars[10][BBS_SCALAR_LEN];
+	uint8_t proof[BBS_PROOF_LEN(6)];
+
+	fixture_ciphersuite suites[] = FIXTURE_CIPHERSUITES;
+	for(int s = 0; s < LEN(suites); s++) {
+		const fixture_ciphersuite *f = &suites[s];
+		printf("Ciphersuite %s\n", f->name);
+
+		if(BBS_OK != bbs_messages_to_scalars(
+					f->cipher_suite,
+					(uint8_t*)msg_scalars,
+					10,
+					fixture_m_1,
+					sizeof(fixture_m_1),
+					fixture_m_2,
+					sizeof(fixture_m_2),
+					fixture_m_3,
+					sizeof(fixture_m_3),
+					fixture_m_4,
+					sizeof(fixture_m_4),
+					fixture_m_5,
+					sizeof(fixture_m_5),
+					fixture_m_6,
+					sizeof(fixture_m_6),
+					fixture_m_7,
+					sizeof(fixture_m_7),
+					fixture_m_8,
+					sizeof(fixture_m_8),
+					fixture_m_9,
+					sizeof(fixture_m_9),
+					fixture_m_10,
+					sizeof(fixture_m_10))) {
+			puts("Error during message to scalar mapping");
+			return 1;
+		}
+		for(int i = 0; i < 10; i++) {
+			ASSERT_EQ_LEN("message scalar", msg_scalars[i], f->msg_scalars[i],
+				      BBS_SCALAR_LEN);
+		}
+
+		// Streamed messages map to the same scalars
+		for(int i = 0; i < 10; i++) {
+			const uint8_t *msgs[] = {fixture_m_1, fixture_m_2, fixture_m_3, fixture_m_4,
+				fixture_m_5, fixture_m_6, fixture_m_7, fixture_m_8, fixture_m_9,
+				fixture_m_10};
+			uint64_t msg_lens[] = {sizeof(fixture_m_1), sizeof(fixture_m_2),
+				sizeof(fixture_m_3), sizeof(fixture_m_4), sizeof(fixture_m_5),
+				sizeof(fixture_m_6), sizeof(fixture_m_7), sizeof(fixture_m_8),
+				sizeof(fixture_m_9), sizeof(fixture_m_10)};
+			chunked_msg m = {msgs[i], msg_lens[i], 0, 1};
+			uint8_t streamed[BBS_SCALAR_LEN];
+
+			if(BBS_OK != bbs_message_to_scalar_stream(f->cipher_suite, streamed,
+								  next_chunk, &m)) {
+				puts("Error during streamed message to scalar mapping");
+				return 1;
+			}
+			ASSERT_EQ_LEN("streamed message scalar", streamed, f->msg_scalars[i],
+				      BBS_SCALAR_LEN);
+		}
+
+		bbs_signature sig;
+		if(BBS_OK != bbs_sign_scalars(
+					f->cipher_suite,
+					f->signature2_SK,
+					f->signature2_PK,
+					sig,
+					f->signature2_header,
+					f->signature2_header_len,
+					10,
+					msg_scalars[0], msg_scalars[1], msg_scalars[2], msg_scalars[3],
+					msg_scalars[4], msg_scalars[5], msg_scalars[6], msg_scalars[7],
+					msg_scalars[8], msg_scalars[9])) {
+			puts("Error during signature 2 generation from scalars");
+			return 1;
+		}
+		ASSERT_EQ_LEN("signature 2 generation from scalars", sig, f->signature2_signature,
+			      BBS_SIG_LEN);
+
+		if(BBS_OK != bbs_verify_scalars(
+					f->cipher_suite,
+					f->signature2_PK,
+					f->signature2_signature,
+					f->signature2_header,
+					f->signature2_header_len,
+					10,
+					msg_scalars[0], msg_scalars[1], msg_scalars[2], msg_scalars[3],
+					msg_scalars[4], msg_scalars[5], msg_scalars[6], msg_scalars[7],
+					msg_scalars[8], msg_scalars[9])) {
+			puts("Error during signature 2 verification from scalars");
+			return 1;
+		}
+
+		// Proof 3 discloses messages 1, 3, 5 and 7
+		if(BBS_OK != bbs_proof_verify_scalars(
+					f->cipher_suite,
+					f->proofs[2].public_key,
+					f->proofs[2].proof,
+					f->proofs[2].proof_len,
+					f->proofs[2].header,
+					f->proofs[2].header_len,
+					f->proofs[2].presentation_header,
+					f->proofs[2].presentation_header_len,
+					f->proofs[2].revealed_indexes,
+					f->proofs[2].revealed_indexes_len,
+					10,
+					msg_scalars[0], msg_scalars[2], msg_scalars[4], msg_scalars[6])) {
+			puts("Error during proof 3 verification from scalars");
+			return 1;
+		}
+
+		// A fresh proof over the scalars has to verify against the messages
+		if(BBS_OK != bbs_proof_gen_scalars(
+					f->cipher_suite,
+					f->proofs[2].public_key,
+					f->proofs[2].signature,
+					proof,
+					f->proofs[2].header,
+					f->proofs[2].header_len,
+					f->proofs[2].presentation_header,
+					f->proofs[2].presentation_header_len,
+					f->proofs[2].revealed_indexes,
+					f->proofs[2].revealed_indexes_len,
+					10,
+					msg_scalars[0], msg_scalars[1], msg_scalars[2], msg_scalars[3],
+					msg_scalars[4], msg_scalars[5], msg_scalars[6], msg_scalars[7],
+					msg_scalars[8], msg_scalars[9])) {
+			puts("Error during proof generation from scalars");
+			return 1;
+		}
+		if(BBS_OK != bbs_proof_verify(
+					f->cipher_suite,
+					f->proofs[2].public_key,
+					proof,
+					sizeof(proof),
+					f->proofs[2].header,
+					f->proofs[2].header_len,
+					f->proofs[2].presentation_header,
+					f->proofs[2].presentation_header_len,
+					f->proofs[2].revealed_indexes,
+					f->proofs[2].revealed_indexes_len,
+					10,
+					fixture_m_1,
+					sizeof(fixture_m_1),
+					fixture_m_3,
+					sizeof(fixture_m_3),
+					fixture_m_5,
+					sizeof(fixture_m_5),
+					fixture_m_7,
+					sizeof(fixture_m_7))) {
+			puts("Error during verification of the proof from scalars");
+			return 1;
+		}
+
+		// Message scalars have to be reduced
+		uint8_t unreduced[BBS_SCALAR_LEN];
+		for(int i = 0; i < BBS_SCALAR_LEN; i++) unreduced[i] = 0xff;
+		if(BBS_OK == bbs_sign_scalars(f->cipher_suite, f->signature1_SK, f->signature1_PK,
+					      sig, f->signature1_header,
+					      f->signature1_header_len, 1, unreduced)) {
+			puts("Unreduced message scalar accepted");
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
@@ -1,5 +1,6 @@
 #include "fixtures.h"
 #include "test_util.h"
+#include <string.h>
 
 int bbs_fix_sign() {
 	if (core_init() != RLC_OK) {
@@ -11,52 +12,203 @@ int bbs_fix_sign() {
 		return 1;
 	}
 
-	bbs_signature sig;
-	if(BBS_OK != bbs_sign(
-				fixture_bls12_381_sha_256_signature1_SK,
-				fixture_bls12_381_sha_256_signature1_PK,
-				sig,
-				fixture_bls12_381_sha_256_signature1_header,
-				sizeof(fixture_bls12_381_sha_256_signature1_header),
-				1,
-				fixture_bls12_381_sha_256_signature1_m_1,
-				sizeof(fixture_bls12_381_sha_256_signature1_m_1))) {
-		puts("Error during signature 1 generation");
-		return 1;
-	}
-	ASSERT_EQ("signature 1 generation", sig, fixture_bls12_381_sha_256_signature1_signature);
-
-	if(BBS_OK != bbs_sign(
-				fixture_bls12_381_sha_256_signature2_SK,
-				fixture_bls12_381_sha_256_signature2_PK,
-				sig,
-				fixture_bls12_381_sha_256_signature2_header,
-				sizeof(fixture_bls12_381_sha_256_signature2_header),
-				10,
-				fixture_bls12_381_sha_256_signature2_m_1,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_1),
-				fixture_bls12_381_sha_256_signature2_m_2,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_2),
-				fixture_bls12_381_sha_256_signature2_m_3,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_3),
-				fixture_bls12_381_sha_256_signature2_m_4,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_4),
-				fixture_bls12_381_sha_256_signature2_m_5,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_5),
-				fixture_bls12_381_sha_256_signature2_m_6,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_6),
-				fixture_bls12_381_sha_256_signature2_m_7,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_7),
-				fixture_bls12_381_sha_256_signature2_m_8,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_8),
-				fixture_bls12_381_sha_256_signature2_m_9,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_9),
-				fixture_bls12_381_sha_256_signature2_m_10,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_10))) {
-		puts("Error during signature 2 generation");
-		return 1;
+	fixture_ciphersuite suites[] = FIXTURE_CIPHERSUITES;
+	for(int s = 0; s < LEN(suites); s++) {
+		const fixture_ciphersuite *f = &suites[s];
+		printf("Ciphersuite %s\n", f->name);
+
+		bbs_signature sig;
+		if(BBS_OK != bbs_sign(
+					f->cipher_suite,
+					f->signature1_SK,
+					f->signature1_PK,
+					sig,
+					f->signature1_header,
+					f->signature1_header_len,
+					1,
+					fixture_m_1,
+					sizeof(fixture_m_1))) {
+			puts("Error during signature 1 generation");
+			return 1;
+		}
+		ASSERT_EQ_LEN("signature 1 generation", sig, f->signature1_signature, BBS_SIG_LEN);
+
+		if(BBS_OK != bbs_sign(
+					f->cipher_suite,
+					f->signature2_SK,
+					f->signature2_PK,
+					sig,
+					f->signature2_header,
+					f->signature2_header_len,
+					10,
+					fixture_m_1,
+					sizeof(fixture_m_1),
+					fixture_m_2,
+					sizeof(fixture_m_2),
+					fixture_m_3,
+					sizeof(fixture_m_3),
+					fixture_m_4,
+					sizeof(fixture_m_4),
+					fixture_m_5,
+					sizeof(fixture_m_5),
+					fixture_m_6,
+					sizeof(fixture_m_6),
+					fixture_m_7,
+					sizeof(fixture_m_7),
+					fixture_m_8,
+					sizeof(fixture_m_8),
+					fixture_m_9,
+					sizeof(fixture_m_9),
+					fixture_m_10,
+					sizeof(fixture_m_10))) {
+			puts("Error during signature 2 generation");
+			return 1;
+		}
+		ASSERT_EQ_LEN("signature 2 generation", sig, f->signature2_signature, BBS_SIG_LEN);
+
+		// The signer context has to reproduce the signature, every time
+		bbs_signer signer;
+		ep_t generators[10];
+		const uint8_t *msgs[] = {fixture_m_1, fixture_m_2, fixture_m_3, fixture_m_4, fixture_m_5,
+			fixture_m_6, fixture_m_7, fixture_m_8, fixture_m_9, fixture_m_10};
+		size_t msg_lens[] = {sizeof(fixture_m_1), sizeof(fixture_m_2), sizeof(fixture_m_3),
+			sizeof(fixture_m_4), sizeof(fixture_m_5), sizeof(fixture_m_6), sizeof(fixture_m_7),
+			sizeof(fixture_m_8), sizeof(fixture_m_9), sizeof(fixture_m_10)};
+		bbs_messages messages = {.msgs = msgs, .msg_lens = msg_lens};
+		if(BBS_OK != bbs_signer_init(f->cipher_suite, &signer, f->signature2_SK, f->signature2_PK,
+					     f->signature2_header, f->signature2_header_len, generators,
+					     LEN(generators))) {
+			puts("Error during signer initialization");
+			return 1;
+		}
+		for(int i = 0; i < 2; i++) {
+			memset(sig, 0, sizeof(sig));
+			if(BBS_OK != bbs_signer_sign(&signer, sig, LEN(msgs), &messages)) {
+				puts("Error during signature 2 generation with a signer");
+				return 1;
+			}
+			ASSERT_EQ_LEN("signature 2 generation with a signer", sig,
+				      f->signature2_signature, BBS_SIG_LEN);
+		}
+		if(BBS_OK == bbs_signer_sign(&signer, sig, 1, &messages)) {
+			puts("Signer accepted the wrong number of messages");
+			return 1;
+		}
+
+		// A re-issuer that starts with a different message 4 reaches the
+		// same signature after the update
+		bbs_reissuer reissuer;
+		uint8_t scalars[10 * BBS_SCALAR_LEN];
+		uint64_t update_index = 3;
+		const uint8_t *update_msgs[] = {fixture_m_4, fixture_m_2};
+		size_t update_lens[] = {sizeof(fixture_m_4), sizeof(fixture_m_2)};
+		bbs_messages update = {.msgs = update_msgs, .msg_lens = update_lens};
+		msgs[3] = fixture_m_1;
+		msg_lens[3] = sizeof(fixture_m_1);
+		if(BBS_OK != bbs_reissuer_init(&reissuer, &signer, scalars, LEN(msgs), &messages)) {
+			puts("Error during re-issuer initialization");
+			return 1;
+		}
+		if(BBS_OK != bbs_reissuer_sign(&reissuer, sig)) {
+			puts("Error during re-issuer signing");
+			return 1;
+		}
+		if(0 == memcmp(sig, f->signature2_signature, BBS_SIG_LEN)) {
+			puts("Re-issuer ignored a message");
+			return 1;
+		}
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_reissuer_update(&reissuer, 1, &update_index, &update)) {
+			puts("Error during re-issuer update");
+			return 1;
+		}
+		if(BBS_OK != bbs_reissuer_sign(&reissuer, sig)) {
+			puts("Error during re-issuer signing");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_reissuer_update and bbs_reissuer_sign (1 of 10 messages)")
+		ASSERT_EQ_LEN("signature 2 generation with a re-issuer", sig, f->signature2_signature,
+			      BBS_SIG_LEN);
+		update_index = LEN(msgs);
+		if(BBS_OK == bbs_reissuer_update(&reissuer, 1, &update_index, &update)) {
+			puts("Re-issuer accepted an index out of range");
+			return 1;
+		}
+
+		// A failed update changes nothing, even if its first message was
+		// valid, and later updates of an index start from earlier ones
+		uint64_t update_indexes[] = {0, 3}, repeated_indexes[] = {3, 3};
+		uint8_t scalar[BBS_SCALAR_LEN], invalid_scalar[BBS_SCALAR_LEN];
+		const uint8_t *update_scalars[] = {scalar, invalid_scalar};
+		bbs_messages invalid_update = {.msg_scalars = update_scalars};
+		memset(invalid_scalar, 0xff, sizeof(invalid_scalar));
+		if(BBS_OK != bbs_messages_to_scalars(f->cipher_suite, scalar, 1, fixture_m_2,
+						     sizeof(fixture_m_2))) {
+			puts("Error during message mapping");
+			return 1;
+		}
+		if(BBS_OK == bbs_reissuer_update(&reissuer, LEN(update_indexes), update_indexes,
+						 &invalid_update)) {
+			puts("Re-issuer accepted an invalid message scalar");
+			return 1;
+		}
+		if(BBS_OK != bbs_reissuer_sign(&reissuer, sig)) {
+			puts("Error during re-issuer signing");
+			return 1;
+		}
+		ASSERT_EQ_LEN("signature 2 after a failed update", sig, f->signature2_signature,
+			      BBS_SIG_LEN);
+		update_msgs[0] = fixture_m_2;
+		update_lens[0] = sizeof(fixture_m_2);
+		update_msgs[1] = fixture_m_4;
+		update_lens[1] = sizeof(fixture_m_4);
+		if(BBS_OK != bbs_reissuer_update(&reissuer, LEN(repeated_indexes), repeated_indexes,
+						 &update)) {
+			puts("Error during repeated re-issuer update");
+			return 1;
+		}
+		if(BBS_OK != bbs_reissuer_sign(&reissuer, sig)) {
+			puts("Error during re-issuer signing");
+			return 1;
+		}
+		ASSERT_EQ_LEN("signature 2 after a repeated update", sig, f->signature2_signature,
+			      BBS_SIG_LEN);
+		bbs_reissuer_free(&reissuer);
+
+		// A template with fixed messages 1, 5, 6 and 10 takes the others
+		bbs_signer_template tmpl;
+		uint64_t fixed_indexes[] = {0, 4, 5, 9};
+		const uint8_t *fixed_msgs[] = {fixture_m_1, fixture_m_5, fixture_m_6, fixture_m_10};
+		size_t fixed_lens[] = {sizeof(fixture_m_1), sizeof(fixture_m_5), sizeof(fixture_m_6),
+			sizeof(fixture_m_10)};
+		const uint8_t *variable_msgs[] = {fixture_m_2, fixture_m_3, fixture_m_4, fixture_m_7,
+			fixture_m_8, fixture_m_9};
+		size_t variable_lens[] = {sizeof(fixture_m_2), sizeof(fixture_m_3),
+			sizeof(fixture_m_4), sizeof(fixture_m_7), sizeof(fixture_m_8),
+			sizeof(fixture_m_9)};
+		bbs_messages fixed = {.msgs = fixed_msgs, .msg_lens = fixed_lens};
+		bbs_messages variable = {.msgs = variable_msgs, .msg_lens = variable_lens};
+		if(BBS_OK != bbs_signer_template_init(&tmpl, &signer, scalars, LEN(fixed_indexes),
+						      fixed_indexes, &fixed)) {
+			puts("Error during template initialization");
+			return 1;
+		}
+		memset(sig, 0, sizeof(sig));
+		BBS_BENCH_START()
+		if(BBS_OK != bbs_signer_template_sign(&tmpl, sig, LEN(variable_msgs), &variable)) {
+			puts("Error during signature 2 generation with a template");
+			return 1;
+		}
+		BBS_BENCH_END("bbs_signer_template_sign (6 of 10 messages)")
+		ASSERT_EQ_LEN("signature 2 generation with a template", sig, f->signature2_signature,
+			      BBS_SIG_LEN);
+		if(BBS_OK == bbs_signer_template_sign(&tmpl, sig, LEN(msgs), &messages)) {
+			puts("Template accepted the wrong number of messages");
+			return 1;
+		}
+		bbs_signer_template_free(&tmpl);
+		bbs_signer_free(&signer);
 	}
-	ASSERT_EQ("signature 2 generation", sig, fixture_bls12_381_sha_256_signature2_signature);
 
 	return 0;
 }
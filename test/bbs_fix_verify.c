@@ -11,46 +11,104 @@ int bbs_fix_verify() {
 		return 1;
 	}
 
-	if(BBS_OK != bbs_verify(
-				fixture_bls12_381_sha_256_signature1_PK,
-				fixture_bls12_381_sha_256_signature1_signature,
-				fixture_bls12_381_sha_256_signature1_header,
-				sizeof(fixture_bls12_381_sha_256_signature1_header),
-				1,
-				fixture_bls12_381_sha_256_signature1_m_1,
-				sizeof(fixture_bls12_381_sha_256_signature1_m_1))) {
-		puts("Error during signature 1 verification");
-		return 1;
-	}
+	fixture_ciphersuite suites[] = FIXTURE_CIPHERSUITES;
+	for(int s = 0; s < LEN(suites); s++) {
+		const fixture_ciphersuite *f = &suites[s];
+		printf("Ciphersuite %s\n", f->name);
 
-	if(BBS_OK != bbs_verify(
-				fixture_bls12_381_sha_256_signature2_PK,
-				fixture_bls12_381_sha_256_signature2_signature,
-				fixture_bls12_381_sha_256_signature2_header,
-				sizeof(fixture_bls12_381_sha_256_signature2_header),
-				10,
-				fixture_bls12_381_sha_256_signature2_m_1,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_1),
-				fixture_bls12_381_sha_256_signature2_m_2,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_2),
-				fixture_bls12_381_sha_256_signature2_m_3,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_3),
-				fixture_bls12_381_sha_256_signature2_m_4,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_4),
-				fixture_bls12_381_sha_256_signature2_m_5,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_5),
-				fixture_bls12_381_sha_256_signature2_m_6,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_6),
-				fixture_bls12_381_sha_256_signature2_m_7,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_7),
-				fixture_bls12_381_sha_256_signature2_m_8,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_8),
-				fixture_bls12_381_sha_256_signature2_m_9,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_9),
-				fixture_bls12_381_sha_256_signature2_m_10,
-				sizeof(fixture_bls12_381_sha_256_signature2_m_10))) {
-		puts("Error during signature 2 verification");
-		return 1;
+		if(BBS_OK != bbs_verify(
+					f->cipher_suite,
+					f->signature1_PK,
+					f->signature1_signature,
+					f->signature1_header,
+					f->signature1_header_len,
+					1,
+					fixture_m_1,
+					sizeof(fixture_m_1))) {
+			puts("Error during signature 1 verification");
+			return 1;
+		}
+
+		if(BBS_OK != bbs_verify(
+					f->cipher_suite,
+					f->signature2_PK,
+					f->signature2_signature,
+					f->signature2_header,
+					f->signature2_header_len,
+					10,
+					fixture_m_1,
+					sizeof(fixture_m_1),
+					fixture_m_2,
+					sizeof(fixture_m_2),
+					fixture_m_3,
+					sizeof(fixture_m_3),
+					fixture_m_4,
+					sizeof(fixture_m_4),
+					fixture_m_5,
+					sizeof(fixture_m_5),
+					fixture_m_6,
+					sizeof(fixture_m_6),
+					fixture_m_7,
+					sizeof(fixture_m_7),
+					fixture_m_8,
+					sizeof(fixture_m_8),
+					fixture_m_9,
+					sizeof(fixture_m_9),
+					fixture_m_10,
+					sizeof(fixture_m_10))) {
+			puts("Error during signature 2 verification");
+			return 1;
+		}
+
+		// The same key, parsed and validated once, with the message and
+		// with its scalar
+		bbs_prepared_pk *ppk;
+		if(BBS_OK != bbs_prepared_pk_new(f->cipher_suite, &ppk, f->signature1_PK)) {
+			puts("Error during public key preparation");
+			return 1;
+		}
+		const uint8_t *msgs[] = {fixture_m_1};
+		size_t msg_lens[] = {sizeof(fixture_m_1)};
+		uint8_t scalar[BBS_SCALAR_LEN];
+		const uint8_t *scalars[] = {scalar};
+		if(BBS_OK != bbs_messages_to_scalars(f->cipher_suite, scalar, 1, fixture_m_1,
+						     sizeof(fixture_m_1))) {
+			puts("Error during message mapping");
+			return 1;
+		}
+		bbs_messages messages[] = {
+			{.msgs = msgs, .msg_lens = msg_lens},
+			{.msg_scalars = scalars},
+		};
+		for(int i = 0; i < LEN(messages); i++) {
+			if(BBS_OK != bbs_verify_prepared(ppk, f->signature1_signature, f->signature1_header,
+							 f->signature1_header_len, 1, &messages[i])) {
+				puts("Error during signature 1 verification with a prepared key");
+				return 1;
+			}
+		}
+		const uint8_t *wrong_msgs[] = {fixture_m_2};
+		size_t wrong_lens[] = {sizeof(fixture_m_2)};
+		bbs_messages wrong = {.msgs = wrong_msgs, .msg_lens = wrong_lens};
+		if(BBS_OK == bbs_verify_prepared(ppk, f->signature1_signature, f->signature1_header,
+						 f->signature1_header_len, 1, &wrong)) {
+			puts("Prepared key verification accepted a wrong message");
+			return 1;
+		}
+		bbs_messages none = {0};
+		if(BBS_OK == bbs_verify_prepared(ppk, f->signature1_signature, f->signature1_header,
+						 f->signature1_header_len, 1, &none)) {
+			puts("Prepared key verification accepted missing messages");
+			return 1;
+		}
+		bbs_prepared_pk_free(ppk);
+
+		// The identity is not a valid public key
+		bbs_public_key identity = {0xc0};
+		if(BBS_OK == bbs_prepared_pk_new(f->cipher_suite, &ppk, identity) || ppk) {
+			puts("Identity accepted as a prepared key");
+			return 1;
+		}
 	}
 
 	return 0;
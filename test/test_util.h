@@ -18,6 +18,144 @@
 		} \
 	}
 
+// Like ASSERT_EQ, for references without a static size
+#define ASSERT_EQ_LEN(purpose, actual, ref, len) \
+	for(int i=0; i < (len); i++) { \
+		if(actual[i] != ref[i]) { \
+			puts("Mismatch in " purpose); \
+			DEBUG("Should be:", ref, (len)); \
+			DEBUG("Is:", actual, (len)); \
+			return 1; \
+		} \
+	}
+
+// The fixtures of one ciphersuite, so that the fixture tests can run once per
+// ciphersuite. Messages are shared between the ciphersuites and not included.
+typedef struct {
+	const bbs_ciphersuite *cipher_suite;
+	const char            *name;
+	const uint8_t         *key_material;
+	uint64_t               key_material_len;
+	const uint8_t         *key_info;
+	uint64_t               key_info_len;
+	const uint8_t         *key_dst;
+	uint64_t               key_dst_len;
+	const uint8_t         *SK;
+	const uint8_t         *PK;
+	const uint8_t         *msg_scalars[10];
+	// Q_1, H_1, ..., H_10
+	const uint8_t         *generators[11];
+	const uint8_t         *signature1_SK;
+	const uint8_t         *signature1_PK;
+	const uint8_t         *signature1_header;
+	uint64_t               signature1_header_len;
+	const uint8_t         *signature1_signature;
+	const uint8_t         *signature2_SK;
+	const uint8_t         *signature2_PK;
+	const uint8_t         *signature2_header;
+	uint64_t               signature2_header_len;
+	const uint8_t         *signature2_signature;
+	const uint8_t         *proof_SEED;
+	uint64_t               proof_SEED_len;
+	const uint8_t         *proof_DST;
+	uint64_t               proof_DST_len;
+	const uint8_t         *proof_random_scalars[10];
+	struct {
+		const uint8_t  *public_key;
+		const uint8_t  *signature;
+		const uint8_t  *header;
+		uint64_t        header_len;
+		const uint8_t  *presentation_header;
+		uint64_t        presentation_header_len;
+		const uint64_t *revealed_indexes;
+		uint64_t        revealed_indexes_len;
+		const uint8_t  *proof;
+		uint64_t        proof_len;
+	} proofs[3];
+} fixture_ciphersuite;
+
+// Initializer for a fixture_ciphersuite, where suite is sha_256 or shake_256.
+// Only usable where fixtures.h is included.
+#define FIXTURE_CIPHERSUITE(cs, suite) { \
+	.cipher_suite = cs, \
+	.name = #suite, \
+	.key_material = fixture_bls12_381_##suite##_key_material, \
+	.key_material_len = sizeof(fixture_bls12_381_##suite##_key_material), \
+	.key_info = fixture_bls12_381_##suite##_key_info, \
+	.key_info_len = sizeof(fixture_bls12_381_##suite##_key_info), \
+	.key_dst = fixture_bls12_381_##suite##_key_dst, \
+	.key_dst_len = sizeof(fixture_bls12_381_##suite##_key_dst), \
+	.SK = fixture_bls12_381_##suite##_SK, \
+	.PK = fixture_bls12_381_##suite##_PK, \
+	.msg_scalars = { \
+		fixture_bls12_381_##suite##_msg_scalar_1, \
+		fixture_bls12_381_##suite##_msg_scalar_2, \
+		fixture_bls12_381_##suite##_msg_scalar_3, \
+		fixture_bls12_381_##suite##_msg_scalar_4, \
+		fixture_bls12_381_##suite##_msg_scalar_5, \
+		fixture_bls12_381_##suite##_msg_scalar_6, \
+		fixture_bls12_381_##suite##_msg_scalar_7, \
+		fixture_bls12_381_##suite##_msg_scalar_8, \
+		fixture_bls12_381_##suite##_msg_scalar_9, \
+		fixture_bls12_381_##suite##_msg_scalar_10}, \
+	.generators = { \
+		fixture_bls12_381_##suite##_Q_1, \
+		fixture_bls12_381_##suite##_H_1, \
+		fixture_bls12_381_##suite##_H_2, \
+		fixture_bls12_381_##suite##_H_3, \
+		fixture_bls12_381_##suite##_H_4, \
+		fixture_bls12_381_##suite##_H_5, \
+		fixture_bls12_381_##suite##_H_6, \
+		fixture_bls12_381_##suite##_H_7, \
+		fixture_bls12_381_##suite##_H_8, \
+		fixture_bls12_381_##suite##_H_9, \
+		fixture_bls12_381_##suite##_H_10}, \
+	.signature1_SK = fixture_bls12_381_##suite##_signature1_SK, \
+	.signature1_PK = fixture_bls12_381_##suite##_signature1_PK, \
+	.signature1_header = fixture_bls12_381_##suite##_signature1_header, \
+	.signature1_header_len = sizeof(fixture_bls12_381_##suite##_signature1_header), \
+	.signature1_signature = fixture_bls12_381_##suite##_signature1_signature, \
+	.signature2_SK = fixture_bls12_381_##suite##_signature2_SK, \
+	.signature2_PK = fixture_bls12_381_##suite##_signature2_PK, \
+	.signature2_header = fixture_bls12_381_##suite##_signature2_header, \
+	.signature2_header_len = sizeof(fixture_bls12_381_##suite##_signature2_header), \
+	.signature2_signature = fixture_bls12_381_##suite##_signature2_signature, \
+	.proof_SEED = fixture_bls12_381_##suite##_proof_SEED, \
+	.proof_SEED_len = sizeof(fixture_bls12_381_##suite##_proof_SEED), \
+	.proof_DST = fixture_bls12_381_##suite##_proof_DST, \
+	.proof_DST_len = sizeof(fixture_bls12_381_##suite##_proof_DST), \
+	.proof_random_scalars = { \
+		fixture_bls12_381_##suite##_proof_random_scalar_1, \
+		fixture_bls12_381_##suite##_proof_random_scalar_2, \
+		fixture_bls12_381_##suite##_proof_random_scalar_3, \
+		fixture_bls12_381_##suite##_proof_random_scalar_4, \
+		fixture_bls12_381_##suite##_proof_random_scalar_5, \
+		fixture_bls12_381_##suite##_proof_random_scalar_6, \
+		fixture_bls12_381_##suite##_proof_random_scalar_7, \
+		fixture_bls12_381_##suite##_proof_random_scalar_8, \
+		fixture_bls12_381_##suite##_proof_random_scalar_9, \
+		fixture_bls12_381_##suite##_proof_random_scalar_10}, \
+	.proofs = { \
+		FIXTURE_PROOF(suite, proof1), \
+		FIXTURE_PROOF(suite, proof2), \
+		FIXTURE_PROOF(suite, proof3)}}
+#define FIXTURE_PROOF(suite, proof) { \
+	fixture_bls12_381_##suite##_##proof##_public_key, \
+	fixture_bls12_381_##suite##_##proof##_signature, \
+	fixture_bls12_381_##suite##_##proof##_header, \
+	sizeof(fixture_bls12_381_##suite##_##proof##_header), \
+	fixture_bls12_381_##suite##_##proof##_presentation_header, \
+	sizeof(fixture_bls12_381_##suite##_##proof##_presentation_header), \
+	fixture_bls12_381_##suite##_##proof##_revealed_indexes, \
+	LEN(fixture_bls12_381_##suite##_##proof##_revealed_indexes), \
+	fixture_bls12_381_##suite##_##proof##_proof, \
+	sizeof(fixture_bls12_381_##suite##_##proof##_proof)}
+
+// Both ciphersuites, for looping over in the fixture tests
+#define FIXTURE_CIPHERSUITES { \
+	FIXTURE_CIPHERSUITE(bbs_sha256_ciphersuite, sha_256), \
+	FIXTURE_CIPHERSUITE(bbs_shake256_ciphersuite, shake_256)}
+
 
 struct timespec tp_start;
 